@@ -129,11 +129,12 @@ void BubbleSort<T>::sort()
     for(int i = 0; i < size - 1; i++)
     {
         swapped = false;
-        for(int j = 0; j < size - 1; j++)
+        //the largest i values are already at the end
+        for(int j = 0; j < size - 1 - i; j++)
         {
+            comparisons++;
             if(arr[j] > arr[j+1])
             {
-                comparisons++;
                 std::swap(arr[j], arr[j+1]);
                 swaps++;
                 swapped = true;
@@ -153,4 +154,4 @@ void BubbleSort<T>::sort()
 }
 
 
-#endif // SELECTIONSORT_H
+#endif // BUBBLESORT_H
@@ -4,6 +4,10 @@
  * @date   March 2019
  *
  * Self contained templated header file for Merge sorting
+ * The sorting itself is mergeSort() from Sorting.h, this class fills an array with random values,
+ * times the sort and keeps its comparison and swap counts
+ * Given a WorkStealingPool it runs parallelMergeSort() from ParallelSort.h instead, which is timed
+ * but not counted
  */
 #ifndef MERGESORT_H
 #define MERGESORT_H
@@ -12,6 +16,9 @@
 #include <random> //random_device, mt199937, uniform_int_distribution
 #include <algorithm> //std::swap
 #include <time.h> //clock_t, clock(), CLOCKS_PER_SEC
+#include <chrono> //steady_clock, for timing the parallel sort
+#include "Sorting.h" //mergeSort, CountOps
+#include "ParallelSort.h" //parallelMergeSort, WorkStealingPool
 
 template <typename T>
 class MergeSort
@@ -23,8 +30,8 @@ class MergeSort
 
         void serialize() const;
 
-        void sort(int l, int r);
-        void merge(int start, int mid, int end);
+        void sort(int front, int end);
+        void sort(int front, int end, WorkStealingPool& pool);
 
         void deallocate();
 
@@ -58,7 +65,7 @@ MergeSort<T>::MergeSort(int sizeVal)
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dis(0, 1000000);
 
-    arr = new (std::nothrow) int [sizeVal];
+    arr = new (std::nothrow) T [sizeVal];
     size = sizeVal;
 
     //fills vector with random values
@@ -115,88 +122,48 @@ void MergeSort<T>::serialize() const
 
 /**
  * Actual method for sorting
- * copied from lecture slides with a few changes
- * primarily added comparison and swap increments
- * also added time keeping
+ * sorts the values from index front up to but not including end
+ * with a buffered merge sort, every merge is linear
+ * comparisons, swaps and time add up over calls
+ * @param front first index to sort
+ * @param end one past the last index to sort
  */
-template <typename T>
-void MergeSort<T>::merge(int start, int mid, int end)
-{
-    int start2 = mid + 1;
-    clock_t t;
-
-    t = clock();
-    // If the direct merge is already sorted
-    if (arr[mid] <= arr[start2])
-    {
-        comparisons++;
-        t = clock() - t;
-        clicks += t;
-        return;
-    }
-
-    // Two pointers to maintain start
-    // of both arrays to merge
-    while (start <= mid && start2 <= end)
-    {
-        comparisons++;
-        // If element 1 is in right place
-        if (arr[start] <= arr[start2])
-        {
-            comparisons++;
-            start++;
-
-        }
-        else
-        {
-            int value = arr[start2];
-            int index = start2;
-
-            // Shift all the elements between element 1
-            // element 2, right by 1.
-            while (index != start)
-            {
-                comparisons++;
-                arr[index] = arr[index - 1];
-                swaps++;
-                index--;
-            }
-            arr[start] = value;
-            swaps++;
-
-            // Update all the pointers
-            start++;
-            mid++;
-            start2++;
-        }
-    }
-} // end merge
-
-
 template <typename T>
 void MergeSort<T>::sort(int front, int end)
 {
     clock_t t;
     t = clock();
 
-    if (front < end)
-    {
-        comparisons++;
-
-        // Same as (l + r) / 2, but avoids overflow
-        // for large l and r
-        int mid = front + (end - front) / 2;
+    CountOps ops;
+    mergeSort(arr + front, arr + end, std::less<T>(), ops);
+    comparisons += ops.comparisons;
+    swaps += ops.swaps;
 
-        // Sort first and second halves
-        sort(front, mid);
-        sort(mid + 1, end);
-        merge(front, mid, end);
-    }
     t = clock() - t;
 
     clicks += t;
     seconds = ((float(clicks)/CLOCKS_PER_SEC));
 }
 
+/**
+ * Parallel mode of sort, the halves are sorted as tasks on the threads of pool
+ * comparisons and swaps are not counted. the time is wall clock time, since
+ * clock() adds up the time of every thread
+ * @param front first index to sort
+ * @param end one past the last index to sort
+ * @param pool threads to sort with
+ */
+template <typename T>
+void MergeSort<T>::sort(int front, int end, WorkStealingPool& pool)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    parallelMergeSort(arr + front, arr + end, std::less<T>(), pool);
+
+    std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    seconds += elapsed.count();
+    clicks = int(seconds * CLOCKS_PER_SEC);
+}
+
 
 #endif // MERGESORT_H
@@ -0,0 +1,385 @@
+/**
+ * @brief  CS-302 Homework 3
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   March 2019
+ *
+ * Self contained header file for a parallel merge sort on a work-stealing thread pool
+ * Every worker has its own deque of tasks. A worker adds and takes tasks at the back of its own deque,
+ * so it keeps working on the most recent (smallest, cache warm) piece, and an idle worker steals from
+ * the front of someone else's, which holds the oldest and largest pieces. A thread waiting for its tasks
+ * to finish runs queued tasks instead of blocking, so a sort can wait inside a task without deadlock.
+ * parallelMergeSort() forks the two halves as tasks down to a cutoff where the sequential mergeSort()
+ * of Sorting.h takes over, and the large merges at the top are split into independent pieces by
+ * co-ranking (merge path), so the last merge does not run on one thread.
+ * https://en.wikipedia.org/wiki/Work_stealing used for reference
+ */
+#ifndef PARALLELSORT_H
+#define PARALLELSORT_H
+
+#include <vector>
+#include <deque>
+#include <memory> //std::unique_ptr
+#include <functional> //std::function, std::less
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <iterator> //iterator_traits
+#include <algorithm> //std::min, std::max
+#include "Sorting.h" //mergeSortRec, mergeInto, CountedLess, NoCount
+
+//ranges this short are sorted on one thread
+#define PAR_SORT_CUTOFF (1 << 14)
+//a merge is split into about this many pieces per thread, so threads that
+//finish early can steal the rest
+#define PAR_MERGE_PIECES 4
+
+/**
+ * A piece of work, and the count of unfinished tasks of the group it belongs to
+ */
+struct Task
+{
+    std::function<void()> work;
+    std::atomic<int>* pending;
+};
+
+class WorkStealingPool
+{
+    //public members/methods
+    public:
+        WorkStealingPool(unsigned threads = 0);
+        virtual ~WorkStealingPool();
+
+        //threads that run tasks, counting the one that waits on them
+        unsigned size() const { return (unsigned)queues.size(); }
+
+        void push(Task* task);
+
+        //runs one queued task if there is one, the calling thread's own newest
+        //task first, then the oldest task of another thread
+        bool runOne();
+
+    //private members/methods
+    private:
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<Task*> tasks;
+        };
+
+        void workerLoop(unsigned index);
+        unsigned myQueue() const;
+        Task* popBack(unsigned index);
+        Task* steal(unsigned thief);
+
+        //queue 0 belongs to threads outside the pool, the others to the workers
+        std::vector<std::unique_ptr<Queue> > queues;
+        std::vector<std::thread> workers;
+
+        //tasks in all of the queues, idle workers sleep while it is 0
+        std::atomic<int> queued;
+        std::atomic<bool> stop;
+        std::mutex sleep_lock;
+        std::condition_variable wake;
+};
+
+/**
+ * Tasks that are waited on together
+ * spawn() hands a task to the pool and wait() helps run tasks until all of this group's are done
+ */
+class TaskGroup
+{
+    //public members/methods
+    public:
+        TaskGroup(WorkStealingPool& poolVal) : pool(poolVal), pending(0) {}
+        virtual ~TaskGroup() { wait(); }
+
+        template <typename F>
+        void spawn(F work)
+        {
+            pending.fetch_add(1, std::memory_order_relaxed);
+            pool.push(new Task{ work, &pending });
+        }
+
+        void wait()
+        {
+            while (pending.load(std::memory_order_acquire) > 0)
+                if (!pool.runOne())
+                    std::this_thread::yield();
+        }
+
+    //private members/methods
+    private:
+        WorkStealingPool& pool;
+        std::atomic<int> pending;
+};
+
+/**
+ * The pool and queue of the calling thread, so a task knows which queue to push to
+ */
+struct WorkerSlot
+{
+    const WorkStealingPool* pool;
+    unsigned index;
+};
+
+static thread_local WorkerSlot current_worker = { nullptr, 0 };
+
+/**
+ * Parameterized constructor for WorkStealingPool class
+ * starts threads - 1 workers, the thread that waits on a task group is the last one
+ * @param threads number of threads, 0 for one per core
+ */
+WorkStealingPool::WorkStealingPool(unsigned threads) : queued(0), stop(false)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threads; i++)
+        queues.emplace_back(new Queue());
+
+    for (unsigned i = 1; i < threads; i++)
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+/**
+ * Destructor for WorkStealingPool class
+ * every task group must have finished waiting before the pool goes away
+ */
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+/**
+ * Index of the queue the calling thread owns
+ */
+unsigned WorkStealingPool::myQueue() const
+{
+    return (current_worker.pool == this) ? current_worker.index : 0;
+}
+
+/**
+ * Adds a task to the back of the calling thread's queue and wakes a worker for it
+ */
+void WorkStealingPool::push(Task* task)
+{
+    Queue& q = *queues[myQueue()];
+    {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(task);
+    }
+
+    queued.fetch_add(1, std::memory_order_release);
+
+    //taking the lock means a worker can not miss the wake up between checking
+    //queued and going to sleep
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+    }
+    wake.notify_one();
+}
+
+Task* WorkStealingPool::popBack(unsigned index)
+{
+    Queue& q = *queues[index];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty())
+        return nullptr;
+
+    Task* task = q.tasks.back();
+    q.tasks.pop_back();
+    return task;
+}
+
+/**
+ * Takes the oldest task of another queue, trying each queue once from the one after the thief
+ */
+Task* WorkStealingPool::steal(unsigned thief)
+{
+    for (unsigned k = 1; k < queues.size(); k++)
+    {
+        Queue& q = *queues[(thief + k) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (!q.tasks.empty())
+        {
+            Task* task = q.tasks.front();
+            q.tasks.pop_front();
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+bool WorkStealingPool::runOne()
+{
+    unsigned index = myQueue();
+    Task* task = popBack(index);
+    if (task == nullptr)
+        task = steal(index);
+    if (task == nullptr)
+        return false;
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task->work();
+    task->pending->fetch_sub(1, std::memory_order_release);
+    delete task;
+    return true;
+}
+
+/**
+ * What every worker thread runs, until the pool is destroyed
+ */
+void WorkStealingPool::workerLoop(unsigned index)
+{
+    current_worker.pool = this;
+    current_worker.index = index;
+
+    while (true)
+    {
+        if (runOne())
+            continue;
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [this] { return stop || queued.load(std::memory_order_acquire) > 0; });
+        if (stop)
+            return;
+    }
+}
+
+/**
+ * Number of elements of [first1, last1) among the first k elements of the merge of the two ranges
+ * found by binary search, on a tie the first range goes first so the merge is stable
+ */
+template <typename Iter1, typename Iter2, typename Compare>
+size_t coRank(size_t k, Iter1 first1, size_t n1, Iter2 first2, size_t n2, Compare comp)
+{
+    size_t lo = (k > n2) ? k - n2 : 0;
+    size_t hi = std::min(k, n1);
+
+    while (lo < hi)
+    {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+
+        //first1[i] belongs before first2[j - 1], so more of the first range is needed
+        if (!comp(first2[j - 1], first1[i]))
+            lo = i + 1;
+        else
+            hi = i;
+    }
+
+    return lo;
+}
+
+/**
+ * Merges the sorted ranges [first1, first1 + n1) and [first2, first2 + n2) into out
+ * a long merge is cut into pieces of the output, each starting where co-ranking
+ * says, and the pieces are merged as separate tasks
+ */
+template <typename Iter1, typename Iter2, typename Out, typename Compare>
+void parallelMerge(Iter1 first1, size_t n1, Iter2 first2, size_t n2, Out out, Compare comp,
+    WorkStealingPool& pool, size_t cutoff)
+{
+    size_t n = n1 + n2;
+    size_t pieces = std::min((size_t)pool.size() * PAR_MERGE_PIECES, n / cutoff);
+
+    NoCount none;
+    CountedLess<Compare, NoCount> less = { comp, &none };
+
+    if (pieces < 2)
+    {
+        mergeInto(first1, first1 + n1, first2, first2 + n2, out, less, none);
+        return;
+    }
+
+    TaskGroup group(pool);
+    size_t piece = (n + pieces - 1) / pieces;
+
+    for (size_t start = 0; start < n; start += piece)
+    {
+        size_t end = std::min(start + piece, n);
+        group.spawn([=]() mutable
+        {
+            size_t i0 = coRank(start, first1, n1, first2, n2, comp);
+            size_t i1 = coRank(end, first1, n1, first2, n2, comp);
+            mergeInto(first1 + i0, first1 + i1, first2 + (start - i0), first2 + (end - i1),
+                out + start, less, none);
+        });
+    }
+
+    group.wait();
+}
+
+/**
+ * Sorts the n elements at a, leaving them at b instead if toB is true
+ * the halves are sorted into the other array so that the merge can move them
+ * back, which is why the destination alternates going down
+ */
+template <typename A, typename B, typename Compare>
+void parallelMergeSortRec(A a, B b, size_t n, bool toB, Compare comp, WorkStealingPool& pool, size_t cutoff)
+{
+    if (n <= cutoff)
+    {
+        NoCount none;
+        CountedLess<Compare, NoCount> less = { comp, &none };
+        mergeSortRec(a, a + n, b, less, none);
+
+        if (toB)
+            std::move(a, a + n, b);
+        return;
+    }
+
+    size_t half = n / 2;
+    TaskGroup group(pool);
+    group.spawn([=, &pool]() { parallelMergeSortRec(a, b, half, !toB, comp, pool, cutoff); });
+    parallelMergeSortRec(a + half, b + half, n - half, !toB, comp, pool, cutoff);
+    group.wait();
+
+    if (toB)
+        parallelMerge(a, half, a + half, n - half, b, comp, pool, cutoff);
+    else
+        parallelMerge(b, half, b + half, n - half, a, comp, pool, cutoff);
+}
+
+/**
+ * Sorts [first, last) with a merge sort that runs on every thread of pool, stable
+ * needs a buffer as long as the range, and does not count comparisons or swaps
+ * @param comp strict weak ordering, std::less by default
+ * @param cutoff ranges this short are sorted by one thread
+ */
+template <typename Iter, typename Compare>
+void parallelMergeSort(Iter first, Iter last, Compare comp, WorkStealingPool& pool,
+    size_t cutoff = PAR_SORT_CUTOFF)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    size_t n = last - first;
+    cutoff = std::max(cutoff, (size_t)SORT_INSERTION);
+
+    if (pool.size() == 1 || n <= cutoff)
+    {
+        mergeSort(first, last, comp);
+        return;
+    }
+
+    std::vector<T> buffer(n);
+    parallelMergeSortRec(first, buffer.begin(), n, false, comp, pool, cutoff);
+}
+
+template <typename Iter>
+void parallelMergeSort(Iter first, Iter last, WorkStealingPool& pool)
+{
+    parallelMergeSort(first, last, std::less<typename std::iterator_traits<Iter>::value_type>(), pool);
+}
+
+
+#endif // PARALLELSORT_H
@@ -0,0 +1,713 @@
+/**
+ * @brief  CS-302 Homework 3
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   March 2019
+ *
+ * Self contained templated header file of sorts that work on any random access iterators
+ * mergeSort() is a top-down merge sort and mergeSortBottomUp() a bottom-up one, both allocate one
+ * scratch buffer up front and merge through it, so every merge is linear. introSort() is a
+ * pattern-defeating quicksort (pdqsort): insertion sort for short ranges, a median of 3 or a
+ * ninther pivot, sorted and reversed input found in linear time, and a heapsort once too many
+ * partitions have come out badly unbalanced, so it is O(n log n) in the worst case.
+ * stableSort() keeps equal elements in their order, with a rotation based merge if there is not
+ * enough memory for the buffer.
+ * Every sort takes an optional counter that is told about each comparison and swap, NoCount by
+ * default which costs nothing, or CountOps to count them like the BubbleSort and MergeSort classes do
+ * https://github.com/orlp/pdqsort used for reference
+ */
+#ifndef SORTING_H
+#define SORTING_H
+
+#include <vector>
+#include <iterator> //iterator_traits
+#include <functional> //std::less
+#include <algorithm> //std::swap, std::move, std::upper_bound, std::lower_bound, std::rotate
+#include <utility> //std::pair
+#include <new> //std::bad_alloc
+
+//ranges shorter than this are insertion sorted
+#define SORT_INSERTION 24
+//ranges longer than this take the median of three medians as the pivot
+#define SORT_NINTHER 128
+//a partial insertion sort gives up after moving this many elements
+#define SORT_PARTIAL_LIMIT 8
+//length of the runs the bottom-up merge sort starts with
+#define SORT_RUN 32
+
+/**
+ * Counter that counts nothing, every call compiles away
+ */
+struct NoCount
+{
+    void addComparison() {}
+    void addSwap() {}
+};
+
+/**
+ * Counter for the comparisons and swaps of a sort
+ * an element shifted or moved through the merge buffer counts as a swap
+ */
+struct CountOps
+{
+    size_t comparisons = 0;
+    size_t swaps = 0;
+
+    void addComparison() { comparisons++; }
+    void addSwap() { swaps++; }
+};
+
+/**
+ * Comparison that tells the counter about every call
+ */
+template <typename Compare, typename Counter>
+struct CountedLess
+{
+    Compare comp;
+    Counter* count;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b)
+    {
+        count->addComparison();
+        return comp(a, b);
+    }
+};
+
+/**
+ * Swaps the elements two iterators point to and counts it
+ */
+template <typename Iter, typename Counter>
+inline void countedSwap(Iter a, Iter b, Counter& count)
+{
+    std::iter_swap(a, b);
+    count.addSwap();
+}
+
+/**
+ * Insertion sort of [first, last)
+ * @param unguarded if true, the element before first must not be greater
+ * than any element in the range, so the inner loop needs no bounds check
+ */
+template <typename Iter, typename Less, typename Counter>
+void insertionSort(Iter first, Iter last, Less& less, Counter& count, bool unguarded = false)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    if (first == last)
+        return;
+
+    for (Iter i = first + 1; i != last; ++i)
+    {
+        Iter j = i;
+        if (less(*i, *(i - 1)))
+        {
+            T value = std::move(*i);
+            do
+            {
+                *j = std::move(*(j - 1));
+                count.addSwap();
+                --j;
+            } while ((unguarded || j != first) && less(value, *(j - 1)));
+
+            *j = std::move(value);
+        }
+    }
+}
+
+/**
+ * Insertion sort that stops once it has moved more than SORT_PARTIAL_LIMIT elements
+ * @return true if [first, last) is now sorted
+ */
+template <typename Iter, typename Less, typename Counter>
+bool partialInsertionSort(Iter first, Iter last, Less& less, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    if (first == last)
+        return true;
+
+    size_t moved = 0;
+    for (Iter i = first + 1; i != last; ++i)
+    {
+        Iter j = i;
+        if (less(*i, *(i - 1)))
+        {
+            T value = std::move(*i);
+            do
+            {
+                *j = std::move(*(j - 1));
+                count.addSwap();
+                --j;
+            } while (j != first && less(value, *(j - 1)));
+
+            *j = std::move(value);
+            moved += i - j;
+        }
+
+        if (moved > SORT_PARTIAL_LIMIT)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Moves the largest element below i down the heap in [first, first + n)
+ */
+template <typename Iter, typename Less, typename Counter>
+void siftDown(Iter first, size_t i, size_t n, Less& less, Counter& count)
+{
+    for (size_t child = 2 * i + 1; child < n; child = 2 * i + 1)
+    {
+        if (child + 1 < n && less(first[child], first[child + 1]))
+            child++;
+
+        if (!less(first[i], first[child]))
+            return;
+
+        countedSwap(first + i, first + child, count);
+        i = child;
+    }
+}
+
+/**
+ * Heapsort of [first, last), the fallback that keeps introSort() O(n log n)
+ */
+template <typename Iter, typename Less, typename Counter>
+void heapSort(Iter first, Iter last, Less& less, Counter& count)
+{
+    size_t n = last - first;
+
+    for (size_t i = n / 2; i-- > 0;)
+        siftDown(first, i, n, less, count);
+
+    for (size_t end = n; end-- > 1;)
+    {
+        countedSwap(first, first + end, count);
+        siftDown(first, 0, end, less, count);
+    }
+}
+
+/**
+ * Sorts the three elements a, b and c so that *a <= *b <= *c
+ */
+template <typename Iter, typename Less, typename Counter>
+inline void sort3(Iter a, Iter b, Iter c, Less& less, Counter& count)
+{
+    if (less(*b, *a))
+        countedSwap(a, b, count);
+    if (less(*c, *b))
+        countedSwap(b, c, count);
+    if (less(*b, *a))
+        countedSwap(a, b, count);
+}
+
+/**
+ * Partitions [first, last) around the pivot *first, elements equal to the pivot go right
+ * @return where the pivot ended up, and whether the range was already partitioned
+ */
+template <typename Iter, typename Less, typename Counter>
+std::pair<Iter, bool> partitionRight(Iter first, Iter last, Less& less, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    T pivot = std::move(*first);
+    Iter left = first, right = last;
+
+    //the median of 3 left an element at least as large as the pivot at the
+    //end, so the left scan needs no bounds check
+    while (less(*++left, pivot));
+
+    //if nothing was out of place on the left, the right scan may run into it
+    if (left - 1 == first)
+        while (left < right && !less(*--right, pivot));
+    else
+        while (!less(*--right, pivot));
+
+    bool partitioned = left >= right;
+
+    while (left < right)
+    {
+        countedSwap(left, right, count);
+        while (less(*++left, pivot));
+        while (!less(*--right, pivot));
+    }
+
+    Iter pivot_pos = left - 1;
+    *first = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    count.addSwap();
+
+    return std::make_pair(pivot_pos, partitioned);
+}
+
+/**
+ * Partitions [first, last) around the pivot *first, elements equal to the pivot go left
+ * used when the pivot equals the element before the range, so the whole left side equals
+ * the pivot and never has to be sorted again. this is what keeps many duplicates linear
+ * @return where the pivot ended up
+ */
+template <typename Iter, typename Less, typename Counter>
+Iter partitionLeft(Iter first, Iter last, Less& less, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    T pivot = std::move(*first);
+    Iter left = first, right = last;
+
+    while (less(pivot, *--right));
+
+    if (right + 1 == last)
+        while (left < right && !less(pivot, *++left));
+    else
+        while (!less(pivot, *++left));
+
+    while (left < right)
+    {
+        countedSwap(left, right, count);
+        while (less(pivot, *--right));
+        while (!less(pivot, *++left));
+    }
+
+    *first = std::move(*right);
+    *right = std::move(pivot);
+    count.addSwap();
+
+    return right;
+}
+
+/**
+ * Main loop of introSort(), recurses on the left part and loops on the right one
+ * @param bad_allowed unbalanced partitions left before switching to heapsort
+ * @param leftmost true if there is no element before first
+ */
+template <typename Iter, typename Less, typename Counter>
+void pdqLoop(Iter first, Iter last, Less& less, Counter& count, int bad_allowed, bool leftmost)
+{
+    while (true)
+    {
+        size_t size = last - first;
+
+        if (size < SORT_INSERTION)
+        {
+            insertionSort(first, last, less, count, !leftmost);
+            return;
+        }
+
+        //the pivot is moved to first
+        size_t half = size / 2;
+        if (size > SORT_NINTHER)
+        {
+            sort3(first, first + half, last - 1, less, count);
+            sort3(first + 1, first + (half - 1), last - 2, less, count);
+            sort3(first + 2, first + (half + 1), last - 3, less, count);
+            sort3(first + (half - 1), first + half, first + (half + 1), less, count);
+            countedSwap(first, first + half, count);
+        }
+        else
+            sort3(first + half, first, last - 1, less, count);
+
+        //a pivot equal to the element before the range is the smallest value
+        //left, so everything equal to it is already in place
+        if (!leftmost && !less(*(first - 1), *first))
+        {
+            first = partitionLeft(first, last, less, count) + 1;
+            continue;
+        }
+
+        std::pair<Iter, bool> part = partitionRight(first, last, less, count);
+        Iter pivot_pos = part.first;
+        size_t left_size = pivot_pos - first;
+        size_t right_size = last - (pivot_pos + 1);
+
+        if (left_size < size / 8 || right_size < size / 8)
+        {
+            if (--bad_allowed == 0)
+            {
+                heapSort(first, last, less, count);
+                return;
+            }
+
+            //swaps a few elements around to break up whatever pattern made the
+            //pivot so bad, so the next pivot is likely to be better
+            if (left_size >= SORT_INSERTION)
+            {
+                countedSwap(first, first + left_size / 4, count);
+                countedSwap(pivot_pos - 1, pivot_pos - left_size / 4, count);
+
+                if (left_size > SORT_NINTHER)
+                {
+                    countedSwap(first + 1, first + (left_size / 4 + 1), count);
+                    countedSwap(first + 2, first + (left_size / 4 + 2), count);
+                    countedSwap(pivot_pos - 2, pivot_pos - (left_size / 4 + 1), count);
+                    countedSwap(pivot_pos - 3, pivot_pos - (left_size / 4 + 2), count);
+                }
+            }
+
+            if (right_size >= SORT_INSERTION)
+            {
+                countedSwap(pivot_pos + 1, pivot_pos + (1 + right_size / 4), count);
+                countedSwap(last - 1, last - right_size / 4, count);
+
+                if (right_size > SORT_NINTHER)
+                {
+                    countedSwap(pivot_pos + 2, pivot_pos + (2 + right_size / 4), count);
+                    countedSwap(pivot_pos + 3, pivot_pos + (3 + right_size / 4), count);
+                    countedSwap(last - 2, last - (1 + right_size / 4), count);
+                    countedSwap(last - 3, last - (2 + right_size / 4), count);
+                }
+            }
+        }
+        else if (part.second && partialInsertionSort(first, pivot_pos, less, count) &&
+            partialInsertionSort(pivot_pos + 1, last, less, count))
+        {
+            //a balanced partition that moved nothing is a hint that the input
+            //is already sorted, which the partial insertion sorts confirm
+            return;
+        }
+
+        pdqLoop(first, pivot_pos, less, count, bad_allowed, leftmost);
+        first = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+/**
+ * Sorts [first, last) with a pattern-defeating quicksort, not stable
+ * @param comp strict weak ordering, std::less by default
+ * @param count counter told about every comparison and swap
+ */
+template <typename Iter, typename Compare, typename Counter>
+void introSort(Iter first, Iter last, Compare comp, Counter& count)
+{
+    if (last - first < 2)
+        return;
+
+    //about log2(n) bad partitions are allowed
+    int bad_allowed = 0;
+    for (size_t n = last - first; n > 0; n >>= 1)
+        bad_allowed++;
+
+    CountedLess<Compare, Counter> less = { comp, &count };
+    pdqLoop(first, last, less, count, bad_allowed, true);
+}
+
+template <typename Iter, typename Compare>
+void introSort(Iter first, Iter last, Compare comp)
+{
+    NoCount count;
+    introSort(first, last, comp, count);
+}
+
+template <typename Iter>
+void introSort(Iter first, Iter last)
+{
+    introSort(first, last, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+/**
+ * Merges the sorted ranges [first1, last1) and [first2, last2) into out, stable
+ * @return the end of the output
+ */
+template <typename Iter1, typename Iter2, typename Out, typename Less, typename Counter>
+Out mergeInto(Iter1 first1, Iter1 last1, Iter2 first2, Iter2 last2, Out out, Less& less, Counter& count)
+{
+    while (first1 != last1 && first2 != last2)
+    {
+        //taking from the first range on a tie keeps equal elements in order
+        if (less(*first2, *first1))
+            *out = std::move(*first2++);
+        else
+            *out = std::move(*first1++);
+
+        ++out;
+        count.addSwap();
+    }
+
+    for (; first1 != last1; ++first1, ++out)
+    {
+        *out = std::move(*first1);
+        count.addSwap();
+    }
+
+    for (; first2 != last2; ++first2, ++out)
+    {
+        *out = std::move(*first2);
+        count.addSwap();
+    }
+
+    return out;
+}
+
+/**
+ * Merges the sorted halves [first, mid) and [mid, last) in place, using buffer
+ * the left half is moved to the buffer and merged back, the right half never
+ * has to move because the output can not catch up with it
+ * @param buffer room for at least mid - first elements
+ */
+template <typename Iter, typename Buffer, typename Less, typename Counter>
+void mergeWithBuffer(Iter first, Iter mid, Iter last, Buffer buffer, Less& less, Counter& count)
+{
+    //already in order, common on sorted or nearly sorted input
+    if (first == mid || mid == last || !less(*mid, *(mid - 1)))
+        return;
+
+    //elements at the front that are no bigger than the first of the right half
+    //are already where they belong
+    first = std::upper_bound(first, mid, *mid, less);
+
+    Buffer buffer_end = buffer;
+    for (Iter i = first; i != mid; ++i, ++buffer_end)
+    {
+        *buffer_end = std::move(*i);
+        count.addSwap();
+    }
+
+    Buffer left = buffer;
+    Iter right = mid, out = first;
+    while (left != buffer_end && right != last)
+    {
+        if (less(*right, *left))
+            *out = std::move(*right++);
+        else
+            *out = std::move(*left++);
+
+        ++out;
+        count.addSwap();
+    }
+
+    //anything left of the right half is already in place
+    for (; left != buffer_end; ++left, ++out)
+    {
+        *out = std::move(*left);
+        count.addSwap();
+    }
+}
+
+/**
+ * Top-down merge sort of [first, last) with a buffer of at least half its length
+ */
+template <typename Iter, typename Buffer, typename Less, typename Counter>
+void mergeSortRec(Iter first, Iter last, Buffer buffer, Less& less, Counter& count)
+{
+    if (last - first < SORT_INSERTION)
+    {
+        insertionSort(first, last, less, count);
+        return;
+    }
+
+    Iter mid = first + (last - first) / 2;
+    mergeSortRec(first, mid, buffer, less, count);
+    mergeSortRec(mid, last, buffer, less, count);
+    mergeWithBuffer(first, mid, last, buffer, less, count);
+}
+
+/**
+ * Sorts [first, last) with a top-down merge sort, stable
+ * one buffer of half the length is allocated up front and shared by every merge
+ * @param comp strict weak ordering, std::less by default
+ * @param count counter told about every comparison and element moved
+ */
+template <typename Iter, typename Compare, typename Counter>
+void mergeSort(Iter first, Iter last, Compare comp, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    if (last - first < 2)
+        return;
+
+    std::vector<T> buffer((last - first) / 2);
+    CountedLess<Compare, Counter> less = { comp, &count };
+    mergeSortRec(first, last, buffer.begin(), less, count);
+}
+
+template <typename Iter, typename Compare>
+void mergeSort(Iter first, Iter last, Compare comp)
+{
+    NoCount count;
+    mergeSort(first, last, comp, count);
+}
+
+template <typename Iter>
+void mergeSort(Iter first, Iter last)
+{
+    mergeSort(first, last, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+/**
+ * Merges every pair of neighbouring runs of length width from [from, from + n) into to
+ */
+template <typename From, typename To, typename Less, typename Counter>
+void mergePass(From from, To to, size_t n, size_t width, Less& less, Counter& count)
+{
+    for (size_t start = 0; start < n; start += 2 * width)
+    {
+        size_t mid = std::min(start + width, n);
+        size_t end = std::min(start + 2 * width, n);
+        mergeInto(from + start, from + mid, from + mid, from + end, to + start, less, count);
+    }
+}
+
+/**
+ * Sorts [first, last) with a bottom-up merge sort, stable
+ * runs of SORT_RUN elements are insertion sorted, then each pass merges pairs of
+ * runs from the range into a buffer of the same length or back, so nothing is
+ * copied between passes and there is no recursion
+ * @param comp strict weak ordering, std::less by default
+ * @param count counter told about every comparison and element moved
+ */
+template <typename Iter, typename Compare, typename Counter>
+void mergeSortBottomUp(Iter first, Iter last, Compare comp, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    size_t n = last - first;
+    if (n < 2)
+        return;
+
+    CountedLess<Compare, Counter> less = { comp, &count };
+    for (size_t start = 0; start < n; start += SORT_RUN)
+        insertionSort(first + start, first + std::min(start + SORT_RUN, n), less, count);
+
+    if (n <= SORT_RUN)
+        return;
+
+    std::vector<T> buffer(n);
+    bool in_buffer = false;
+
+    for (size_t width = SORT_RUN; width < n; width *= 2)
+    {
+        if (in_buffer)
+            mergePass(buffer.begin(), first, n, width, less, count);
+        else
+            mergePass(first, buffer.begin(), n, width, less, count);
+
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            first[i] = std::move(buffer[i]);
+            count.addSwap();
+        }
+    }
+}
+
+template <typename Iter, typename Compare>
+void mergeSortBottomUp(Iter first, Iter last, Compare comp)
+{
+    NoCount count;
+    mergeSortBottomUp(first, last, comp, count);
+}
+
+template <typename Iter>
+void mergeSortBottomUp(Iter first, Iter last)
+{
+    mergeSortBottomUp(first, last, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+/**
+ * Merges the sorted halves [first, mid) and [mid, last) in place without a buffer
+ * the longer half is split in the middle, the matching split of the other half is
+ * found by binary search, and rotating the two middle pieces leaves two smaller
+ * merges. O(n log n) for one merge instead of O(n)
+ */
+template <typename Iter, typename Less, typename Counter>
+void mergeInPlace(Iter first, Iter mid, Iter last, Less& less, Counter& count)
+{
+    size_t left_size = mid - first, right_size = last - mid;
+
+    if (left_size == 0 || right_size == 0 || !less(*mid, *(mid - 1)))
+        return;
+
+    if (left_size + right_size == 2)
+    {
+        countedSwap(first, mid, count);
+        return;
+    }
+
+    Iter left_cut, right_cut;
+    if (left_size > right_size)
+    {
+        left_cut = first + left_size / 2;
+        right_cut = std::lower_bound(mid, last, *left_cut, less);
+    }
+    else
+    {
+        right_cut = mid + right_size / 2;
+        left_cut = std::upper_bound(first, mid, *right_cut, less);
+    }
+
+    Iter new_mid = std::rotate(left_cut, mid, right_cut);
+    for (size_t i = 0; i < (size_t)(right_cut - left_cut); i++)
+        count.addSwap();
+
+    mergeInPlace(first, left_cut, new_mid, less, count);
+    mergeInPlace(new_mid, right_cut, last, less, count);
+}
+
+/**
+ * Merge sort of [first, last) that merges in place, for when there is no memory for a buffer
+ */
+template <typename Iter, typename Less, typename Counter>
+void mergeSortInPlace(Iter first, Iter last, Less& less, Counter& count)
+{
+    if (last - first < SORT_INSERTION)
+    {
+        insertionSort(first, last, less, count);
+        return;
+    }
+
+    Iter mid = first + (last - first) / 2;
+    mergeSortInPlace(first, mid, less, count);
+    mergeSortInPlace(mid, last, less, count);
+    mergeInPlace(first, mid, last, less, count);
+}
+
+/**
+ * Sorts [first, last) keeping equal elements in the order they were in
+ * the same as mergeSort(), but if the buffer can not be allocated it falls back
+ * to merging in place, which is slower (O(n log^2 n)) but needs no extra memory
+ * @param comp strict weak ordering, std::less by default
+ * @param count counter told about every comparison and element moved
+ */
+template <typename Iter, typename Compare, typename Counter>
+void stableSort(Iter first, Iter last, Compare comp, Counter& count)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+
+    if (last - first < 2)
+        return;
+
+    CountedLess<Compare, Counter> less = { comp, &count };
+    std::vector<T> buffer;
+    try
+    {
+        buffer.resize((last - first) / 2);
+    }
+    catch (const std::bad_alloc&)
+    {
+        mergeSortInPlace(first, last, less, count);
+        return;
+    }
+
+    mergeSortRec(first, last, buffer.begin(), less, count);
+}
+
+template <typename Iter, typename Compare>
+void stableSort(Iter first, Iter last, Compare comp)
+{
+    NoCount count;
+    stableSort(first, last, comp, count);
+}
+
+template <typename Iter>
+void stableSort(Iter first, Iter last)
+{
+    stableSort(first, last, std::less<typename std::iterator_traits<Iter>::value_type>());
+}
+
+
+#endif // SORTING_H
@@ -4,9 +4,162 @@
  * @date   March 2019
  *
  * This file is the main file for testing sorts (Bubble and Merge)
+ * and for comparing the sorts of Sorting.h against the standard library
+ * Compiling with -std=c++17 -DSORT_STD_PAR (and -ltbb with GCC) adds std::execution::par to the
+ * parallel merge sort scalability test
  */
 #include "BubbleSort.h"
 #include "MergeSort.h"
+#include "Sorting.h"
+#include "ParallelSort.h"
+#include <vector>
+#include <cstdio>
+#include <chrono>
+
+#ifdef SORT_STD_PAR
+#include <execution>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h> //sysconf
+#endif
+
+/**
+ * Runs one sort on a copy of values and prints its time and counts
+ * @param name printed in the first column
+ * @param sortFunc called with the copy and a CountOps
+ */
+template <typename SortFunc>
+void timeSort(const char* name, const std::vector<int>& values, SortFunc sortFunc)
+{
+    std::vector<int> copy(values);
+    CountOps ops;
+
+    clock_t t = clock();
+    sortFunc(copy, ops);
+    t = clock() - t;
+
+    bool sorted = std::is_sorted(copy.begin(), copy.end());
+    printf("%-20s %10.3f %14zu %14zu %s\n", name, float(t) / CLOCKS_PER_SEC,
+        ops.comparisons, ops.swaps, sorted ? "" : "NOT SORTED");
+}
+
+/**
+ * Times every sort of Sorting.h and std::sort on random, sorted,
+ * reversed and few unique values
+ * @param size number of values
+ */
+void compareSorts(int size)
+{
+    std::mt19937 gen(302);
+    std::uniform_int_distribution<> dis(0, 1000000);
+    const char* inputs[] = { "random", "sorted", "reversed", "few unique" };
+
+    for(int input = 0; input < 4; input++)
+    {
+        std::vector<int> values(size);
+        for(int i = 0; i < size; i++)
+        {
+            values[i] = dis(gen);
+            if(input == 3)
+                values[i] %= 16;
+        }
+
+        if(input == 1)
+            std::sort(values.begin(), values.end());
+        else if(input == 2)
+            std::sort(values.begin(), values.end(), std::greater<int>());
+
+        printf("\n=====%d %s VALUES=====\n", size, inputs[input]);
+        printf("%-20s %10s %14s %14s\n", "sort", "seconds", "comparisons", "swaps");
+
+        timeSort("mergeSort", values, [](std::vector<int>& v, CountOps& ops)
+            { mergeSort(v.begin(), v.end(), std::less<int>(), ops); });
+        timeSort("mergeSortBottomUp", values, [](std::vector<int>& v, CountOps& ops)
+            { mergeSortBottomUp(v.begin(), v.end(), std::less<int>(), ops); });
+        timeSort("introSort", values, [](std::vector<int>& v, CountOps& ops)
+            { introSort(v.begin(), v.end(), std::less<int>(), ops); });
+        timeSort("stableSort", values, [](std::vector<int>& v, CountOps& ops)
+            { stableSort(v.begin(), v.end(), std::less<int>(), ops); });
+
+        //the same sorts without counting
+        timeSort("introSort (no count)", values, [](std::vector<int>& v, CountOps&)
+            { introSort(v.begin(), v.end()); });
+        timeSort("mergeSort (no count)", values, [](std::vector<int>& v, CountOps&)
+            { mergeSort(v.begin(), v.end()); });
+        timeSort("std::sort", values, [](std::vector<int>& v, CountOps&)
+            { std::sort(v.begin(), v.end()); });
+        timeSort("std::stable_sort", values, [](std::vector<int>& v, CountOps&)
+            { std::stable_sort(v.begin(), v.end()); });
+    }
+}
+
+/**
+ * Seconds since start, wall clock time
+ */
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/**
+ * Times parallelMergeSort() on 1 to 64 threads against std::sort, and std::execution::par
+ * if it was compiled in. the speedup is against parallelMergeSort() on one thread
+ * @param size number of random values
+ */
+void parallelScalability(size_t size)
+{
+    //the values, the copy being sorted and the merge buffer
+    double bytes = 3.0 * sizeof(int) * size;
+#if defined(__linux__)
+    double memory = (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    if (bytes > memory * 0.75)
+    {
+        printf("%zu values need about %.0f MB, more than 3/4 of the memory\n", size, bytes / (1024 * 1024));
+        return;
+    }
+#endif
+
+    std::mt19937 gen(302);
+    std::uniform_int_distribution<> dis(0, 1000000000);
+    std::vector<int> values(size);
+    for(size_t i = 0; i < size; i++)
+        values[i] = dis(gen);
+
+    std::vector<int> copy(values);
+    printf("\n=====%zu VALUES, %u CORES=====\n", size, std::thread::hardware_concurrency());
+    printf("%-22s %10s %10s\n", "sort", "seconds", "speedup");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::sort(copy.begin(), copy.end());
+    printf("%-22s %10.3f\n", "std::sort", secondsSince(start));
+
+#ifdef SORT_STD_PAR
+    copy = values;
+    start = std::chrono::steady_clock::now();
+    std::sort(std::execution::par, copy.begin(), copy.end());
+    printf("%-22s %10.3f\n", "std::execution::par", secondsSince(start));
+#endif
+
+    double one = 0;
+    for(unsigned threads = 1; threads <= 64; threads *= 2)
+    {
+        WorkStealingPool pool(threads);
+        copy = values;
+
+        start = std::chrono::steady_clock::now();
+        parallelMergeSort(copy.begin(), copy.end(), pool);
+        double seconds = secondsSince(start);
+        if(threads == 1)
+            one = seconds;
+
+        char name[32];
+        snprintf(name, sizeof(name), "parallel, %u threads", threads);
+        printf("%-22s %10.3f %9.2fx %s\n", name, seconds, one / seconds,
+            std::is_sorted(copy.begin(), copy.end()) ? "" : "NOT SORTED");
+    }
+}
 
 int main()
 {
@@ -20,7 +173,9 @@ int main()
         std::cout << std:: endl << "Which sort would you like to test?" << std::endl
                   << "(1) BubbleSort" << std::endl
                   << "(2) MergeSort" << std::endl
-                  << "(3) Quit Program" <<std::endl;
+                  << "(3) Compare Sorts (One Million)" << std::endl
+                  << "(4) Parallel Merge Sort Scalability" << std::endl
+                  << "(5) Quit Program" <<std::endl;
         std::cin >> sortOption;
         switch(sortOption)
         {
@@ -140,6 +295,19 @@ int main()
             break;//END OF CASE 2
 
         case 3:
+            compareSorts(1000000);
+            break;
+
+        case 4:
+            {
+                size_t size = 0;
+                std::cout << "How many values?" << std::endl;
+                std::cin >> size;
+                parallelScalability(size);
+            }
+            break;
+
+        case 5:
             menu = false;
             break;
 
@@ -0,0 +1,720 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: BPlusTree.cpp
+//
+//	$Header: $
+//
+//
+//	Cache-line sized B+-tree.  See BPlusTree.h for the node layout.
+//
+//	Searching within a node is a linear scan.  With only 20 keys per node,
+//	a scan that counts the keys less than (or equal to) the search key has
+//	no unpredictable branches and can be vectorized, which beats a binary
+//	search that mispredicts on nearly every step.
+//
+//	The scans always cover all 20 slots and mask off the unused ones, since
+//	a fixed trip count is what lets the compiler vectorize the loop.  This
+//	is why new nodes clear their key arrays: the unused slots are read,
+//	even though they never affect the result.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "BPlusTree.h"
+#include <string.h>
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LeafPosition()
+//
+//	Returns the number of keys in the leaf that are less than key, which is
+//	where key is (or should be inserted).
+//
+static inline int LeafPosition(const BPTLeaf_t *pLeaf, const int key)
+{
+	int count = pLeaf->Header.Count;
+	int pos   = 0;
+
+	for (int i = 0; i < BPT_LEAF_KEYS; ++i) {
+		pos += (pLeaf->Keys[i] < key) & (i < count);
+	}
+
+	return pos;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ChildIndex()
+//
+//	Returns the index of the child that may contain key.  Since a separator
+//	key is the smallest key of the subtree to its right, this counts the
+//	separators that are less than or equal to key.
+//
+static inline int ChildIndex(const BPTInner_t *pInner, const int key)
+{
+	int count = pInner->Header.Count;
+	int index = 0;
+
+	for (int i = 0; i < BPT_INNER_KEYS; ++i) {
+		index += (pInner->Keys[i] <= key) & (i < count);
+	}
+
+	return index;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	constructor
+//
+BPlusTree::BPlusTree(void)
+	:	m_pRoot(NULL),
+		m_KeyCount(0),
+		m_Slab(BPT_NODE_BYTES, 1024, BPT_CACHE_LINE)
+{
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	destructor
+//
+BPlusTree::~BPlusTree(void)
+{
+	FreeAll();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FreeAll()
+//
+void BPlusTree::FreeAll(void)
+{
+	m_Slab.FreeAll();
+
+	m_pRoot    = NULL;
+	m_KeyCount = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	NewLeaf()
+//
+BPTLeaf_t* BPlusTree::NewLeaf(void)
+{
+	BPTLeaf_t *pLeaf = static_cast<BPTLeaf_t*>(m_Slab.Alloc());
+
+	pLeaf->Header.Count  = 0;
+	pLeaf->Header.IsLeaf = true;
+	pLeaf->pNext         = NULL;
+
+	memset(pLeaf->Keys, 0, sizeof(pLeaf->Keys));
+
+	return pLeaf;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	NewInner()
+//
+BPTInner_t* BPlusTree::NewInner(void)
+{
+	BPTInner_t *pInner = static_cast<BPTInner_t*>(m_Slab.Alloc());
+
+	pInner->Header.Count  = 0;
+	pInner->Header.IsLeaf = false;
+
+	memset(pInner->Keys, 0, sizeof(pInner->Keys));
+
+	return pInner;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LookUp()
+//
+//	If the key is not in the tree, this will return NULL.
+//
+void* BPlusTree::LookUp(const int key)
+{
+	BPTNode_t *pNode = m_pRoot;
+
+	if (NULL == pNode) {
+		return NULL;
+	}
+
+	while (false == pNode->IsLeaf) {
+		BPTInner_t *pInner = reinterpret_cast<BPTInner_t*>(pNode);
+		pNode = pInner->Children[ChildIndex(pInner, key)];
+	}
+
+	BPTLeaf_t *pLeaf = reinterpret_cast<BPTLeaf_t*>(pNode);
+
+	int pos = LeafPosition(pLeaf, key);
+
+	if ((pos < pLeaf->Header.Count) && (key == pLeaf->Keys[pos])) {
+		return pLeaf->Values[pos];
+	}
+
+	return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Insert()
+//
+//	As with the LLRB, inserting a key that is already in the tree replaces
+//	the old value.  When the root splits, a new root is placed above it,
+//	which is the only way the tree gets taller.
+//
+bool BPlusTree::Insert(VoidRef_t ref)
+{
+	if (NULL == m_pRoot) {
+		m_pRoot = &(NewLeaf()->Header);
+	}
+
+	int        splitKey = 0;
+	BPTNode_t *pSplit   = NULL;
+
+	if (InsertRec(m_pRoot, ref, splitKey, pSplit)) {
+		++m_KeyCount;
+	}
+
+	if (NULL != pSplit) {
+		BPTInner_t *pRoot = NewInner();
+		pRoot->Header.Count = 1;
+		pRoot->Keys[0]      = splitKey;
+		pRoot->Children[0]  = m_pRoot;
+		pRoot->Children[1]  = pSplit;
+
+		m_pRoot = &(pRoot->Header);
+	}
+
+	return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertRec()
+//
+//	Returns true if a new key was added (as opposed to replacing a value).
+//
+//	If pNode had to be split, the new right-hand node is returned in pSplit,
+//	along with the key that separates it from pNode.  The caller must then
+//	insert that pair into the parent.
+//
+bool BPlusTree::InsertRec(BPTNode_t *pNode, VoidRef_t ref, int &splitKey, BPTNode_t* &pSplit)
+{
+	pSplit = NULL;
+
+	if (pNode->IsLeaf) {
+		BPTLeaf_t *pLeaf = reinterpret_cast<BPTLeaf_t*>(pNode);
+
+		int count = pLeaf->Header.Count;
+		int pos   = LeafPosition(pLeaf, ref.Key);
+
+		if ((pos < count) && (ref.Key == pLeaf->Keys[pos])) {
+			pLeaf->Values[pos] = ref.pContext;
+			return false;
+		}
+
+		if (count < BPT_LEAF_KEYS) {
+			for (int i = count; i > pos; --i) {
+				pLeaf->Keys[i]   = pLeaf->Keys[i-1];
+				pLeaf->Values[i] = pLeaf->Values[i-1];
+			}
+
+			pLeaf->Keys[pos]   = ref.Key;
+			pLeaf->Values[pos] = ref.pContext;
+			pLeaf->Header.Count = count + 1;
+
+			return true;
+		}
+
+		// The leaf is full.  Lay out all of the keys including the new one,
+		// then give the upper half to a new leaf.
+		int   keys[BPT_LEAF_KEYS + 1];
+		void* values[BPT_LEAF_KEYS + 1];
+
+		for (int i = 0, j = 0; i <= count; ++i) {
+			if (i == pos) {
+				keys[i]   = ref.Key;
+				values[i] = ref.pContext;
+			}
+			else {
+				keys[i]   = pLeaf->Keys[j];
+				values[i] = pLeaf->Values[j];
+				++j;
+			}
+		}
+
+		BPTLeaf_t *pRight = NewLeaf();
+
+		int leftCount  = (count + 1) / 2;
+		int rightCount = (count + 1) - leftCount;
+
+		for (int i = 0; i < leftCount; ++i) {
+			pLeaf->Keys[i]   = keys[i];
+			pLeaf->Values[i] = values[i];
+		}
+
+		for (int i = 0; i < rightCount; ++i) {
+			pRight->Keys[i]   = keys[leftCount + i];
+			pRight->Values[i] = values[leftCount + i];
+		}
+
+		pLeaf->Header.Count  = leftCount;
+		pRight->Header.Count = rightCount;
+
+		pRight->pNext = pLeaf->pNext;
+		pLeaf->pNext  = pRight;
+
+		splitKey = pRight->Keys[0];
+		pSplit   = &(pRight->Header);
+
+		return true;
+	}
+
+	BPTInner_t *pInner = reinterpret_cast<BPTInner_t*>(pNode);
+
+	int        index      = ChildIndex(pInner, ref.Key);
+	int        childKey   = 0;
+	BPTNode_t *pChildNew  = NULL;
+
+	bool added = InsertRec(pInner->Children[index], ref, childKey, pChildNew);
+
+	if (NULL == pChildNew) {
+		return added;
+	}
+
+	int count = pInner->Header.Count;
+
+	if (count < BPT_INNER_KEYS) {
+		for (int i = count; i > index; --i) {
+			pInner->Keys[i]       = pInner->Keys[i-1];
+			pInner->Children[i+1] = pInner->Children[i];
+		}
+
+		pInner->Keys[index]       = childKey;
+		pInner->Children[index+1] = pChildNew;
+		pInner->Header.Count      = count + 1;
+
+		return added;
+	}
+
+	// The interior node is full.  The middle key moves up into the parent
+	// instead of being copied, since interior keys are only separators.
+	int        keys[BPT_INNER_KEYS + 1];
+	BPTNode_t* children[BPT_INNER_KEYS + 2];
+
+	children[0] = pInner->Children[0];
+
+	for (int i = 0, j = 0; i <= count; ++i) {
+		if (i == index) {
+			keys[i]       = childKey;
+			children[i+1] = pChildNew;
+		}
+		else {
+			keys[i]       = pInner->Keys[j];
+			children[i+1] = pInner->Children[j+1];
+			++j;
+		}
+	}
+
+	BPTInner_t *pRight = NewInner();
+
+	int leftCount  = (count + 1) / 2;
+	int rightCount = count - leftCount;
+
+	for (int i = 0; i < leftCount; ++i) {
+		pInner->Keys[i]       = keys[i];
+		pInner->Children[i+1] = children[i+1];
+	}
+
+	pRight->Children[0] = children[leftCount + 1];
+
+	for (int i = 0; i < rightCount; ++i) {
+		pRight->Keys[i]       = keys[leftCount + 1 + i];
+		pRight->Children[i+1] = children[leftCount + 2 + i];
+	}
+
+	pInner->Header.Count = leftCount;
+	pRight->Header.Count = rightCount;
+
+	splitKey = keys[leftCount];
+	pSplit   = &(pRight->Header);
+
+	return added;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Delete()
+//
+//	If the root is an interior node that has been left with a single child,
+//	that child becomes the new root, which is the only way the tree gets
+//	shorter.
+//
+void BPlusTree::Delete(const int key)
+{
+	if (NULL == m_pRoot) {
+		return;
+	}
+
+	if (DeleteRec(m_pRoot, key)) {
+		--m_KeyCount;
+	}
+
+	if (0 == m_pRoot->Count) {
+		BPTNode_t *pOld = m_pRoot;
+
+		if (m_pRoot->IsLeaf) {
+			m_pRoot = NULL;
+		}
+		else {
+			m_pRoot = reinterpret_cast<BPTInner_t*>(m_pRoot)->Children[0];
+		}
+
+		m_Slab.Free(pOld);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteRec()
+//
+//	Returns true if the key was found and removed.  A child that drops below
+//	the minimum number of keys is fixed by its parent on the way back out.
+//
+//	Separator keys are left alone when the key they were copied from is
+//	deleted.  A stale separator still divides the two subtrees correctly.
+//
+bool BPlusTree::DeleteRec(BPTNode_t *pNode, const int key)
+{
+	if (pNode->IsLeaf) {
+		BPTLeaf_t *pLeaf = reinterpret_cast<BPTLeaf_t*>(pNode);
+
+		int count = pLeaf->Header.Count;
+		int pos   = LeafPosition(pLeaf, key);
+
+		if ((pos >= count) || (key != pLeaf->Keys[pos])) {
+			return false;
+		}
+
+		for (int i = pos + 1; i < count; ++i) {
+			pLeaf->Keys[i-1]   = pLeaf->Keys[i];
+			pLeaf->Values[i-1] = pLeaf->Values[i];
+		}
+
+		pLeaf->Header.Count = count - 1;
+
+		return true;
+	}
+
+	BPTInner_t *pInner = reinterpret_cast<BPTInner_t*>(pNode);
+
+	int index = ChildIndex(pInner, key);
+
+	if (false == DeleteRec(pInner->Children[index], key)) {
+		return false;
+	}
+
+	BPTNode_t *pChild = pInner->Children[index];
+
+	if (pChild->Count < (pChild->IsLeaf ? BPT_LEAF_MIN : BPT_INNER_MIN)) {
+		Rebalance(pInner, index);
+	}
+
+	return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Rebalance()
+//
+//	Children[index] of pParent has too few keys.  It is paired with the
+//	sibling to its left (or its right, if it is the first child).  If both
+//	nodes fit into one, the right node is merged into the left one and
+//	removed from the parent.  Otherwise the keys are split evenly between
+//	the two, and the separator in the parent is updated.
+//
+void BPlusTree::Rebalance(BPTInner_t *pParent, int index)
+{
+	int sep = (index > 0) ? (index - 1) : index;
+
+	BPTNode_t *pLeftNode  = pParent->Children[sep];
+	BPTNode_t *pRightNode = pParent->Children[sep + 1];
+
+	bool merged = false;
+
+	if (pLeftNode->IsLeaf) {
+		BPTLeaf_t *pLeft  = reinterpret_cast<BPTLeaf_t*>(pLeftNode);
+		BPTLeaf_t *pRight = reinterpret_cast<BPTLeaf_t*>(pRightNode);
+
+		int leftCount  = pLeft->Header.Count;
+		int rightCount = pRight->Header.Count;
+		int total      = leftCount + rightCount;
+
+		if (total <= BPT_LEAF_KEYS) {
+			for (int i = 0; i < rightCount; ++i) {
+				pLeft->Keys[leftCount + i]   = pRight->Keys[i];
+				pLeft->Values[leftCount + i] = pRight->Values[i];
+			}
+
+			pLeft->Header.Count = total;
+			pLeft->pNext        = pRight->pNext;
+
+			merged = true;
+		}
+		else {
+			int   keys[2 * BPT_LEAF_KEYS];
+			void* values[2 * BPT_LEAF_KEYS];
+
+			for (int i = 0; i < leftCount; ++i) {
+				keys[i]   = pLeft->Keys[i];
+				values[i] = pLeft->Values[i];
+			}
+
+			for (int i = 0; i < rightCount; ++i) {
+				keys[leftCount + i]   = pRight->Keys[i];
+				values[leftCount + i] = pRight->Values[i];
+			}
+
+			leftCount  = total / 2;
+			rightCount = total - leftCount;
+
+			for (int i = 0; i < leftCount; ++i) {
+				pLeft->Keys[i]   = keys[i];
+				pLeft->Values[i] = values[i];
+			}
+
+			for (int i = 0; i < rightCount; ++i) {
+				pRight->Keys[i]   = keys[leftCount + i];
+				pRight->Values[i] = values[leftCount + i];
+			}
+
+			pLeft->Header.Count  = leftCount;
+			pRight->Header.Count = rightCount;
+
+			pParent->Keys[sep] = pRight->Keys[0];
+		}
+	}
+	else {
+		BPTInner_t *pLeft  = reinterpret_cast<BPTInner_t*>(pLeftNode);
+		BPTInner_t *pRight = reinterpret_cast<BPTInner_t*>(pRightNode);
+
+		int leftCount  = pLeft->Header.Count;
+		int rightCount = pRight->Header.Count;
+
+		// The separator from the parent comes down between the two nodes.
+		int total = leftCount + 1 + rightCount;
+
+		if (total <= BPT_INNER_KEYS) {
+			pLeft->Keys[leftCount] = pParent->Keys[sep];
+
+			for (int i = 0; i < rightCount; ++i) {
+				pLeft->Keys[leftCount + 1 + i] = pRight->Keys[i];
+			}
+
+			for (int i = 0; i <= rightCount; ++i) {
+				pLeft->Children[leftCount + 1 + i] = pRight->Children[i];
+			}
+
+			pLeft->Header.Count = total;
+
+			merged = true;
+		}
+		else {
+			int        keys[2 * BPT_INNER_KEYS + 1];
+			BPTNode_t* children[2 * BPT_INNER_KEYS + 2];
+
+			for (int i = 0; i < leftCount; ++i) {
+				keys[i] = pLeft->Keys[i];
+			}
+
+			keys[leftCount] = pParent->Keys[sep];
+
+			for (int i = 0; i < rightCount; ++i) {
+				keys[leftCount + 1 + i] = pRight->Keys[i];
+			}
+
+			for (int i = 0; i <= leftCount; ++i) {
+				children[i] = pLeft->Children[i];
+			}
+
+			for (int i = 0; i <= rightCount; ++i) {
+				children[leftCount + 1 + i] = pRight->Children[i];
+			}
+
+			// One key goes back up to the parent.
+			leftCount  = (total - 1) / 2;
+			rightCount = (total - 1) - leftCount;
+
+			for (int i = 0; i < leftCount; ++i) {
+				pLeft->Keys[i] = keys[i];
+			}
+
+			for (int i = 0; i <= leftCount; ++i) {
+				pLeft->Children[i] = children[i];
+			}
+
+			pParent->Keys[sep] = keys[leftCount];
+
+			for (int i = 0; i < rightCount; ++i) {
+				pRight->Keys[i] = keys[leftCount + 1 + i];
+			}
+
+			for (int i = 0; i <= rightCount; ++i) {
+				pRight->Children[i] = children[leftCount + 1 + i];
+			}
+
+			pLeft->Header.Count  = leftCount;
+			pRight->Header.Count = rightCount;
+		}
+	}
+
+	if (merged) {
+		int count = pParent->Header.Count;
+
+		for (int i = sep + 1; i < count; ++i) {
+			pParent->Keys[i-1]   = pParent->Keys[i];
+			pParent->Children[i] = pParent->Children[i+1];
+		}
+
+		pParent->Header.Count = count - 1;
+
+		m_Slab.Free(pRightNode);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SanityCheck()
+//
+//	Verifies the ordering of every key, that every leaf is at the same
+//	depth, that nodes other than the root are at least half full, that the
+//	leaf chain visits the keys in order, and that the key count is right.
+//
+bool BPlusTree::SanityCheck(void)
+{
+	if (NULL == m_pRoot) {
+		return (0 == m_KeyCount);
+	}
+
+	int leafDepth = -1;
+	int tally     = 0;
+
+	if (false == SanityCheckRec(m_pRoot, false, 0, false, 0, 0, leafDepth, tally)) {
+		return false;
+	}
+
+	if (tally != m_KeyCount) {
+		return false;
+	}
+
+	// Find the first leaf, then walk the chain.
+	BPTNode_t *pNode = m_pRoot;
+	while (false == pNode->IsLeaf) {
+		pNode = reinterpret_cast<BPTInner_t*>(pNode)->Children[0];
+	}
+
+	int  chained = 0;
+	bool hasPrev = false;
+	int  prev    = 0;
+
+	for (BPTLeaf_t *pLeaf = reinterpret_cast<BPTLeaf_t*>(pNode); NULL != pLeaf; pLeaf = pLeaf->pNext) {
+		for (int i = 0; i < pLeaf->Header.Count; ++i) {
+			if (hasPrev && (prev >= pLeaf->Keys[i])) {
+				return false;
+			}
+
+			prev    = pLeaf->Keys[i];
+			hasPrev = true;
+			++chained;
+		}
+	}
+
+	return (chained == m_KeyCount);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SanityCheckRec()
+//
+//	All keys in the subtree must be in the range [lo, hi).
+//
+bool BPlusTree::SanityCheckRec(BPTNode_t *pNode, bool hasLo, int lo, bool hasHi, int hi, int depth, int &leafDepth, int &tally)
+{
+	bool isRoot = (pNode == m_pRoot);
+
+	if (pNode->IsLeaf) {
+		BPTLeaf_t *pLeaf = reinterpret_cast<BPTLeaf_t*>(pNode);
+
+		if ((false == isRoot) && (pLeaf->Header.Count < BPT_LEAF_MIN)) {
+			return false;
+		}
+
+		if (leafDepth < 0) {
+			leafDepth = depth;
+		}
+		else if (leafDepth != depth) {
+			return false;
+		}
+
+		for (int i = 0; i < pLeaf->Header.Count; ++i) {
+			int key = pLeaf->Keys[i];
+
+			if ((i > 0) && (pLeaf->Keys[i-1] >= key)) {
+				return false;
+			}
+
+			if ((hasLo && (key < lo)) || (hasHi && (key >= hi))) {
+				return false;
+			}
+		}
+
+		tally += pLeaf->Header.Count;
+
+		return true;
+	}
+
+	BPTInner_t *pInner = reinterpret_cast<BPTInner_t*>(pNode);
+
+	int count = pInner->Header.Count;
+
+	if (count < (isRoot ? 1 : BPT_INNER_MIN)) {
+		return false;
+	}
+
+	for (int i = 0; i <= count; ++i) {
+		bool childHasLo = (i > 0)     ? true                : hasLo;
+		int  childLo    = (i > 0)     ? pInner->Keys[i-1]   : lo;
+		bool childHasHi = (i < count) ? true                : hasHi;
+		int  childHi    = (i < count) ? pInner->Keys[i]     : hi;
+
+		if ((i > 0) && (i < count) && (pInner->Keys[i-1] >= pInner->Keys[i])) {
+			return false;
+		}
+
+		if (false == SanityCheckRec(pInner->Children[i], childHasLo, childLo, childHasHi, childHi, depth + 1, leafDepth, tally)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
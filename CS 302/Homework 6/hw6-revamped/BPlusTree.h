@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: BPlusTree.h
+//
+//	$Header: $
+//
+//
+//	B+-tree with the same Insert()/LookUp()/Delete() interface as
+//	LeftLeaningRedBlack, so the two can be swapped in the benchmarks.
+//
+//	The LLRB touches one 40-byte node for every comparison, and each of
+//	those nodes is likely to be on a different cache line.  A B+-tree packs
+//	many keys into each node instead, so a search only touches a handful of
+//	nodes, and the keys within a node are scanned linearly from memory that
+//	is already in cache.  Each node is exactly BPT_NODE_BYTES bytes, and is
+//	aligned to a cache line so that it never straddles more lines than it
+//	has to.
+//
+//	All of the key/value pairs are stored in the leaves.  Interior nodes
+//	only hold separator keys, which are copies of the smallest key in the
+//	subtree to their right.  The leaves are also linked together in sorted
+//	order.
+//
+//	Nodes are kept at least half full.  When a deletion leaves a node below
+//	that, it either borrows keys from a neighbor or is merged into it.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include "VoidRef.h"
+#include "SlabAllocator.h"
+#include <cstddef>
+
+
+#define BPT_CACHE_LINE		64
+
+// Every node occupies four cache lines.  With 4-byte keys and 8-byte
+// pointers, that leaves room for 20 keys in both kinds of node once the
+// header and the leaf link (or the extra child pointer) are accounted for.
+#define BPT_NODE_BYTES		256
+#define BPT_LEAF_KEYS		20
+#define BPT_INNER_KEYS		20
+
+// Nodes other than the root must hold at least this many keys.
+#define BPT_LEAF_MIN		(BPT_LEAF_KEYS / 2)
+#define BPT_INNER_MIN		(BPT_INNER_KEYS / 2)
+
+
+// Common header at the start of both types of node.
+struct BPTNode_t
+{
+	int Count;
+	int IsLeaf;
+};
+
+
+// Keys are placed before the values so that a search only has to touch the
+// first two cache lines of the node.
+struct BPTLeaf_t
+{
+	BPTNode_t  Header;
+	int        Keys[BPT_LEAF_KEYS];
+	void*      Values[BPT_LEAF_KEYS];
+	BPTLeaf_t* pNext;
+};
+
+
+// Children[i] holds keys less than Keys[i].  Children[i+1] holds keys that
+// are greater than or equal to Keys[i].
+struct BPTInner_t
+{
+	BPTNode_t  Header;
+	int        Keys[BPT_INNER_KEYS];
+	BPTNode_t* Children[BPT_INNER_KEYS + 1];
+};
+
+
+static_assert(sizeof(BPTLeaf_t)  <= BPT_NODE_BYTES, "BPTLeaf_t does not fit in a node");
+static_assert(sizeof(BPTInner_t) <= BPT_NODE_BYTES, "BPTInner_t does not fit in a node");
+
+
+class BPlusTree
+{
+private:
+	BPTNode_t*    m_pRoot;
+	int           m_KeyCount;
+	SlabAllocator m_Slab;
+
+	BPTLeaf_t*  NewLeaf(void);
+	BPTInner_t* NewInner(void);
+
+	bool InsertRec(BPTNode_t *pNode, VoidRef_t ref, int &splitKey, BPTNode_t* &pSplit);
+	bool DeleteRec(BPTNode_t *pNode, const int key);
+	void Rebalance(BPTInner_t *pParent, int index);
+
+	bool SanityCheckRec(BPTNode_t *pNode, bool hasLo, int lo, bool hasHi, int hi, int depth, int &leafDepth, int &tally);
+
+public:
+	BPlusTree(void);
+	~BPlusTree(void);
+
+	bool IsEmpty(void) { return NULL == m_pRoot; }
+
+	void FreeAll(void);
+
+	void* LookUp(const int key);
+
+	bool Insert(VoidRef_t ref);
+	void Delete(const int key);
+
+	int  KeyCount(void) { return m_KeyCount; }
+
+	bool SanityCheck(void);
+
+	static size_t NodeSize(void) { return BPT_NODE_BYTES; }
+};
+
+
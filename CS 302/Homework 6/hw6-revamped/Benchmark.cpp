@@ -0,0 +1,1163 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: Benchmark.cpp
+//
+//	$Header: $
+//
+//
+//	Timing tests for the balanced tree code.  All of the tests use a fixed
+//	random seed so that runs can be compared against each other.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "Benchmark.h"
+#include "LeftLeaningRedBlack.h"
+#include "LeftLeaningRedBlackMap.h"
+#include "ConcurrentLeftLeaningRedBlack.h"
+#include "BPlusTree.h"
+#include "LLRBSnapshot.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchRandom()
+//
+//	Small xorshift generator.  rand() only returns 15 bits on some
+//	platforms, which is not enough to fill a tree with millions of keys.
+//
+static unsigned int BenchRandom(unsigned int &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	return state;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchMilliseconds()
+//
+static double BenchMilliseconds(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	AllocatorRun()
+//
+//	Fills a tree, churns it with an equal number of delete/insert pairs,
+//	then throws the whole thing away.  Each phase is timed separately,
+//	since the slab allocator is expected to help the churn and free phases
+//	the most.
+//
+static void AllocatorRun(bool useSlab, int keyCount)
+{
+	std::vector<int> keys(keyCount);
+
+	unsigned int seed = 123456;
+	for (int i = 0; i < keyCount; ++i) {
+		keys[i] = int(BenchRandom(seed) & 0x7FFFFFFF);
+	}
+
+	LeftLeaningRedBlack tree(useSlab);
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < keyCount; ++i) {
+		ref.Key = keys[i];
+		tree.Insert(ref);
+	}
+
+	double insertTime = BenchMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+
+	// Replace each key with a new random key.  This recycles nodes through
+	// the free list, which is the pattern that was hurting the most.
+	for (int i = 0; i < keyCount; ++i) {
+		tree.Delete(keys[i]);
+
+		keys[i] = int(BenchRandom(seed) & 0x7FFFFFFF);
+		ref.Key = keys[i];
+		tree.Insert(ref);
+	}
+
+	double churnTime = BenchMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+
+	tree.FreeAll();
+
+	double freeTime = BenchMilliseconds(start);
+
+	printf("%-6s %10d %12.2f %12.2f %12.2f\n",
+		(useSlab ? "slab" : "new"), keyCount, insertTime, churnTime, freeTime);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkAllocator()
+//
+//	Compares the slab allocator against allocating every node with new.
+//
+void BenchmarkAllocator(void)
+{
+	printf("\nNode allocator (times in ms)\n");
+	printf("%-6s %10s %12s %12s %12s\n", "alloc", "keys", "insert", "churn", "free all");
+	printf("----------------------------------------------------------\n");
+
+	for (int keyCount = 10000; keyCount <= 1000000; keyCount *= 10) {
+		AllocatorRun(false, keyCount);
+		AllocatorRun(true,  keyCount);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FillKeyStream()
+//
+//	Generates one of the key orders used by BenchmarkOperations().  Stream 3
+//	alternates between the low and high ends of the key range, so every
+//	insertion lands on the far left or far right spine of the tree.
+//
+static void FillKeyStream(std::vector<int> &keys, int stream)
+{
+	unsigned int seed  = 123456;
+	int          count = int(keys.size());
+
+	for (int i = 0; i < count; ++i) {
+		switch (stream) {
+			case 0:  keys[i] = int(BenchRandom(seed) & 0x7FFFFFFF);       break;
+			case 1:  keys[i] = i;                                         break;
+			case 3:  keys[i] = (i & 1) ? (count - 1 - (i / 2)) : (i / 2); break;
+			default: keys[i] = count - i;                                 break;
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LookUpPercentile()
+//
+//	Returns the smallest number of nodes visited that covers the given
+//	fraction of the look-ups recorded in stats.
+//
+static int LookUpPercentile(const LLRBStats_t &stats, double fraction)
+{
+	double    target = stats.LookUps * fraction;
+	long long tally  = 0;
+
+	for (int n = 0; n <= LLRB_MAX_DEPTH; ++n) {
+		tally += stats.LookUpNodes[n];
+
+		if (tally >= target) {
+			return n;
+		}
+	}
+
+	return LLRB_MAX_DEPTH;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkOperations()
+//
+//	Reports operations per second for insert, look-up and delete on
+//	random, sequential and reverse-sequential key streams.  Whether the
+//	tree uses the recursive or the iterative code is decided at compile
+//	time by USE_ITERATIVE_LLRB in LLRBCore.h, which also applies to
+//	LeftLeaningRedBlackMap, so build the program both ways to compare them.
+//
+//	When USE_LLRB_STATS is defined, this also reports the average, 99th
+//	percentile and worst-case number of nodes visited per look-up.
+//
+void BenchmarkOperations(void)
+{
+	const char* streamNames[] = { "random", "sequential", "reverse" };
+	const int   keyCount      = 1000000;
+
+	printf("\nTree operations, %d keys (Mops/sec)\n", keyCount);
+	printf("%-12s %10s %10s %10s %8s %8s %8s\n", "stream", "insert", "lookup", "delete", "avg vis", "p99 vis", "max vis");
+	printf("------------------------------------------------------------------------\n");
+
+	std::vector<int> keys(keyCount);
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	for (int stream = 0; stream < int(ArraySize(streamNames)); ++stream) {
+		FillKeyStream(keys, stream);
+
+		LeftLeaningRedBlack tree;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < keyCount; ++i) {
+			ref.Key = keys[i];
+			tree.Insert(ref);
+		}
+
+		double insertTime = BenchMilliseconds(start);
+
+		tree.ResetStats();
+		start = std::chrono::steady_clock::now();
+
+		int found = 0;
+		for (int i = 0; i < keyCount; ++i) {
+			if (NULL != tree.LookUp(keys[i])) {
+				++found;
+			}
+		}
+
+		double      lookUpTime  = BenchMilliseconds(start);
+		LLRBStats_t lookUpStats = tree.Stats();
+
+		start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < keyCount; ++i) {
+			tree.Delete(keys[i]);
+		}
+
+		double deleteTime = BenchMilliseconds(start);
+
+		// Ops per millisecond / 1000 gives millions of ops per second.
+		printf("%-12s %10.2f %10.2f %10.2f %8.2f %8d %8d\n", streamNames[stream],
+			keyCount / insertTime / 1000.0,
+			found    / lookUpTime / 1000.0,
+			keyCount / deleteTime / 1000.0,
+			double(lookUpStats.LookUpNodeTotal) / Max(lookUpStats.LookUps, 1LL),
+			LookUpPercentile(lookUpStats, 0.99),
+			LookUpPercentile(lookUpStats, 1.0));
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkMap()
+//
+//	Compares look-up speed of the VoidRef_t tree against the templated map,
+//	which stores the value inline and packs the color into a pointer.  The
+//	VoidRef_t look-up has to follow pContext to reach the value, so that
+//	dereference is included in the timing for a fair comparison.
+//
+void BenchmarkMap(void)
+{
+	const int keyCount = 1000000;
+
+	printf("\nNode size: LLTB_t = %d bytes, map<int,int> = %d bytes, map<int,void*> = %d bytes\n",
+		int(sizeof(LLTB_t)),
+		int(LeftLeaningRedBlackMap<int, int>::NodeSize()),
+		int(LeftLeaningRedBlackMap<int, void*>::NodeSize()));
+
+	std::vector<int> keys(keyCount);
+	std::vector<int> values(keyCount);
+	FillKeyStream(keys, 0);
+
+	LeftLeaningRedBlack          tree;
+	LeftLeaningRedBlackMap<int, int> map;
+
+	VoidRef_t ref;
+	for (int i = 0; i < keyCount; ++i) {
+		values[i]    = i;
+		ref.Key      = keys[i];
+		ref.pContext = &values[i];
+		tree.Insert(ref);
+		map.Insert(keys[i], i);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	long long sum1 = 0;
+	for (int i = 0; i < keyCount; ++i) {
+		int *pValue = reinterpret_cast<int*>(tree.LookUp(keys[i]));
+		sum1 += *pValue;
+	}
+
+	double treeTime = BenchMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+
+	long long sum2 = 0;
+	for (int i = 0; i < keyCount; ++i) {
+		sum2 += *map.LookUp(keys[i]);
+	}
+
+	double mapTime = BenchMilliseconds(start);
+
+	printf("%-24s %10.2f Mops/sec\n", "LeftLeaningRedBlack", keyCount / treeTime / 1000.0);
+	printf("%-24s %10.2f Mops/sec\n", "LeftLeaningRedBlackMap", keyCount / mapTime / 1000.0);
+
+	// Guard against the compiler discarding the look-ups.
+	if (sum1 != sum2) {
+		printf("value mismatch: %lld != %lld\n", sum1, sum2);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkBulkBuild()
+//
+//	Compares rebuilding a tree from sorted keys with Insert() against
+//	BulkBuild(), and times merging a sorted batch into an existing tree.
+//
+void BenchmarkBulkBuild(void)
+{
+	printf("\nBuild from sorted keys (times in ms)\n");
+	printf("%10s %12s %12s %12s\n", "keys", "insert", "bulk build", "bulk merge");
+	printf("---------------------------------------------------\n");
+
+	int dummy;
+
+	for (int keyCount = 10000; keyCount <= 10000000; keyCount *= 10) {
+		std::vector<VoidRef_t> refs(keyCount);
+
+		// Even keys go into the tree, odd keys are merged in afterwards.
+		for (int i = 0; i < keyCount; ++i) {
+			refs[i].Key      = i * 2;
+			refs[i].pContext = &dummy;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		LeftLeaningRedBlack inserted;
+		for (int i = 0; i < keyCount; ++i) {
+			inserted.Insert(refs[i]);
+		}
+
+		double insertTime = BenchMilliseconds(start);
+
+		inserted.FreeAll();
+
+		start = std::chrono::steady_clock::now();
+
+		LeftLeaningRedBlack built(&refs[0], keyCount);
+
+		double buildTime = BenchMilliseconds(start);
+
+		for (int i = 0; i < keyCount; ++i) {
+			refs[i].Key = (i * 2) + 1;
+		}
+
+		start = std::chrono::steady_clock::now();
+
+		built.BulkMerge(&refs[0], keyCount);
+
+		double mergeTime = BenchMilliseconds(start);
+
+		printf("%10d %12.2f %12.2f %12.2f\n", keyCount, insertTime, buildTime, mergeTime);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkRangeScan()
+//
+//	Sums the keys in a series of ranges, once by probing every key in the
+//	range with LookUp(), once by walking iterators from lower_bound(), and
+//	once with ForEachInRange().
+//
+void BenchmarkRangeScan(void)
+{
+	const int keyCount  = 1000000;
+	const int scanCount = 1000;
+
+	int dummy;
+	std::vector<VoidRef_t> refs(keyCount);
+
+	// Every third key is present, so two thirds of the probes miss.
+	for (int i = 0; i < keyCount; ++i) {
+		refs[i].Key      = i * 3;
+		refs[i].pContext = &dummy;
+	}
+
+	LeftLeaningRedBlack tree(&refs[0], keyCount);
+
+	printf("\nRange scan, %d keys, %d scans (times in ms)\n", keyCount, scanCount);
+	printf("%10s %12s %12s %12s\n", "width", "lookup", "iterator", "for each");
+	printf("---------------------------------------------------\n");
+
+	for (int width = 10; width <= 100000; width *= 10) {
+		unsigned int seed = 123456;
+		std::vector<int> starts(scanCount);
+		for (int i = 0; i < scanCount; ++i) {
+			starts[i] = int(BenchRandom(seed) % unsigned(keyCount * 3 - width));
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		long long sum1 = 0;
+		for (int i = 0; i < scanCount; ++i) {
+			for (int key = starts[i]; key < starts[i] + width; ++key) {
+				if (NULL != tree.LookUp(key)) {
+					sum1 += key;
+				}
+			}
+		}
+
+		double lookUpTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		long long sum2 = 0;
+		for (int i = 0; i < scanCount; ++i) {
+			int hi = starts[i] + width;
+			for (LLRBIterator it = tree.lower_bound(starts[i]); it != tree.end() && it->Key < hi; ++it) {
+				sum2 += it->Key;
+			}
+		}
+
+		double iteratorTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		long long sum3 = 0;
+		for (int i = 0; i < scanCount; ++i) {
+			tree.ForEachInRange(starts[i], starts[i] + width,
+				[&sum3](const VoidRef_t &ref) { sum3 += ref.Key; });
+		}
+
+		double forEachTime = BenchMilliseconds(start);
+
+		printf("%10d %12.2f %12.2f %12.2f\n", width, lookUpTime, iteratorTime, forEachTime);
+
+		if ((sum1 != sum2) || (sum1 != sum3)) {
+			printf("sum mismatch: %lld %lld %lld\n", sum1, sum2, sum3);
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkRankSelect()
+//
+//	Times the order-statistic queries: the rank of random keys, and the key
+//	at each percentile.  Whether these are O(log n) or O(n) depends on
+//	USE_LLRB_SUBTREE_SIZE, so build the program both ways to compare them.
+//
+void BenchmarkRankSelect(void)
+{
+	const int queryCount = 100000;
+
+	printf("\nOrder statistics, %d queries (Mops/sec)\n", queryCount);
+	printf("%10s %12s %12s %12s\n", "keys", "key count", "rank", "select");
+	printf("---------------------------------------------------\n");
+
+	for (int keyCount = 1000; keyCount <= 1000000; keyCount *= 10) {
+		std::vector<int> keys(keyCount);
+		FillKeyStream(keys, 0);
+
+		LeftLeaningRedBlack tree;
+
+		int dummy;
+		VoidRef_t ref;
+		ref.pContext = &dummy;
+
+		for (int i = 0; i < keyCount; ++i) {
+			ref.Key = keys[i];
+			tree.Insert(ref);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		long long sum = 0;
+		for (int i = 0; i < queryCount; ++i) {
+			sum += tree.KeyCount();
+		}
+
+		double countTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < queryCount; ++i) {
+			sum += tree.Rank(keys[i % keyCount]);
+		}
+
+		double rankTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		int total = tree.KeyCount();
+		for (int i = 0; i < queryCount; ++i) {
+			sum += tree.Select(int((long long)(total - 1) * (i % 101) / 100))->Key;
+		}
+
+		double selectTime = BenchMilliseconds(start);
+
+		printf("%10d %12.2f %12.2f %12.2f\n", keyCount,
+			queryCount / countTime  / 1000.0,
+			queryCount / rankTime   / 1000.0,
+			queryCount / selectTime / 1000.0);
+
+		// Guard against the compiler discarding the queries.
+		if (0 == sum) {
+			printf("no keys\n");
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SplitPolicyRun()
+//
+//	Inserts, looks up and then deletes every key in one tree, and prints
+//	the throughput of each phase along with the number of rotations and
+//	color flips applied per insertion and per deletion.
+//
+template <class Policy>
+static void SplitPolicyRun(const char *streamName, const std::vector<int> &keys)
+{
+	int keyCount = int(keys.size());
+
+	LeftLeaningRedBlackT<Policy> tree;
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < keyCount; ++i) {
+		ref.Key = keys[i];
+		tree.Insert(ref);
+	}
+
+	double      insertTime  = BenchMilliseconds(start);
+	LLRBStats_t insertStats = tree.Stats();
+
+	// Every leaf of a valid tree has the same black depth.
+	LLRBDepthHistogram_t hist;
+	tree.DepthHistogram(hist);
+	if (hist.MinBlackDepth != hist.MaxBlackDepth) {
+		printf("black depth mismatch: %d != %d\n", hist.MinBlackDepth, hist.MaxBlackDepth);
+	}
+
+	start = std::chrono::steady_clock::now();
+
+	int found = 0;
+	for (int i = 0; i < keyCount; ++i) {
+		if (NULL != tree.LookUp(keys[i])) {
+			++found;
+		}
+	}
+
+	double lookUpTime = BenchMilliseconds(start);
+
+	tree.ResetStats();
+	start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < keyCount; ++i) {
+		tree.Delete(keys[i]);
+	}
+
+	double      deleteTime  = BenchMilliseconds(start);
+	LLRBStats_t deleteStats = tree.Stats();
+
+	printf("%-12s %-6s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+		streamName, Policy::Name(),
+		keyCount / insertTime / 1000.0,
+		found    / lookUpTime / 1000.0,
+		keyCount / deleteTime / 1000.0,
+		double(insertStats.RotateLeft + insertStats.RotateRight) / keyCount,
+		double(insertStats.ColorFlip) / keyCount,
+		double(deleteStats.RotateLeft + deleteStats.RotateRight) / keyCount,
+		double(deleteStats.ColorFlip) / keyCount);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkSplitPolicy()
+//
+//	Runs the 2-3 and 2-3-4 trees side by side on each of the key streams.
+//	The rotation and flip counts are per operation, and show how much of
+//	any difference in speed comes from the amount of rebalancing.
+//
+void BenchmarkSplitPolicy(void)
+{
+	const char* streamNames[] = { "random", "sequential", "reverse", "interleaved" };
+	const int   keyCount      = 1000000;
+
+	printf("\nSplit policy, %d keys (Mops/sec, rebalancing per op)\n", keyCount);
+	printf("%-12s %-6s %8s %8s %8s %8s %8s %8s %8s\n", "stream", "tree",
+		"insert", "lookup", "delete", "ins rot", "ins flip", "del rot", "del flip");
+	printf("--------------------------------------------------------------------------------\n");
+
+	// A tree of one key is a single black leaf.
+	LeftLeaningRedBlack  single;
+	LLRBDepthHistogram_t hist;
+	VoidRef_t            ref;
+	ref.Key      = 0;
+	ref.pContext = &ref;
+	single.Insert(ref);
+	single.DepthHistogram(hist);
+	if ((1 != hist.Height) || (1 != hist.MinBlackDepth) || (1 != hist.MaxBlackDepth)) {
+		printf("one key histogram: height %d, black depth %d to %d\n",
+			hist.Height, hist.MinBlackDepth, hist.MaxBlackDepth);
+	}
+
+	std::vector<int> keys(keyCount);
+
+	for (int stream = 0; stream < int(ArraySize(streamNames)); ++stream) {
+		FillKeyStream(keys, stream);
+
+		SplitPolicyRun<LLRB23Policy>(streamNames[stream], keys);
+		SplitPolicyRun<LLRB234Policy>(streamNames[stream], keys);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkSnapshot()
+//
+//	Compares the ways of getting a tree back after a restart: inserting
+//	every key again, reading the whole snapshot file into a buffer (which
+//	is what QzReadFileToBuffer() does), mapping the snapshot and searching
+//	it in place, and loading the mapped snapshot into a mutable tree.
+//	The snapshot file is written to the current directory and removed when
+//	the test is done.
+//
+void BenchmarkSnapshot(void)
+{
+	const char* filename   = "benchmark.llrbsnap";
+	const int   queryCount = 1000000;
+
+	printf("\nSnapshot restore (ms, look-ups in Mops/sec)\n");
+	printf("%10s %9s %9s %9s %9s %9s %9s %9s\n", "keys", "insert", "save", "read all", "map", "load",
+		"map look", "tree look");
+	printf("--------------------------------------------------------------------------------------\n");
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	for (int keyCount = 10000; keyCount <= 1000000; keyCount *= 10) {
+		std::vector<int> keys(keyCount);
+		FillKeyStream(keys, 0);
+
+		LeftLeaningRedBlack tree;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < keyCount; ++i) {
+			ref.Key = keys[i];
+			tree.Insert(ref);
+		}
+
+		double insertTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		if (false == tree.SaveSnapshot(filename)) {
+			printf("could not write %s\n", filename);
+			return;
+		}
+
+		double saveTime = BenchMilliseconds(start);
+
+		// Read the entire file into memory, the same way as
+		// QzReadFileToBuffer().  Nothing can be searched until this has
+		// finished.
+		start = std::chrono::steady_clock::now();
+
+		FILE *pFile = fopen(filename, "rb");
+		fseek(pFile, 0, SEEK_END);
+		long byteCount = ftell(pFile);
+		fseek(pFile, 0, SEEK_SET);
+
+		unsigned char *pBuffer = new unsigned char[byteCount];
+		size_t         readCount = fread(pBuffer, 1, byteCount, pFile);
+		fclose(pFile);
+
+		double readTime = BenchMilliseconds(start);
+
+		SafeDeleteArray(pBuffer);
+
+		start = std::chrono::steady_clock::now();
+
+		LLRBSnapshot snapshot;
+		snapshot.Open(filename);
+
+		double mapTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		int found = 0;
+		for (int i = 0; i < queryCount; ++i) {
+			if (NULL != snapshot.LookUp(keys[i % keyCount])) {
+				++found;
+			}
+		}
+
+		double mapLookUpTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		LeftLeaningRedBlack restored;
+		restored.LoadSnapshot(snapshot);
+
+		double loadTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < queryCount; ++i) {
+			if (NULL != restored.LookUp(keys[i % keyCount])) {
+				++found;
+			}
+		}
+
+		double treeLookUpTime = BenchMilliseconds(start);
+
+		printf("%10d %9.2f %9.2f %9.2f %9.3f %9.2f %9.2f %9.2f\n", keyCount,
+			insertTime, saveTime, readTime, mapTime, loadTime,
+			queryCount / mapLookUpTime  / 1000.0,
+			queryCount / treeLookUpTime / 1000.0);
+
+		if ((2 * queryCount != found) || (size_t(byteCount) != readCount)) {
+			printf("snapshot does not match the tree\n");
+		}
+
+		snapshot.Close();
+		remove(filename);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkLookUpBatch()
+//
+//	Compares a loop over LookUp() against LookUpBatch() for random keys,
+//	with tree sizes running from one that fits in the last level cache to
+//	several times larger.  The trees are built with BulkBuild() so that
+//	the largest ones do not take minutes to set up.  Half of the queries
+//	are for keys that are not in the tree.
+//
+void BenchmarkLookUpBatch(void)
+{
+	const int queryCount = 4000000;
+
+	printf("\nBatched look-ups, %d random queries (Mops/sec)\n", queryCount);
+	printf("%10s %10s %10s %10s %8s\n", "keys", "tree MB", "LookUp", "batch", "speedup");
+	printf("----------------------------------------------------\n");
+
+	int dummy;
+
+	std::vector<int>   queries(queryCount);
+	std::vector<void*> results(queryCount);
+
+	for (int keyCount = 100000; keyCount <= 16000000; keyCount *= 4) {
+		// Even keys are in the tree, so odd queries will miss.
+		std::vector<VoidRef_t> refs(keyCount);
+		for (int i = 0; i < keyCount; ++i) {
+			refs[i].Key      = 2 * i;
+			refs[i].pContext = &dummy;
+		}
+
+		LeftLeaningRedBlack tree;
+		tree.BulkBuild(&refs[0], keyCount);
+
+		refs.clear();
+		refs.shrink_to_fit();
+
+		unsigned int seed = 98765;
+		for (int i = 0; i < queryCount; ++i) {
+			queries[i] = int(BenchRandom(seed) % (2 * (unsigned int)keyCount));
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		int singleFound = 0;
+		for (int i = 0; i < queryCount; ++i) {
+			if (NULL != tree.LookUp(queries[i])) {
+				++singleFound;
+			}
+		}
+
+		double singleTime = BenchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+
+		tree.LookUpBatch(&queries[0], &results[0], queryCount);
+
+		double batchTime = BenchMilliseconds(start);
+
+		int batchFound = 0;
+		for (int i = 0; i < queryCount; ++i) {
+			if (NULL != results[i]) {
+				++batchFound;
+			}
+		}
+
+		printf("%10d %10.1f %10.2f %10.2f %7.2fx\n", keyCount,
+			double(keyCount) * sizeof(LLTB_t) / (1024.0 * 1024.0),
+			queryCount / singleTime / 1000.0,
+			queryCount / batchTime  / 1000.0,
+			singleTime / batchTime);
+
+		if (singleFound != batchFound) {
+			printf("batch found %d keys, LookUp() found %d\n", batchFound, singleFound);
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MixedWorkload()
+//
+//	Runs opCount operations on each of threadCount threads, where one in
+//	every twenty operations is a write (alternating insert and delete) and
+//	the rest are look-ups.  The callbacks hide which tree is being tested.
+//	The look-up callback is also given the thread index, so each thread can
+//	use its own reader slot.  Returns the elapsed time in milliseconds.
+//
+template <class LookUpFn, class InsertFn, class DeleteFn>
+static double MixedWorkload(int threadCount, int opCount, int keyRange,
+	LookUpFn lookUp, InsertFn insert, DeleteFn remove)
+{
+	std::vector<std::thread> threads;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int t = 0; t < threadCount; ++t) {
+		threads.push_back(std::thread([=]() {
+			unsigned int seed = 123456 + (t * 7919);
+			int          dummy;
+			VoidRef_t    ref;
+			ref.pContext = &dummy;
+
+			for (int i = 0; i < opCount; ++i) {
+				int key = int(BenchRandom(seed) % unsigned(keyRange));
+
+				if (0 == (i % 20)) {
+					if (0 == (i % 40)) {
+						ref.Key = key;
+						insert(ref);
+					}
+					else {
+						remove(key);
+					}
+				}
+				else {
+					lookUp(t, key);
+				}
+			}
+		}));
+	}
+
+	for (size_t t = 0; t < threads.size(); ++t) {
+		threads[t].join();
+	}
+
+	return BenchMilliseconds(start);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkConcurrent()
+//
+//	Compares a 95% read / 5% write workload on the plain tree guarded by a
+//	single mutex against the path-copying tree, where look-ups never block.
+//	Reported as total Mops/sec across all threads.
+//
+void BenchmarkConcurrent(void)
+{
+	const int keyRange = 200000;
+	const int opCount  = 200000;
+
+	printf("\nMixed 95/5 read/write, %d keys, %d ops per thread (Mops/sec)\n", keyRange / 2, opCount);
+	printf("%8s %12s %12s\n", "threads", "mutex", "copy-on-wr");
+	printf("------------------------------------\n");
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	for (int threadCount = 1; threadCount <= 8; threadCount *= 2) {
+		LeftLeaningRedBlack           locked;
+		std::mutex                    lock;
+		ConcurrentLeftLeaningRedBlack cow;
+
+		// Start both trees half full, so inserts and deletes both do work.
+		for (int key = 0; key < keyRange; key += 2) {
+			ref.Key = key;
+			locked.Insert(ref);
+			cow.Insert(ref);
+		}
+
+		double lockedTime = MixedWorkload(threadCount, opCount, keyRange,
+			[&](int, int key)   { std::lock_guard<std::mutex> guard(lock); locked.LookUp(key); },
+			[&](VoidRef_t r)    { std::lock_guard<std::mutex> guard(lock); locked.Insert(r); },
+			[&](int key)        { std::lock_guard<std::mutex> guard(lock); locked.Delete(key); });
+
+		std::vector<int> slots(threadCount);
+		for (int t = 0; t < threadCount; ++t) {
+			slots[t] = cow.AttachReader();
+		}
+
+		double cowTime = MixedWorkload(threadCount, opCount, keyRange,
+			[&](int t, int key) { cow.LookUp(slots[t], key); },
+			[&](VoidRef_t r)    { cow.Insert(r); },
+			[&](int key)        { cow.Delete(key); });
+
+		for (int t = 0; t < threadCount; ++t) {
+			cow.DetachReader(slots[t]);
+		}
+
+		double totalOps = double(threadCount) * opCount;
+
+		printf("%8d %12.2f %12.2f\n", threadCount,
+			totalOps / lockedTime / 1000.0,
+			totalOps / cowTime    / 1000.0);
+	}
+
+	printf("(hardware threads: %u)\n", std::thread::hardware_concurrency());
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	CacheMissOpen()
+//
+//	Opens a hardware counter for last-level cache misses in this thread.
+//	Returns -1 if the counter is not available, which is the case on other
+//	platforms, inside most virtual machines, and when perf_event_paranoid
+//	does not allow it.  The benchmarks then report "n/a" for cache misses.
+//
+static int CacheMissOpen(void)
+{
+#if defined(__linux__)
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+
+	attr.type           = PERF_TYPE_HARDWARE;
+	attr.size           = sizeof(attr);
+	attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled       = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv     = 1;
+
+	return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+	return -1;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	CacheMissStart()
+//
+static void CacheMissStart(int fd)
+{
+#if defined(__linux__)
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	CacheMissStop()
+//
+//	Returns the number of misses since CacheMissStart(), or -1 if there is
+//	no counter.
+//
+static long long CacheMissStop(int fd)
+{
+	long long count = -1;
+
+#if defined(__linux__)
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+		if (sizeof(count) != read(fd, &count, sizeof(count))) {
+			count = -1;
+		}
+	}
+#endif
+
+	return count;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FormatMisses()
+//
+static const char* FormatMisses(char buffer[], size_t size, long long misses, int opCount)
+{
+	if (misses < 0) {
+		snprintf(buffer, size, "n/a");
+	}
+	else {
+		snprintf(buffer, size, "%.2f", double(misses) / opCount);
+	}
+
+	return buffer;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	StructureRun()
+//
+//	Inserts keyCount random keys, looks each one up, then deletes them all,
+//	timing each phase and counting the cache misses it causes.  Works with
+//	any tree that has the Insert(VoidRef_t)/LookUp(int)/Delete(int) methods.
+//
+template <class Tree>
+static void StructureRun(const char *name, Tree &tree, const std::vector<int> &keys, int missCounter)
+{
+	int keyCount = int(keys.size());
+
+	int dummy;
+	VoidRef_t ref;
+	ref.pContext = &dummy;
+
+	CacheMissStart(missCounter);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < keyCount; ++i) {
+		ref.Key = keys[i];
+		tree.Insert(ref);
+	}
+
+	double    insertTime   = BenchMilliseconds(start);
+	long long insertMisses = CacheMissStop(missCounter);
+
+	CacheMissStart(missCounter);
+	start = std::chrono::steady_clock::now();
+
+	int found = 0;
+	for (int i = 0; i < keyCount; ++i) {
+		if (NULL != tree.LookUp(keys[i])) {
+			++found;
+		}
+	}
+
+	double    lookUpTime   = BenchMilliseconds(start);
+	long long lookUpMisses = CacheMissStop(missCounter);
+
+	CacheMissStart(missCounter);
+	start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < keyCount; ++i) {
+		tree.Delete(keys[i]);
+	}
+
+	double    deleteTime   = BenchMilliseconds(start);
+	long long deleteMisses = CacheMissStop(missCounter);
+
+	char ins[32], look[32], del[32];
+
+	printf("%-8s %11d %8.2f %8.2f %8.2f %9s %9s %9s\n", name, keyCount,
+		keyCount / insertTime / 1000.0,
+		found    / lookUpTime / 1000.0,
+		keyCount / deleteTime / 1000.0,
+		FormatMisses(ins,  sizeof(ins),  insertMisses, keyCount),
+		FormatMisses(look, sizeof(look), lookUpMisses, keyCount),
+		FormatMisses(del,  sizeof(del),  deleteMisses, keyCount));
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BenchmarkStructures()
+//
+//	Compares the LLRB against the B+-tree from 1K keys up to maxKeys, in
+//	steps of 10x.  Reports operations per second (in millions) and cache
+//	misses per operation for random insert, look-up and delete.
+//
+//	The largest sizes need several gigabytes, so any size that would use
+//	more than about three quarters of physical memory is skipped.
+//
+void BenchmarkStructures(long long maxKeys)
+{
+	int missCounter = CacheMissOpen();
+
+	printf("\nLLRB vs B+-tree, random keys (Mops/sec, cache misses per op)\n");
+	printf("B+-tree nodes are %d bytes, %d keys per leaf\n", int(BPlusTree::NodeSize()), BPT_LEAF_KEYS);
+	printf("%-8s %11s %8s %8s %8s %9s %9s %9s\n",
+		"tree", "keys", "insert", "lookup", "delete", "miss/ins", "miss/look", "miss/del");
+	printf("-------------------------------------------------------------------------------\n");
+
+	// The LLRB is the larger of the two: one node per key, plus the key
+	// array.  The B+-tree averages well under half of that.
+	long long bytesPerKey = sizeof(LLTB_t) + sizeof(int);
+	long long physical    = -1;
+
+#if defined(__linux__)
+	physical = (long long)(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+#endif
+
+	for (long long keyCount = 1000; keyCount <= maxKeys; keyCount *= 10) {
+		if ((physical > 0) && ((keyCount * bytesPerKey) > ((physical / 4) * 3))) {
+			printf("%-8s %11lld   skipped, needs about %lld MB\n", "", keyCount,
+				(keyCount * bytesPerKey) >> 20);
+			continue;
+		}
+
+		std::vector<int> keys(keyCount);
+		FillKeyStream(keys, 0);
+
+		{
+			LeftLeaningRedBlack tree;
+			StructureRun("LLRB", tree, keys, missCounter);
+		}
+
+		{
+			BPlusTree tree;
+			StructureRun("B+-tree", tree, keys, missCounter);
+		}
+	}
+
+	if (missCounter < 0) {
+		printf("(cache miss counter not available on this system)\n");
+	}
+#if defined(__linux__)
+	else {
+		close(missCounter);
+	}
+#endif
+}
+
+
+
@@ -0,0 +1,30 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: Benchmark.h
+//
+//	$Header: $
+//
+//
+//	Timing tests for the balanced tree code.  Each benchmark prints its own
+//	table of results to stdout.  These are selected from the command line
+//	in main.cpp.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+void BenchmarkAllocator(void);
+void BenchmarkOperations(void);
+void BenchmarkMap(void);
+void BenchmarkBulkBuild(void);
+void BenchmarkRangeScan(void);
+void BenchmarkRankSelect(void);
+void BenchmarkSplitPolicy(void);
+void BenchmarkSnapshot(void);
+void BenchmarkLookUpBatch(void);
+void BenchmarkConcurrent(void);
+void BenchmarkStructures(long long maxKeys);
+
+
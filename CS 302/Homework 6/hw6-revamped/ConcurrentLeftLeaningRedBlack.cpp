@@ -0,0 +1,613 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: ConcurrentLeftLeaningRedBlack.cpp
+//
+//	$Header: $
+//
+//
+//	Path-copying LLRB with lock-free readers.  The balancing logic is the
+//	same as the recursive path of LLRBCore.h with LLRB23Policy.  The only
+//	difference is that every helper calls Own() on a node before changing
+//	it, which swaps in a private copy of any node that readers can see.
+//
+//	This tree cannot use LLRBCore itself.  The core changes nodes in place
+//	through the tree's Set() and SetRed() accessors, but here a write may
+//	land on a different node than the one passed in, since Own() returns
+//	the copy and the caller has to link that copy in.  The two copies of
+//	the balancing code are kept in sync by hand, so a change to the 2-3
+//	rules in LLRBCore.h has to be made here as well.
+//
+//	The epoch protocol relies on sequentially consistent ordering between
+//	a reader storing its epoch then loading the root, and a writer storing
+//	the root then advancing the epoch and scanning the reader slots.  All
+//	of those atomics use the default memory_order_seq_cst for that reason.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "ConcurrentLeftLeaningRedBlack.h"
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	constructor
+//
+ConcurrentLeftLeaningRedBlack::ConcurrentLeftLeaningRedBlack(void)
+	:	m_pRoot(NULL),
+		m_GlobalEpoch(1),
+		m_Slab(sizeof(LLCowNode_t))
+{
+	for (int i = 0; i < LLRB_MAX_READERS; ++i) {
+		m_Readers[i].InUse = false;
+		m_Readers[i].Epoch = 0;
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	destructor
+//
+//	All readers must be detached before the tree is destroyed.  Every node,
+//	whether live or waiting to be reclaimed, came from the slab, so dropping
+//	the slabs releases all of them.
+//
+ConcurrentLeftLeaningRedBlack::~ConcurrentLeftLeaningRedBlack(void)
+{
+	m_Slab.FreeAll();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	AttachReader()
+//
+//	Claims a reader slot for the calling thread.  Returns -1 if all of the
+//	slots are in use.
+//
+int ConcurrentLeftLeaningRedBlack::AttachReader(void)
+{
+	for (int i = 0; i < LLRB_MAX_READERS; ++i) {
+		bool expected = false;
+
+		if (m_Readers[i].InUse.compare_exchange_strong(expected, true)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DetachReader()
+//
+void ConcurrentLeftLeaningRedBlack::DetachReader(int slot)
+{
+	m_Readers[slot].Epoch = 0;
+	m_Readers[slot].InUse = false;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	BeginRead()
+//
+//	Pins the current version of the tree and returns its root.  None of
+//	the nodes reachable from that root will be freed until EndRead() is
+//	called, so the caller may walk the snapshot for as long as it needs.
+//
+const LLCowNode_t* ConcurrentLeftLeaningRedBlack::BeginRead(int slot)
+{
+	m_Readers[slot].Epoch = m_GlobalEpoch.load();
+
+	return m_pRoot.load();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	EndRead()
+//
+void ConcurrentLeftLeaningRedBlack::EndRead(int slot)
+{
+	m_Readers[slot].Epoch.store(0, std::memory_order_release);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LookUp()
+//
+//	Lock-free search of the current version of the tree.  If the key is not
+//	in the tree, this will return NULL.
+//
+void* ConcurrentLeftLeaningRedBlack::LookUp(int slot, const int key)
+{
+	const LLCowNode_t *pNode = BeginRead(slot);
+
+	void *pContext = NULL;
+
+	while (NULL != pNode) {
+		if (key == pNode->Ref.Key) {
+			pContext = pNode->Ref.pContext;
+			break;
+		}
+		else if (key < pNode->Ref.Key) {
+			pNode = pNode->pLeft;
+		}
+		else {
+			pNode = pNode->pRight;
+		}
+	}
+
+	EndRead(slot);
+
+	return pContext;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	NewNode()
+//
+//	Note that a new node defaults to being red.
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::NewNode(void)
+{
+	LLCowNode_t *pNew = static_cast<LLCowNode_t*>(m_Slab.Alloc());
+
+	pNew->Ref.Key      = 0;
+	pNew->Ref.pContext = NULL;
+	pNew->IsRed        = true;
+	pNew->IsPublished  = false;
+	pNew->pLeft        = NULL;
+	pNew->pRight       = NULL;
+
+	m_Fresh.push_back(pNew);
+
+	return pNew;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Own()
+//
+//	Returns a node that the current write may modify.  A node that was
+//	created by this write is returned as-is.  Otherwise readers may be
+//	looking at it, so a copy is made and the original is retired.  The
+//	caller must store the returned pointer in place of the original.
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::Own(LLCowNode_t *pNode)
+{
+	if ((NULL == pNode) || (false == pNode->IsPublished)) {
+		return pNode;
+	}
+
+	LLCowNode_t *pCopy = NewNode();
+	pCopy->Ref    = pNode->Ref;
+	pCopy->IsRed  = pNode->IsRed;
+	pCopy->pLeft  = pNode->pLeft;
+	pCopy->pRight = pNode->pRight;
+
+	m_Retired.push_back(pNode);
+
+	return pCopy;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Retire()
+//
+//	Removes a node from the tree.  A node created by this write has never
+//	been seen by a reader, but it is still on the m_Fresh list, so it is
+//	held until Publish() is done with that list.
+//
+void ConcurrentLeftLeaningRedBlack::Retire(LLCowNode_t *pNode)
+{
+	if (pNode->IsPublished) {
+		m_Retired.push_back(pNode);
+	}
+	else {
+		m_Discard.push_back(pNode);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	IsRed()
+//
+static inline bool IsRed(LLCowNode_t *pNode)
+{
+	return ((NULL != pNode) && pNode->IsRed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	RotateLeft()
+//
+//	pNode must already be owned.  The right child is about to be modified,
+//	so it has to be owned as well.
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::RotateLeft(LLCowNode_t *pNode)
+{
+	LLCowNode_t *pTemp = Own(pNode->pRight);
+	pNode->pRight   = pTemp->pLeft;
+	pTemp->pLeft    = pNode;
+	pTemp->IsRed    = pNode->IsRed;
+	pNode->IsRed    = true;
+
+	return pTemp;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	RotateRight()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::RotateRight(LLCowNode_t *pNode)
+{
+	LLCowNode_t *pTemp = Own(pNode->pLeft);
+	pNode->pLeft    = pTemp->pRight;
+	pTemp->pRight   = pNode;
+	pTemp->IsRed    = pNode->IsRed;
+	pNode->IsRed    = true;
+
+	return pTemp;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ColorFlip()
+//
+//	Both children change color, so both have to be owned.
+//
+void ConcurrentLeftLeaningRedBlack::ColorFlip(LLCowNode_t *pNode)
+{
+	pNode->IsRed = !pNode->IsRed;
+
+	if (NULL != pNode->pLeft) {
+		pNode->pLeft         = Own(pNode->pLeft);
+		pNode->pLeft->IsRed  = !pNode->pLeft->IsRed;
+	}
+
+	if (NULL != pNode->pRight) {
+		pNode->pRight        = Own(pNode->pRight);
+		pNode->pRight->IsRed = !pNode->pRight->IsRed;
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MoveRedLeft()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::MoveRedLeft(LLCowNode_t *pNode)
+{
+	ColorFlip(pNode);
+
+	if ((NULL != pNode->pRight) && IsRed(pNode->pRight->pLeft)) {
+		pNode->pRight = RotateRight(pNode->pRight);
+		pNode         = RotateLeft(pNode);
+
+		ColorFlip(pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MoveRedRight()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::MoveRedRight(LLCowNode_t *pNode)
+{
+	ColorFlip(pNode);
+
+	if ((NULL != pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
+		pNode = RotateRight(pNode);
+
+		ColorFlip(pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertFixUp()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::InsertFixUp(LLCowNode_t *pNode)
+{
+	if (IsRed(pNode->pRight) && (false == IsRed(pNode->pLeft))) {
+		pNode = RotateLeft(pNode);
+	}
+
+	if (IsRed(pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
+		pNode = RotateRight(pNode);
+	}
+
+	if (IsRed(pNode->pLeft) && IsRed(pNode->pRight)) {
+		ColorFlip(pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FixUp()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::FixUp(LLCowNode_t *pNode)
+{
+	if (IsRed(pNode->pRight)) {
+		pNode = RotateLeft(pNode);
+	}
+
+	if (IsRed(pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
+		pNode = RotateRight(pNode);
+	}
+
+	if (IsRed(pNode->pLeft) && IsRed(pNode->pRight)) {
+		ColorFlip(pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Publish()
+//
+//	Makes the new version visible to readers, then moves the nodes it
+//	replaced into limbo until every reader that might still see them has
+//	finished.
+//
+void ConcurrentLeftLeaningRedBlack::Publish(LLCowNode_t *pRoot)
+{
+	// From here on, these nodes may be seen by readers, so the next write
+	// will have to copy them.
+	for (size_t i = 0; i < m_Fresh.size(); ++i) {
+		m_Fresh[i]->IsPublished = true;
+	}
+
+	m_Fresh.clear();
+
+	m_pRoot.store(pRoot);
+
+	// Nodes that were created and removed by this write were never seen.
+	for (size_t i = 0; i < m_Discard.size(); ++i) {
+		m_Slab.Free(m_Discard[i]);
+	}
+
+	m_Discard.clear();
+
+	if (false == m_Retired.empty()) {
+		Limbo_t limbo;
+		limbo.Epoch = m_GlobalEpoch.fetch_add(1);
+		limbo.Nodes.swap(m_Retired);
+
+		m_Limbo.push_back(limbo);
+	}
+
+	Reclaim();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Reclaim()
+//
+//	A reader that published epoch E read the global epoch after every batch
+//	retired in an epoch below E was replaced by a newer root, so it cannot
+//	reach any of those nodes.  Batches older than the oldest active reader
+//	can be freed.
+//
+void ConcurrentLeftLeaningRedBlack::Reclaim(void)
+{
+	unsigned long long oldest = m_GlobalEpoch.load();
+
+	for (int i = 0; i < LLRB_MAX_READERS; ++i) {
+		unsigned long long epoch = m_Readers[i].Epoch.load();
+
+		if ((0 != epoch) && (epoch < oldest)) {
+			oldest = epoch;
+		}
+	}
+
+	// Batches are appended in epoch order, so stop at the first one that
+	// is still visible.
+	size_t freed = 0;
+
+	while ((freed < m_Limbo.size()) && (m_Limbo[freed].Epoch < oldest)) {
+		std::vector<LLCowNode_t*> &nodes = m_Limbo[freed].Nodes;
+
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			m_Slab.Free(nodes[i]);
+		}
+
+		++freed;
+	}
+
+	m_Limbo.erase(m_Limbo.begin(), m_Limbo.begin() + freed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	PendingCount()
+//
+//	Returns the number of retired nodes that are still waiting for readers
+//	to finish before they can be freed.
+//
+int ConcurrentLeftLeaningRedBlack::PendingCount(void)
+{
+	std::lock_guard<std::mutex> lock(m_WriteLock);
+
+	size_t count = 0;
+
+	for (size_t i = 0; i < m_Limbo.size(); ++i) {
+		count += m_Limbo[i].Nodes.size();
+	}
+
+	return int(count);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Insert()
+//
+bool ConcurrentLeftLeaningRedBlack::Insert(VoidRef_t ref)
+{
+	std::lock_guard<std::mutex> lock(m_WriteLock);
+
+	LLCowNode_t *pRoot = InsertRec(m_pRoot.load(std::memory_order_relaxed), ref);
+
+	// The root node of a red-black tree must be black.  InsertRec() always
+	// returns an owned node, so this does not touch the published tree.
+	pRoot->IsRed = false;
+
+	Publish(pRoot);
+
+	return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertRec()
+//
+//	Every node on the search path is owned before recursing, since the
+//	child link will be rewritten on the way back out.
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::InsertRec(LLCowNode_t *pNode, VoidRef_t ref)
+{
+	if (NULL == pNode) {
+		pNode      = NewNode();
+		pNode->Ref = ref;
+		return pNode;
+	}
+
+	pNode = Own(pNode);
+
+	if (ref.Key == pNode->Ref.Key) {
+		pNode->Ref = ref;
+	}
+	else if (ref.Key < pNode->Ref.Key) {
+		pNode->pLeft = InsertRec(pNode->pLeft, ref);
+	}
+	else {
+		pNode->pRight = InsertRec(pNode->pRight, ref);
+	}
+
+	return InsertFixUp(pNode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Delete()
+//
+void ConcurrentLeftLeaningRedBlack::Delete(const int key)
+{
+	std::lock_guard<std::mutex> lock(m_WriteLock);
+
+	LLCowNode_t *pRoot = m_pRoot.load(std::memory_order_relaxed);
+
+	if (NULL != pRoot) {
+		pRoot = DeleteRec(pRoot, key);
+
+		if (NULL != pRoot) {
+			pRoot->IsRed = false;
+		}
+
+		Publish(pRoot);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteRec()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::DeleteRec(LLCowNode_t *pNode, const int key)
+{
+	pNode = Own(pNode);
+
+	if (key < pNode->Ref.Key) {
+		if (NULL != pNode->pLeft) {
+			if ((false == IsRed(pNode->pLeft)) && (false == IsRed(pNode->pLeft->pLeft))) {
+				pNode = MoveRedLeft(pNode);
+			}
+
+			pNode->pLeft = DeleteRec(pNode->pLeft, key);
+		}
+	}
+	else {
+		if (IsRed(pNode->pLeft)) {
+			pNode = RotateRight(pNode);
+		}
+
+		if ((key == pNode->Ref.Key) && (NULL == pNode->pRight)) {
+			Retire(pNode);
+			return NULL;
+		}
+
+		if (NULL != pNode->pRight) {
+			if ((false == IsRed(pNode->pRight)) && (false == IsRed(pNode->pRight->pLeft))) {
+				pNode = MoveRedRight(pNode);
+			}
+
+			if (key == pNode->Ref.Key) {
+				LLCowNode_t *pMin = pNode->pRight;
+				while (NULL != pMin->pLeft) {
+					pMin = pMin->pLeft;
+				}
+
+				pNode->Ref    = pMin->Ref;
+				pNode->pRight = DeleteMin(pNode->pRight);
+			}
+			else {
+				pNode->pRight = DeleteRec(pNode->pRight, key);
+			}
+		}
+	}
+
+	return FixUp(pNode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteMin()
+//
+LLCowNode_t* ConcurrentLeftLeaningRedBlack::DeleteMin(LLCowNode_t *pNode)
+{
+	if (NULL == pNode->pLeft) {
+		Retire(pNode);
+		return NULL;
+	}
+
+	pNode = Own(pNode);
+
+	if ((false == IsRed(pNode->pLeft)) && (false == IsRed(pNode->pLeft->pLeft))) {
+		pNode = MoveRedLeft(pNode);
+	}
+
+	pNode->pLeft = DeleteMin(pNode->pLeft);
+
+	return FixUp(pNode);
+}
+
+
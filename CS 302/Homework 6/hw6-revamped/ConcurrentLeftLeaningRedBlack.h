@@ -0,0 +1,134 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: ConcurrentLeftLeaningRedBlack.h
+//
+//	$Header: $
+//
+//
+//	Persistent (path-copying) version of the LLRB that allows any number of
+//	threads to perform look-ups while another thread is modifying the tree.
+//
+//	Nodes are never modified once they are reachable from a published
+//	root.  Insert() and Delete() copy every node along the path they touch,
+//	build the new version of the tree off to the side, then publish the new
+//	root with a single atomic store.  Readers load the root once and search
+//	that version without taking any locks.  Writers are serialized with a
+//	mutex, so there is still only one writer at a time.
+//
+//	The nodes replaced by a write cannot be freed right away, since a reader
+//	may still be walking the old version.  These are reclaimed with epochs:
+//	each reader publishes the global epoch it observed when it started, and
+//	a retired node is only freed once every active reader has started after
+//	the write that retired it.
+//
+//	Readers must attach to the tree to get a slot for publishing their
+//	epoch.  Each slot must only be used by one thread at a time.
+//
+//		int slot = tree.AttachReader();
+//		void *pContext = tree.LookUp(slot, key);
+//		tree.DetachReader(slot);
+//
+//	This always uses the 2-3 tree arrangement, regardless of USE_234_TREE.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include "LeftLeaningRedBlack.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+// Maximum number of reader threads that can be attached to a tree at once.
+#define LLRB_MAX_READERS	64
+
+
+struct LLCowNode_t
+{
+	VoidRef_t Ref;
+
+	bool IsRed;
+
+	// Set once the node is reachable from a published root.  Only nodes
+	// created by the current write are still unpublished, so they are the
+	// only nodes that the write is allowed to modify.
+	bool IsPublished;
+
+	LLCowNode_t *pLeft;
+	LLCowNode_t *pRight;
+};
+
+
+class ConcurrentLeftLeaningRedBlack
+{
+private:
+	// Each slot is on its own cache line so readers do not contend with
+	// each other when publishing their epochs.
+	struct alignas(64) ReaderSlot_t
+	{
+		std::atomic<bool>               InUse;
+		std::atomic<unsigned long long> Epoch;		// 0 == not reading
+	};
+
+	// Nodes retired by a single write, along with the epoch in which they
+	// were retired.
+	struct Limbo_t
+	{
+		unsigned long long         Epoch;
+		std::vector<LLCowNode_t*>  Nodes;
+	};
+
+	std::atomic<LLCowNode_t*>       m_pRoot;
+	std::atomic<unsigned long long> m_GlobalEpoch;
+
+	ReaderSlot_t                    m_Readers[LLRB_MAX_READERS];
+
+	// Everything below is only touched while holding m_WriteLock.
+	std::mutex                      m_WriteLock;
+	SlabAllocator                   m_Slab;
+	std::vector<LLCowNode_t*>       m_Fresh;
+	std::vector<LLCowNode_t*>       m_Discard;
+	std::vector<LLCowNode_t*>       m_Retired;
+	std::vector<Limbo_t>            m_Limbo;
+
+	LLCowNode_t* NewNode(void);
+	LLCowNode_t* Own(LLCowNode_t *pNode);
+	void         Retire(LLCowNode_t *pNode);
+
+	LLCowNode_t* RotateLeft(LLCowNode_t *pNode);
+	LLCowNode_t* RotateRight(LLCowNode_t *pNode);
+	void         ColorFlip(LLCowNode_t *pNode);
+	LLCowNode_t* MoveRedLeft(LLCowNode_t *pNode);
+	LLCowNode_t* MoveRedRight(LLCowNode_t *pNode);
+	LLCowNode_t* InsertFixUp(LLCowNode_t *pNode);
+	LLCowNode_t* FixUp(LLCowNode_t *pNode);
+
+	LLCowNode_t* InsertRec(LLCowNode_t *pNode, VoidRef_t ref);
+	LLCowNode_t* DeleteRec(LLCowNode_t *pNode, const int key);
+	LLCowNode_t* DeleteMin(LLCowNode_t *pNode);
+
+	void Publish(LLCowNode_t *pRoot);
+	void Reclaim(void);
+
+public:
+	ConcurrentLeftLeaningRedBlack(void);
+	~ConcurrentLeftLeaningRedBlack(void);
+
+	int  AttachReader(void);
+	void DetachReader(int slot);
+
+	const LLCowNode_t* BeginRead(int slot);
+	void               EndRead(int slot);
+
+	void* LookUp(int slot, const int key);
+
+	bool Insert(VoidRef_t ref);
+	void Delete(const int key);
+
+	int  PendingCount(void);
+};
+
+
@@ -0,0 +1,790 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: LLRBCore.h
+//
+//	$Header: $
+//
+//
+//	Balancing code shared by LeftLeaningRedBlackT and LeftLeaningRedBlackMap.
+//	The rotations, color flips, fix-ups, and the recursive and iterative
+//	insertion and deletion paths are written once here, against a small set
+//	of accessors that each tree supplies.  This way both trees honor the
+//	same split policy and USE_ITERATIVE_LLRB setting, and a fix to the
+//	balancing logic only has to be made in one place.
+//
+//	Refer to LeftLeaningRedBlack.cpp for the background on LLRB trees.
+//
+//	The Tree class passed to LLRBCore has to provide:
+//
+//		Node_t, Link_t
+//			The node type, and a pointer to a word that links to a node.
+//			The iterative code records a stack of these, so that it can
+//			store the new root of each subtree back into its parent.
+//
+//		static Node_t* Get(Link_t)
+//		static void    Set(Link_t, Node_t*)
+//		static Link_t  LeftLink(Node_t*), RightLink(Node_t*)
+//		static Node_t* Left(Node_t*), Right(Node_t*)
+//			Read and write the child links.  Set() must leave any other
+//			bits stored in the link word alone.
+//
+//		static bool IsRed(Node_t*)
+//		static void SetRed(Node_t*, bool)
+//		static void FlipRed(Node_t*)
+//			IsRed() must return false for NULL.
+//
+//		static void UpdateSize(Node_t*)
+//		static void CopySize(Node_t *pTo, Node_t *pFrom)
+//			Maintain the subtree key count, if the tree keeps one.
+//
+//		void    Count(LLRBOp_t)
+//		int     CompareKey(const Key&, Node_t*)
+//		Node_t* NewLeaf(const Key&, const Item&)
+//		void    ReplaceItem(Node_t*, const Item&)
+//		void    MoveItem(Node_t *pTo, Node_t *pFrom)
+//		void    ReleaseNode(Node_t*)
+//			CompareKey() returns a value less than, equal to, or greater
+//			than zero, the same as strcmp().  MoveItem() copies the key and
+//			value of the successor into a node that is being deleted.
+//
+//	The accessors are all expected to be inline, so the compiler reduces
+//	each tree's instantiation to the same code as if it had been written
+//	against that tree's node layout directly.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include <cstddef>
+
+
+// Define this symbol to use the iterative versions of Insert() and Delete().
+// These walk down the tree with a loop, recording the link to each node
+// visited on a small fixed-size stack, then apply the same fix-ups as the
+// recursive code while popping that stack.  The resulting tree is identical
+// to the one produced by the recursive versions, but there is no call
+// overhead per level and the rotation helpers can be inlined into a single
+// loop body.
+//
+#define USE_ITERATIVE_LLRB
+
+
+// Maximum depth of the path stacks used by the iterative code and by the
+// iterators.  The height of a red-black tree is at most 2 * log2(n + 1),
+// so this is enough for any tree whose key count fits in an int.
+#define LLRB_MAX_DEPTH		64
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Split policies
+//
+//	LLRB23Policy splits 4-nodes with a color flip on the way back up the
+//	tree, so no 4-nodes are left after an insertion.  LLRB234Policy splits
+//	them on the way down instead, which leaves 4-nodes in the tree.
+//
+//	SplitOnWayDown is a compile-time constant, so the code for the other
+//	policy is removed by the compiler.
+//
+struct LLRB23Policy
+{
+	enum { SplitOnWayDown = false };
+
+	static const char* Name(void) { return "2-3"; }
+};
+
+
+struct LLRB234Policy
+{
+	enum { SplitOnWayDown = true };
+
+	static const char* Name(void) { return "2-3-4"; }
+};
+
+
+// Rebalancing steps reported to the tree's Count() hook.
+enum LLRBOp_t
+{
+	LLRBOp_RotateLeft,
+	LLRBOp_RotateRight,
+	LLRBOp_ColorFlip,
+	LLRBOp_MoveRedLeft,
+	LLRBOp_MoveRedRight
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBCore
+//
+//	Only static functions.  The tree is passed in so that the hooks for
+//	allocation, comparison, and counting can reach its members.
+//
+template <class Policy, class Tree>
+class LLRBCore
+{
+public:
+	typedef typename Tree::Node_t Node_t;
+	typedef typename Tree::Link_t Link_t;
+
+	static Node_t* RotateLeft(Tree &tree, Node_t *pNode);
+	static Node_t* RotateRight(Tree &tree, Node_t *pNode);
+	static void    ColorFlip(Tree &tree, Node_t *pNode);
+	static Node_t* InsertFixUp(Tree &tree, Node_t *pNode);
+	static Node_t* MoveRedLeft(Tree &tree, Node_t *pNode);
+	static Node_t* MoveRedRight(Tree &tree, Node_t *pNode);
+	static Node_t* FixUp(Tree &tree, Node_t *pNode);
+	static Node_t* FindMin(Node_t *pNode);
+
+	template <class Key, class Item>
+	static Node_t* InsertRec(Tree &tree, Node_t *pNode, const Key &key, const Item &item);
+
+	template <class Key, class Item>
+	static void    InsertIter(Tree &tree, Link_t pRoot, const Key &key, const Item &item);
+
+	template <class Key>
+	static Node_t* DeleteRec(Tree &tree, Node_t *pNode, const Key &key);
+	static Node_t* DeleteMin(Tree &tree, Node_t *pNode);
+
+	template <class Key>
+	static void    DeleteIter(Tree &tree, Link_t pRoot, const Key &key);
+	static void    DeleteMinIter(Tree &tree, Link_t pLink, Link_t stack[], int &depth);
+
+	// Entry points for the tree's Insert() and Delete().  These pick the
+	// recursive or iterative version and leave the root black.
+	template <class Key, class Item>
+	static void    Insert(Tree &tree, Link_t pRoot, const Key &key, const Item &item);
+
+	template <class Key>
+	static void    Delete(Tree &tree, Link_t pRoot, const Key &key);
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	RotateLeft()
+//
+//	Rotate the subtree to the left:
+//
+//	   4            6
+//	  / \          /
+//	 2   6  -->   4
+//	             /
+//	            2
+//
+//	Node '6' will take on the color '4' used to have, while '4' becomes a
+//	red node.  Likewise '6' now holds every key in the subtree, so it takes
+//	the old key count of '4', and '4' is recounted from its new children.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::RotateLeft(Tree &tree, Node_t *pNode)
+{
+	tree.Count(LLRBOp_RotateLeft);
+
+	Node_t *pTemp = Tree::Right(pNode);
+	Tree::Set(Tree::RightLink(pNode), Tree::Left(pTemp));
+	Tree::Set(Tree::LeftLink(pTemp), pNode);
+	Tree::SetRed(pTemp, Tree::IsRed(pNode));
+	Tree::SetRed(pNode, true);
+
+	Tree::CopySize(pTemp, pNode);
+	Tree::UpdateSize(pNode);
+
+	return pTemp;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	RotateRight()
+//
+//	Rotate the subtree to the right.  This is the mirror image of
+//	RotateLeft(): the left child becomes the root of the subtree and takes
+//	on the old root's color and key count, while the old root becomes a
+//	red right child.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::RotateRight(Tree &tree, Node_t *pNode)
+{
+	tree.Count(LLRBOp_RotateRight);
+
+	Node_t *pTemp = Tree::Left(pNode);
+	Tree::Set(Tree::LeftLink(pNode), Tree::Right(pTemp));
+	Tree::Set(Tree::RightLink(pTemp), pNode);
+	Tree::SetRed(pTemp, Tree::IsRed(pNode));
+	Tree::SetRed(pNode, true);
+
+	Tree::CopySize(pTemp, pNode);
+	Tree::UpdateSize(pNode);
+
+	return pTemp;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ColorFlip()
+//
+//	Flips the color of the node and both of its children from black to red
+//	(or red to black).
+//
+//	Any time that a color flip is applied, it may cause pNode to end up
+//	with an invalid color relative to its parent node.  Therefore some kind
+//	of fix-up operation will be required after this function is called.
+//
+template <class Policy, class Tree>
+void LLRBCore<Policy, Tree>::ColorFlip(Tree &tree, Node_t *pNode)
+{
+	tree.Count(LLRBOp_ColorFlip);
+
+	Tree::FlipRed(pNode);
+
+	if (NULL != Tree::Left(pNode)) {
+		Tree::FlipRed(Tree::Left(pNode));
+	}
+
+	if (NULL != Tree::Right(pNode)) {
+		Tree::FlipRed(Tree::Right(pNode));
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertFixUp()
+//
+//	Rebalancing applied to each node on the insertion path while backing
+//	out of the tree.  This places the tree in a state where the parent can
+//	safely apply a rotation to restore the required black/red balance of
+//	the tree.  Shared by both the recursive and iterative insertion code so
+//	they always produce the same tree.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::InsertFixUp(Tree &tree, Node_t *pNode)
+{
+	// One of the children may have gained a key.  This must be done
+	// before rotating, since the rotations carry this count along.
+	Tree::UpdateSize(pNode);
+
+	// Fix a right-leaning red node: this will assure that a 3-node is
+	// the left child.
+	if (Tree::IsRed(Tree::Right(pNode)) && (false == Tree::IsRed(Tree::Left(pNode)))) {
+		pNode = RotateLeft(tree, pNode);
+	}
+
+	// Fix two reds in a row: this will rebalance a 4-node.
+	if (Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Left(Tree::Left(pNode)))) {
+		pNode = RotateRight(tree, pNode);
+	}
+
+	// If we perform the color flip here, the tree is assembled as a
+	// mapping of a 2-3 tree.
+	//
+	// This color flip will effectively split 4-nodes on the way back
+	// out of the tree.  By doing this here, there will be no 4-nodes
+	// left in the tree after the insertion is complete.
+	if ((false == Policy::SplitOnWayDown) && Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Right(pNode))) {
+		ColorFlip(tree, pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Insert()
+//
+template <class Policy, class Tree>
+template <class Key, class Item>
+void LLRBCore<Policy, Tree>::Insert(Tree &tree, Link_t pRoot, const Key &key, const Item &item)
+{
+#if defined(USE_ITERATIVE_LLRB)
+	InsertIter(tree, pRoot, key, item);
+#else
+	Tree::Set(pRoot, InsertRec(tree, Tree::Get(pRoot), key, item));
+#endif
+
+	// The root node of a red-black tree must be black.
+	Tree::SetRed(Tree::Get(pRoot), false);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertRec()
+//
+//	Note that during rebalancing, a rotation may change the value assigned
+//	to pNode.  This will change which node is the root of the subtree that
+//	is being modified.  The caller will need to use the returned pointer
+//	to replace whichever value was passed into InsertRec.
+//
+template <class Policy, class Tree>
+template <class Key, class Item>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::InsertRec(Tree &tree, Node_t *pNode, const Key &key, const Item &item)
+{
+	// Special case for inserting a leaf.  Just return the pointer;
+	// the caller will insert the new node into the parent node.
+	if (NULL == pNode) {
+		return tree.NewLeaf(key, item);
+	}
+
+	// If we perform the color flip here, the tree is assembled as a
+	// mapping of a 2-3-4 tree.
+	//
+	// This color flip will effectively split 4-nodes on the way down
+	// the tree (since 4-nodes must be represented by a node with two
+	// red children).  By performing the color flip here, the 4-nodes
+	// will remain in the tree after the insertion.
+	if (Policy::SplitOnWayDown && Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Right(pNode))) {
+		ColorFlip(tree, pNode);
+	}
+
+	int cmp = tree.CompareKey(key, pNode);
+
+	// Check to see if the value is already in the tree.  If so, we
+	// simply replace the value of the key, since duplicate keys are
+	// not allowed.
+	if (0 == cmp) {
+		tree.ReplaceItem(pNode, item);
+	}
+
+	// Otherwise recurse left or right depending on key value.
+	//
+	// The reason for pass-by-value, followed by an assignment, is that
+	// the recursive call may perform a rotation, so the pointer that gets
+	// passed in may end up not being the root of the subtree once the
+	// recursion returns.
+	else if (cmp < 0) {
+		Tree::Set(Tree::LeftLink(pNode), InsertRec(tree, Tree::Left(pNode), key, item));
+	}
+	else {
+		Tree::Set(Tree::RightLink(pNode), InsertRec(tree, Tree::Right(pNode), key, item));
+	}
+
+	// Return the new root of the subtree that was just updated,
+	// since rotations may have changed the value of this pointer.
+	return InsertFixUp(tree, pNode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	InsertIter()
+//
+//	Iterative version of InsertRec().  The descent records each link that
+//	was followed, so that on the way back up each fix-up can store the new
+//	root of its subtree directly into the parent's link.
+//
+//	Like InsertRec(), the fix-ups are applied to every node on the path,
+//	including the node holding the key when the key is already present.
+//
+template <class Policy, class Tree>
+template <class Key, class Item>
+void LLRBCore<Policy, Tree>::InsertIter(Tree &tree, Link_t pRoot, const Key &key, const Item &item)
+{
+	Link_t stack[LLRB_MAX_DEPTH];
+	int    depth = 0;
+	Link_t pLink = pRoot;
+
+	while (NULL != Tree::Get(pLink)) {
+		Node_t *pNode = Tree::Get(pLink);
+
+		// Split 4-nodes on the way down, same as InsertRec().
+		if (Policy::SplitOnWayDown && Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Right(pNode))) {
+			ColorFlip(tree, pNode);
+		}
+
+		stack[depth++] = pLink;
+
+		int cmp = tree.CompareKey(key, pNode);
+
+		if (0 == cmp) {
+			tree.ReplaceItem(pNode, item);
+			break;
+		}
+
+		pLink = (cmp < 0) ? Tree::LeftLink(pNode) : Tree::RightLink(pNode);
+	}
+
+	// Insert a new leaf.  This is the only case where the loop exits
+	// without finding the key.
+	if (NULL == Tree::Get(pLink)) {
+		Tree::Set(pLink, tree.NewLeaf(key, item));
+	}
+
+	while (depth > 0) {
+		pLink = stack[--depth];
+		Tree::Set(pLink, InsertFixUp(tree, Tree::Get(pLink)));
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MoveRedLeft()
+//
+//	This code assumes that either pNode or its left child are red.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::MoveRedLeft(Tree &tree, Node_t *pNode)
+{
+	tree.Count(LLRBOp_MoveRedLeft);
+
+	// If both children are black, we turn these three nodes into a
+	// 4-node by applying a color flip.
+	ColorFlip(tree, pNode);
+
+	// But we may end up with a case where the right child has a red
+	// child.  Apply a pair of rotations and a color flip to make pNode a
+	// red node, both of its children become black nodes, and the left
+	// child becomes a 3-node.
+	if ((NULL != Tree::Right(pNode)) && Tree::IsRed(Tree::Left(Tree::Right(pNode)))) {
+		Tree::Set(Tree::RightLink(pNode), RotateRight(tree, Tree::Right(pNode)));
+		pNode = RotateLeft(tree, pNode);
+
+		ColorFlip(tree, pNode);
+
+		// In a 2-3-4 tree the right sibling may have been a 4-node.  After
+		// lending its smallest key, it is left as a 3-node that leans to the
+		// right.  That node is not on the deletion path, so FixUp() will
+		// never see it, and it has to be straightened out here.  This case
+		// cannot happen in a 2-3 tree.
+		if (Policy::SplitOnWayDown && Tree::IsRed(Tree::Right(Tree::Right(pNode)))) {
+			Tree::Set(Tree::RightLink(pNode), RotateLeft(tree, Tree::Right(pNode)));
+		}
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MoveRedRight()
+//
+//	This code assumes that either pNode or its right child is a red node.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::MoveRedRight(Tree &tree, Node_t *pNode)
+{
+	tree.Count(LLRBOp_MoveRedRight);
+
+	// Applying a color flip may turn pNode into a 4-node,
+	// with both of its children being red.
+	ColorFlip(tree, pNode);
+
+	// However, this may cause a situation where both of pNode's
+	// children are red, along with the left child's left child.  Applying
+	// a rotation and a color flip will fix this special case, since it
+	// makes pNode red and pNode's children black.
+	if ((NULL != Tree::Left(pNode)) && Tree::IsRed(Tree::Left(Tree::Left(pNode)))) {
+		pNode = RotateRight(tree, pNode);
+
+		ColorFlip(tree, pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FindMin()
+//
+//	Find the node under pNode that contains the smallest key value.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::FindMin(Node_t *pNode)
+{
+	while (NULL != Tree::Left(pNode)) {
+		pNode = Tree::Left(pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FixUp()
+//
+//	Apply fix-up logic during deletion.  Applying color flips and rotations
+//	will preserve perfect black-link balance.  This will also fix any
+//	right-leaning red nodes and eliminate 4-nodes when backing out of
+//	recursive calls.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::FixUp(Tree &tree, Node_t *pNode)
+{
+	// A key may have been removed somewhere below this node.
+	Tree::UpdateSize(pNode);
+
+	// Fix right-leaning red nodes.
+	if (Tree::IsRed(Tree::Right(pNode))) {
+		pNode = RotateLeft(tree, pNode);
+	}
+
+	// With 2-3-4 trees, the left rotation above can move a red node
+	// underneath the red node that was rotated down to the left.  Rotate
+	// the pair so that both reds lean left, which the next test turns
+	// into a balanced 4-node.
+	if (Policy::SplitOnWayDown && Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Right(Tree::Left(pNode)))) {
+		Tree::Set(Tree::LeftLink(pNode), RotateLeft(tree, Tree::Left(pNode)));
+	}
+
+	// Detect if there is a 4-node that traverses down the left.
+	// This is fixed by a right rotation, making both of the red
+	// nodes the children of pNode.
+	if (Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Left(Tree::Left(pNode)))) {
+		pNode = RotateRight(tree, pNode);
+	}
+
+	// Split 4-nodes.
+	if (Tree::IsRed(Tree::Left(pNode)) && Tree::IsRed(Tree::Right(pNode))) {
+		ColorFlip(tree, pNode);
+	}
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Delete()
+//
+template <class Policy, class Tree>
+template <class Key>
+void LLRBCore<Policy, Tree>::Delete(Tree &tree, Link_t pRoot, const Key &key)
+{
+	if (NULL != Tree::Get(pRoot)) {
+#if defined(USE_ITERATIVE_LLRB)
+		DeleteIter(tree, pRoot, key);
+#else
+		Tree::Set(pRoot, DeleteRec(tree, Tree::Get(pRoot), key));
+#endif
+
+		// Assuming we have not deleted the last node from the tree, we
+		// need to force the root to be a black node to conform with the
+		// the rules of a red-black tree.
+		if (NULL != Tree::Get(pRoot)) {
+			Tree::SetRed(Tree::Get(pRoot), false);
+		}
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteRec()
+//
+template <class Policy, class Tree>
+template <class Key>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::DeleteRec(Tree &tree, Node_t *pNode, const Key &key)
+{
+	if (tree.CompareKey(key, pNode) < 0) {
+		if (NULL != Tree::Left(pNode)) {
+			// If pNode and its left child are black, we may need to
+			// move the right child to become the left child if a deletion
+			// would produce a red node.
+			if ((false == Tree::IsRed(Tree::Left(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Left(pNode))))) {
+				pNode = MoveRedLeft(tree, pNode);
+			}
+
+			Tree::Set(Tree::LeftLink(pNode), DeleteRec(tree, Tree::Left(pNode), key));
+		}
+	}
+	else {
+		// If the left child is red, apply a rotation so we make
+		// the right child red.  A 2-3-4 tree may already have a red
+		// right child here, in which case pNode is a 4-node and we can
+		// descend to the right without rotating.
+		if (Tree::IsRed(Tree::Left(pNode)) && !(Policy::SplitOnWayDown && Tree::IsRed(Tree::Right(pNode)))) {
+			pNode = RotateRight(tree, pNode);
+		}
+
+		// Special case for deletion of a leaf node.
+		// The arrangement logic of LLRBs assures that in this case,
+		// pNode cannot have a left child.
+		if ((0 == tree.CompareKey(key, pNode)) && (NULL == Tree::Right(pNode))) {
+			tree.ReleaseNode(pNode);
+			return NULL;
+		}
+
+		// If we get here, we need to traverse down the right node.
+		// However, if there is no right node, then the target key is
+		// not in the tree, so we can break out of the recursion.
+		if (NULL != Tree::Right(pNode)) {
+			if ((false == Tree::IsRed(Tree::Right(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Right(pNode))))) {
+				pNode = MoveRedRight(tree, pNode);
+			}
+
+			// Deletion of an internal node: We cannot delete this node
+			// from the tree, so we have to find the node containing
+			// the smallest key value that is larger than the key we're
+			// deleting.  This other key will replace the value we're
+			// deleting, then we can delete the node that previously
+			// held the key/value pair we just moved.
+			if (0 == tree.CompareKey(key, pNode)) {
+				tree.MoveItem(pNode, FindMin(Tree::Right(pNode)));
+				Tree::Set(Tree::RightLink(pNode), DeleteMin(tree, Tree::Right(pNode)));
+			}
+			else {
+				Tree::Set(Tree::RightLink(pNode), DeleteRec(tree, Tree::Right(pNode), key));
+			}
+		}
+	}
+
+	// Fix right-leaning red nodes and eliminate 4-nodes on the way up.
+	// Need to avoid allowing search operations to terminate on 4-nodes,
+	// or searching may not locate intended key.
+	return FixUp(tree, pNode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteMin()
+//
+//	Delete the bottom node on the left spine while maintaining balance.
+//	To do so, we maintain the invariant that the current node or its left
+//	child is red.
+//
+template <class Policy, class Tree>
+typename Tree::Node_t* LLRBCore<Policy, Tree>::DeleteMin(Tree &tree, Node_t *pNode)
+{
+	// If this node has no children, we're done.
+	// Due to the arrangement of an LLRB tree, the node cannot have a
+	// right child.
+	if (NULL == Tree::Left(pNode)) {
+		tree.ReleaseNode(pNode);
+		return NULL;
+	}
+
+	// If these nodes are black, we need to rearrange this subtree to
+	// force the left child to be red.
+	if ((false == Tree::IsRed(Tree::Left(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Left(pNode))))) {
+		pNode = MoveRedLeft(tree, pNode);
+	}
+
+	// Continue recursing to locate the node to delete.
+	Tree::Set(Tree::LeftLink(pNode), DeleteMin(tree, Tree::Left(pNode)));
+
+	return FixUp(tree, pNode);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteIter()
+//
+//	Iterative version of DeleteRec().  The transformations that DeleteRec()
+//	applies on the way down are applied here in the same order, with each
+//	new subtree root written straight back into the parent's link.  Every
+//	link that DeleteRec() would have returned through is pushed onto the
+//	stack, then FixUp() is applied to each of them on the way back up.
+//
+template <class Policy, class Tree>
+template <class Key>
+void LLRBCore<Policy, Tree>::DeleteIter(Tree &tree, Link_t pRoot, const Key &key)
+{
+	Link_t stack[LLRB_MAX_DEPTH];
+	int    depth = 0;
+	Link_t pLink = pRoot;
+
+	for (;;) {
+		Node_t *pNode = Tree::Get(pLink);
+
+		if (tree.CompareKey(key, pNode) < 0) {
+			if (NULL != Tree::Left(pNode)) {
+				if ((false == Tree::IsRed(Tree::Left(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Left(pNode))))) {
+					pNode = MoveRedLeft(tree, pNode);
+					Tree::Set(pLink, pNode);
+				}
+
+				stack[depth++] = pLink;
+				pLink = Tree::LeftLink(pNode);
+				continue;
+			}
+
+			// Key is not in the tree.
+			stack[depth++] = pLink;
+			break;
+		}
+
+		if (Tree::IsRed(Tree::Left(pNode)) && !(Policy::SplitOnWayDown && Tree::IsRed(Tree::Right(pNode)))) {
+			pNode = RotateRight(tree, pNode);
+			Tree::Set(pLink, pNode);
+		}
+
+		// Deletion of a leaf node.  DeleteRec() returns NULL without
+		// applying FixUp(), so this link is not pushed.
+		if ((0 == tree.CompareKey(key, pNode)) && (NULL == Tree::Right(pNode))) {
+			tree.ReleaseNode(pNode);
+			Tree::Set(pLink, NULL);
+			break;
+		}
+
+		stack[depth++] = pLink;
+
+		// Key is not in the tree.
+		if (NULL == Tree::Right(pNode)) {
+			break;
+		}
+
+		if ((false == Tree::IsRed(Tree::Right(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Right(pNode))))) {
+			pNode = MoveRedRight(tree, pNode);
+			Tree::Set(pLink, pNode);
+		}
+
+		// Deletion of an internal node: replace it with its successor,
+		// then delete the successor from the right subtree.
+		if (0 == tree.CompareKey(key, pNode)) {
+			tree.MoveItem(pNode, FindMin(Tree::Right(pNode)));
+			DeleteMinIter(tree, Tree::RightLink(pNode), stack, depth);
+			break;
+		}
+
+		pLink = Tree::RightLink(pNode);
+	}
+
+	while (depth > 0) {
+		pLink = stack[--depth];
+		Tree::Set(pLink, FixUp(tree, Tree::Get(pLink)));
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DeleteMinIter()
+//
+//	Iterative version of DeleteMin().  The links visited are pushed onto
+//	the caller's stack, since the caller is responsible for applying the
+//	fix-ups along the entire path.
+//
+template <class Policy, class Tree>
+void LLRBCore<Policy, Tree>::DeleteMinIter(Tree &tree, Link_t pLink, Link_t stack[], int &depth)
+{
+	for (;;) {
+		Node_t *pNode = Tree::Get(pLink);
+
+		if (NULL == Tree::Left(pNode)) {
+			tree.ReleaseNode(pNode);
+			Tree::Set(pLink, NULL);
+			return;
+		}
+
+		if ((false == Tree::IsRed(Tree::Left(pNode))) && (false == Tree::IsRed(Tree::Left(Tree::Left(pNode))))) {
+			pNode = MoveRedLeft(tree, pNode);
+			Tree::Set(pLink, pNode);
+		}
+
+		stack[depth++] = pLink;
+		pLink = Tree::LeftLink(pNode);
+	}
+}
+
+
@@ -0,0 +1,304 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: LLRBSnapshot.cpp
+//
+//	$Header: $
+//
+//
+//	Reading and writing LLRB snapshot files.  See LLRBSnapshot.h for the
+//	file layout.
+//
+//	The file is mapped read-only with mmap() (or MapViewOfFile() on
+//	Windows), so opening a snapshot costs the same for ten keys as for ten
+//	million.  Nothing is copied out of the mapping: LookUp() follows the
+//	offset links directly in the mapped node array.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "LLRBSnapshot.h"
+#include "LeftLeaningRedBlack.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static const char c_SnapshotMagic[8] = { 'L', 'L', 'R', 'B', 'S', 'N', 'A', 'P' };
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	constructor
+//
+LLRBSnapshot::LLRBSnapshot(void)
+	:	m_pBase(NULL),
+		m_ByteCount(0),
+		m_pHeader(NULL),
+		m_pNodes(NULL)
+#if defined(_WIN32)
+		,
+		m_hFile(INVALID_HANDLE_VALUE),
+		m_hMapping(NULL)
+#endif
+{
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	destructor
+//
+LLRBSnapshot::~LLRBSnapshot(void)
+{
+	Close();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Open()
+//
+//	Maps the file into memory and checks that the header describes a node
+//	array that fits within the file.  The nodes themselves are not touched.
+//
+bool LLRBSnapshot::Open(const char filename[])
+{
+	Close();
+
+#if defined(_WIN32)
+	m_hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (INVALID_HANDLE_VALUE == m_hFile) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if ((false == GetFileSizeEx(m_hFile, &size)) || (size.QuadPart < LONGLONG(sizeof(LLRBSnapshotHeader_t)))) {
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == m_hMapping) {
+		Close();
+		return false;
+	}
+
+	m_pBase = static_cast<const unsigned char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (NULL == m_pBase) {
+		Close();
+		return false;
+	}
+
+	m_ByteCount = size_t(size.QuadPart);
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if ((0 != fstat(fd, &info)) || (info.st_size < off_t(sizeof(LLRBSnapshotHeader_t)))) {
+		close(fd);
+		return false;
+	}
+
+	void *pMap = mmap(NULL, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping holds its own reference to the file.
+	close(fd);
+
+	if (MAP_FAILED == pMap) {
+		return false;
+	}
+
+	m_pBase     = static_cast<const unsigned char*>(pMap);
+	m_ByteCount = size_t(info.st_size);
+#endif
+
+	m_pHeader = reinterpret_cast<const LLRBSnapshotHeader_t*>(m_pBase);
+	m_pNodes  = reinterpret_cast<const LLRBSnapshotNode_t*>(m_pBase + sizeof(LLRBSnapshotHeader_t));
+
+	const LLRBSnapshotHeader_t &header = *m_pHeader;
+
+	bool valid = (0 == memcmp(header.Magic, c_SnapshotMagic, sizeof(c_SnapshotMagic)))
+			  && (LLRB_SNAPSHOT_VERSION    == header.Version)
+			  && (LLRB_SNAPSHOT_BYTE_ORDER == header.ByteOrder)
+			  && (sizeof(LLRBSnapshotHeader_t) == header.HeaderBytes)
+			  && (sizeof(LLRBSnapshotNode_t)   == header.NodeBytes)
+			  && (header.Root <= header.KeyCount)
+			  && ((0 == header.Root) == (0 == header.KeyCount))
+			  && (((m_ByteCount - sizeof(LLRBSnapshotHeader_t)) / sizeof(LLRBSnapshotNode_t)) >= header.KeyCount);
+
+	if (false == valid) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Close()
+//
+void LLRBSnapshot::Close(void)
+{
+#if defined(_WIN32)
+	if (NULL != m_pBase) {
+		UnmapViewOfFile(m_pBase);
+	}
+
+	if (NULL != m_hMapping) {
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+
+	if (INVALID_HANDLE_VALUE != m_hFile) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (NULL != m_pBase) {
+		munmap(const_cast<unsigned char*>(m_pBase), m_ByteCount);
+	}
+#endif
+
+	m_pBase     = NULL;
+	m_ByteCount = 0;
+	m_pHeader   = NULL;
+	m_pNodes    = NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Validate()
+//
+//	Checks every node in the file.  The keys must be strictly increasing,
+//	and the links must describe a tree whose in-order walk visits the nodes
+//	in array order.  Together these mean the file is a valid binary search
+//	tree in which every node is reachable exactly once.  This is O(n), so
+//	it should only be used when the file may have been damaged.
+//
+bool LLRBSnapshot::Validate(void)
+{
+	if (NULL == m_pHeader) {
+		return false;
+	}
+
+	uint32_t count = m_pHeader->KeyCount;
+
+	for (uint32_t i = 1; i < count; ++i) {
+		if (m_pNodes[i-1].Key >= m_pNodes[i].Key) {
+			return false;
+		}
+	}
+
+	return ValidateRec(m_pHeader->Root, 0, count, 0);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ValidateRec()
+//
+//	The subtree at link must hold exactly the nodes lo through hi - 1.
+//
+bool LLRBSnapshot::ValidateRec(uint32_t link, uint32_t lo, uint32_t hi, int depth)
+{
+	if (0 == link) {
+		return lo == hi;
+	}
+
+	uint32_t index = link - 1;
+
+	if ((index < lo) || (index >= hi) || (depth >= LLRB_MAX_DEPTH)) {
+		return false;
+	}
+
+	const LLRBSnapshotNode_t &node = m_pNodes[index];
+
+	return ValidateRec(node.Left,  lo,        index, depth + 1)
+		&& ValidateRec(node.Right, index + 1, hi,    depth + 1);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LookUp()
+//
+//	Same search as LeftLeaningRedBlack::LookUp(), following offsets instead
+//	of pointers.  The walk stops at any link past the end of the node array,
+//	and after LLRB_MAX_DEPTH steps, so a damaged file cannot cause a fault
+//	or an endless loop.
+//
+void* LLRBSnapshot::LookUp(const int key) const
+{
+	if (NULL == m_pHeader) {
+		return NULL;
+	}
+
+	uint32_t count = m_pHeader->KeyCount;
+	uint32_t link  = m_pHeader->Root;
+
+	for (int depth = 0; (0 != link) && (link <= count) && (depth < LLRB_MAX_DEPTH); ++depth) {
+		const LLRBSnapshotNode_t &node = m_pNodes[link - 1];
+
+		if (key == node.Key) {
+			return reinterpret_cast<void*>(uintptr_t(node.Value));
+		}
+
+		link = (key < node.Key) ? node.Left : node.Right;
+	}
+
+	return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Write()
+//
+//	Writes a header and the node array to a new file.  The nodes must
+//	already be in the layout described in LLRBSnapshot.h.
+//
+bool LLRBSnapshot::Write(const char filename[], const LLRBSnapshotNode_t nodes[], uint32_t count, uint32_t root, bool splitOnWayDown)
+{
+	LLRBSnapshotHeader_t header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.Magic, c_SnapshotMagic, sizeof(c_SnapshotMagic));
+	header.Version        = LLRB_SNAPSHOT_VERSION;
+	header.ByteOrder      = LLRB_SNAPSHOT_BYTE_ORDER;
+	header.HeaderBytes    = sizeof(LLRBSnapshotHeader_t);
+	header.NodeBytes      = sizeof(LLRBSnapshotNode_t);
+	header.KeyCount       = count;
+	header.Root           = root;
+	header.SplitOnWayDown = splitOnWayDown ? 1 : 0;
+
+	FILE *pFile = fopen(filename, "wb");
+	if (NULL == pFile) {
+		return false;
+	}
+
+	bool success = (1 == fwrite(&header, sizeof(header), 1, pFile))
+				&& (count == fwrite(nodes, sizeof(LLRBSnapshotNode_t), count, pFile));
+
+	// The data is not safely on disk until fclose() has flushed it.
+	if (0 != fclose(pFile)) {
+		success = false;
+	}
+
+	return success;
+}
+
+
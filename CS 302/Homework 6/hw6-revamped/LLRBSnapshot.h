@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: LLRBSnapshot.h
+//
+//	$Header: $
+//
+//
+//	On-disk snapshot of an LLRB that can be mapped into memory and searched
+//	in place, without reading the file into a buffer (which is what
+//	QzReadFileToBuffer() does) and without rebuilding the tree one Insert()
+//	at a time.
+//
+//	The file is a header followed by an array of fixed-size nodes.  The
+//	nodes are written by an in-order walk, so the array is sorted by key.
+//	Child links are stored as offsets into that array instead of pointers,
+//	so the same bytes are valid wherever the file is mapped.  An offset of
+//	zero means there is no child, so offset n refers to node n - 1.
+//
+//	Colors are stored along with the links.  Loading a snapshot back into a
+//	tree with the same split policy recreates exactly the same shape, with
+//	no comparisons or rebalancing.
+//
+//	The value of each key is stored as the raw bits of its pContext.  This
+//	is only meaningful across runs if pContext holds a handle or index
+//	instead of an address.
+//
+//	Files are written in the byte order of the machine that wrote them.  A
+//	file written with the other byte order fails the ByteOrder test in
+//	Open().
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include <cstddef>
+#include <stdint.h>
+
+
+#define LLRB_SNAPSHOT_VERSION		1
+#define LLRB_SNAPSHOT_BYTE_ORDER	0x01020304
+
+
+struct LLRBSnapshotHeader_t
+{
+	char     Magic[8];			// "LLRBSNAP"
+	uint32_t Version;
+	uint32_t ByteOrder;
+	uint32_t HeaderBytes;		// sizeof(LLRBSnapshotHeader_t)
+	uint32_t NodeBytes;			// sizeof(LLRBSnapshotNode_t)
+	uint32_t KeyCount;
+	uint32_t Root;				// offset of the root node, 0 == empty
+	uint32_t SplitOnWayDown;	// policy of the tree that was written
+	uint32_t Reserved[7];
+};
+
+
+struct LLRBSnapshotNode_t
+{
+	int      Key;
+	uint32_t Left;
+	uint32_t Right;
+	uint32_t IsRed;
+	uint64_t Value;
+};
+
+
+static_assert(sizeof(LLRBSnapshotHeader_t) == 64, "LLRBSnapshotHeader_t layout changed");
+static_assert(sizeof(LLRBSnapshotNode_t)   == 24, "LLRBSnapshotNode_t layout changed");
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBSnapshot
+//
+//	Read-only view of a snapshot file.  Open() only checks the header, so
+//	it takes the same time no matter how large the file is.  Pages of the
+//	node array are brought in by the OS as LookUp() touches them.
+//
+//	LookUp() will not loop or read outside the file even if the links have
+//	been corrupted, but it can return the wrong answer.  Call Validate() to
+//	check the entire file if it might be damaged.
+//
+class LLRBSnapshot
+{
+private:
+	const unsigned char*        m_pBase;
+	size_t                      m_ByteCount;
+
+	const LLRBSnapshotHeader_t* m_pHeader;
+	const LLRBSnapshotNode_t*   m_pNodes;
+
+#if defined(_WIN32)
+	void*                       m_hFile;
+	void*                       m_hMapping;
+#endif
+
+	bool ValidateRec(uint32_t link, uint32_t lo, uint32_t hi, int depth);
+
+public:
+	LLRBSnapshot(void);
+	~LLRBSnapshot(void);
+
+	bool Open(const char filename[]);
+	void Close(void);
+
+	bool IsOpen(void) const { return NULL != m_pBase; }
+
+	bool Validate(void);
+
+	void* LookUp(const int key) const;
+
+	uint32_t KeyCount(void) const       { return (NULL != m_pHeader) ? m_pHeader->KeyCount : 0; }
+	uint32_t Root(void) const           { return (NULL != m_pHeader) ? m_pHeader->Root : 0; }
+	bool     SplitOnWayDown(void) const { return (NULL != m_pHeader) && (0 != m_pHeader->SplitOnWayDown); }
+
+	// Nodes in sorted order, KeyCount() of them.
+	const LLRBSnapshotNode_t* Nodes(void) const { return m_pNodes; }
+
+	static bool Write(const char filename[], const LLRBSnapshotNode_t nodes[], uint32_t count, uint32_t root, bool splitOnWayDown);
+};
+
+
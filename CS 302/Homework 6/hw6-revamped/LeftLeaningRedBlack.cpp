@@ -17,11 +17,11 @@
 //	the node a 4-node.
 //
 //	Depending on how values are inserted into the tree, the tree may emulate
-//	either a 2-3 tree or a 2-3-4 tree.  The USE_234_TREE symbol controls
-//	which rule is applied.  Empirically, 2-3 trees are slightly faster for
-//	insertions and look-ups, since fewer special cases are triggered due to
-//	how the nodes in the tree are arranged.  Test it if it matters, but in
-//	general, leave the USE_234_TREE symbol undefined for better overall
+//	either a 2-3 tree or a 2-3-4 tree.  The Policy template parameter
+//	controls which rule is applied.  Empirically, 2-3 trees are slightly
+//	faster for insertions and look-ups, since fewer special cases are
+//	triggered due to how the nodes in the tree are arranged.  Test it if it
+//	matters, but in general, use LLRB23Policy for better overall
 //	performance.
 //
 //	By enforcing the left-leaning rule, fewer special cases need to be tested
@@ -48,6 +48,14 @@
 
 
 #include "LeftLeaningRedBlack.h"
+#include "LLRBSnapshot.h"
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define LLRB_PREFETCH(p)	_mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#define LLRB_PREFETCH(p)	__builtin_prefetch(p)
+#endif
 
 
 #ifdef USE_MALLOC_MACRO
@@ -57,22 +65,64 @@ static char THIS_FILE[] = __FILE__;
 #endif
 
 
-// Define this symbol to configure the red-black tree as a 2-3-4 tree.
-// If this is not defined, the tree is arranged as a 2-3 tree.
+#if defined(USE_LLRB_STATS)
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBStatShard()
+//
+//	Shard of the look-up counts that the calling thread writes to.  Each
+//	thread takes the next shard the first time it looks something up, so
+//	threads only share a shard once there are more than LLRB_STAT_SHARDS.
+//
+static std::atomic<unsigned int> g_NextStatShard(0);
+
+static inline int LLRBStatShard(void)
+{
+	static thread_local int shard = -1;
+
+	if (shard < 0) {
+		shard = int(g_NextStatShard.fetch_add(1, std::memory_order_relaxed) % LLRB_STAT_SHARDS);
+	}
+
+	return shard;
+}
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
 //
-// In general, defining this symbol will reduce performance of all
-// operations on the LLRB.
+//	constructor
+//
+//	By default all nodes are carved out of slabs owned by the tree.  Pass
+//	in false to fall back to allocating each node with new, which is mostly
+//	useful for benchmarking the two approaches against each other.
 //
-//#define USE_234_TREE
+template <class Policy>
+LeftLeaningRedBlackT<Policy>::LeftLeaningRedBlackT(bool useSlab)
+	:	m_pRoot(NULL),
+		m_Slab(sizeof(LLTB_t)),
+		m_UseSlab(useSlab)
+{
+	ResetStats();
+}
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
 //	constructor
 //
-LeftLeaningRedBlack::LeftLeaningRedBlack(void)
-	:	m_pRoot(NULL)
+//	Builds the tree directly from an array of references that is sorted by
+//	key.  See BulkBuild() for the requirements on the array.  If the array
+//	is not sorted, the tree will be left empty.
+//
+template <class Policy>
+LeftLeaningRedBlackT<Policy>::LeftLeaningRedBlackT(const VoidRef_t refs[], int count, bool useSlab)
+	:	m_pRoot(NULL),
+		m_Slab(sizeof(LLTB_t)),
+		m_UseSlab(useSlab)
 {
+	ResetStats();
+	BulkBuild(refs, count);
 }
 
 
@@ -80,9 +130,10 @@ LeftLeaningRedBlack::LeftLeaningRedBlack(void)
 //
 //	destructor
 //
-LeftLeaningRedBlack::~LeftLeaningRedBlack(void)
+template <class Policy>
+LeftLeaningRedBlackT<Policy>::~LeftLeaningRedBlackT(void)
 {
-	Free(m_pRoot);
+	FreeAll();
 }
 
 
@@ -90,9 +141,18 @@ LeftLeaningRedBlack::~LeftLeaningRedBlack(void)
 //
 //	FreeAll()
 //
-void LeftLeaningRedBlack::FreeAll(void)
+//	When nodes come from the slab allocator, there is no need to walk the
+//	tree: dropping the slabs releases every node at once.
+//
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::FreeAll(void)
 {
-	Free(m_pRoot);
+	if (m_UseSlab) {
+		m_Slab.FreeAll();
+	}
+	else {
+		Free(m_pRoot);
+	}
 
 	m_pRoot = NULL;
 }
@@ -102,7 +162,8 @@ void LeftLeaningRedBlack::FreeAll(void)
 //
 //	Free()
 //
-void LeftLeaningRedBlack::Free(LLTB_t *pNode)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::Free(LLTB_t *pNode)
 {
 	if (NULL != pNode) {
 		if (NULL != pNode->pLeft) {
@@ -112,7 +173,7 @@ void LeftLeaningRedBlack::Free(LLTB_t *pNode)
 			Free(pNode->pRight);
 		}
 
-		SafeDelete(pNode);
+		ReleaseNode(pNode);
 	}
 }
 
@@ -123,13 +184,19 @@ void LeftLeaningRedBlack::Free(LLTB_t *pNode)
 //
 //	Note that a new node defaults to being red.
 //
-LLTB_t* LeftLeaningRedBlack::NewNode(void)
+template <class Policy>
+LLTB_t* LeftLeaningRedBlackT<Policy>::NewNode(void)
 {
-	LLTB_t *pNew = new LLTB_t;
+	LLTB_t *pNew = m_UseSlab
+				 ? static_cast<LLTB_t*>(m_Slab.Alloc())
+				 : new LLTB_t;
 
 	pNew->Ref.Key      = 0;
 	pNew->Ref.pContext = NULL;
 	pNew->IsRed        = true;
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pNew->Size         = 1;
+#endif
 	pNew->pLeft        = NULL;
 	pNew->pRight       = NULL;
 
@@ -137,6 +204,25 @@ LLTB_t* LeftLeaningRedBlack::NewNode(void)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ReleaseNode()
+//
+//	Returns a single node to wherever it was allocated from.  Slab nodes go
+//	onto the free list so the next NewNode() can recycle them.
+//
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::ReleaseNode(LLTB_t *pNode)
+{
+	if (m_UseSlab) {
+		m_Slab.Free(pNode);
+	}
+	else {
+		delete pNode;
+	}
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 //
 //	LookUp()
@@ -149,13 +235,22 @@ LLTB_t* LeftLeaningRedBlack::NewNode(void)
 //
 //	If the key is not in the tree, this will return NULL.
 //
-void* LeftLeaningRedBlack::LookUp(int key)
+template <class Policy>
+void* LeftLeaningRedBlackT<Policy>::LookUp(int key)
 {
 	LLTB_t *pNode = m_pRoot;
 
+#if defined(USE_LLRB_STATS)
+	// Count in a local so the loop does not have to store to the shared
+	// counters for every node visited.
+	int visited = 0;
+#endif
+
 	while (NULL != pNode) {
+		LLRB_COUNT(visited);
+
 		if (key == pNode->Ref.Key) {
-			return pNode->Ref.pContext;
+			break;
 		}
 		else if (key < pNode->Ref.Key) {
 			pNode = pNode->pLeft;
@@ -165,227 +260,201 @@ void* LeftLeaningRedBlack::LookUp(int key)
 		}
 	}
 
-	return NULL;
-}
-
+#if defined(USE_LLRB_STATS)
+	LLRB_COUNT_SHARED(m_LookUpCounts[LLRBStatShard()].LookUpNodes[visited], 1);
+#endif
 
-/////////////////////////////////////////////////////////////////////////////
-//
-//	IsRed()
-//
-static inline bool IsRed(LLTB_t *pNode)
-{
-	return ((NULL != pNode) && pNode->IsRed);
+	return (NULL != pNode) ? pNode->Ref.pContext : NULL;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	RotateLeft()
+//	LookUpBatch()
 //
-//	Rotate the subtree to the left:
+//	Looks up count keys, storing the value for keys[i] in out[i] (or NULL
+//	if the key is not in the tree).
 //
-//	   4            6
-//	  / \          /
-//	 2   6  -->   4
-//	             /
-//	            2
+//	Each step of LookUp() depends on the node loaded by the previous step,
+//	so once the tree is larger than the cache, every level is a cache miss
+//	that the CPU has to wait for.  Here, LLRB_BATCH_SIZE keys are walked
+//	down the tree together, one level at a time.  Each key's next node is
+//	prefetched when that key moves down, and the other keys in the group
+//	are processed before it is used, so the misses for all of the keys in
+//	the group are outstanding at the same time instead of one after the
+//	other.
 //
-//	Node '6' will take on the color '4' used to have, while '4' becomes a
-//	red node.
+//	This does more work per key than LookUp(), so it is only faster when
+//	the tree does not fit in the cache.
 //
-static LLTB_t* RotateLeft(LLTB_t *pNode)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::LookUpBatch(const int keys[], void* out[], size_t count)
 {
-	LLTB_t *pTemp = pNode->pRight;
-	pNode->pRight   = pTemp->pLeft;
-	pTemp->pLeft    = pNode;
-	pTemp->IsRed    = pNode->IsRed;
-	pNode->IsRed    = true;
+	for (size_t base = 0; base < count; base += LLRB_BATCH_SIZE) {
+		int groupSize = int(Min(count - base, size_t(LLRB_BATCH_SIZE)));
+
+		const int* groupKeys = keys + base;
+		void**     groupOut  = out  + base;
 
-	return pTemp;
+		LLTB_t* nodes[LLRB_BATCH_SIZE];
+
+#if defined(USE_LLRB_STATS)
+		int visited[LLRB_BATCH_SIZE];
+#endif
+
+		for (int i = 0; i < groupSize; ++i) {
+			nodes[i]    = m_pRoot;
+			groupOut[i] = NULL;
+#if defined(USE_LLRB_STATS)
+			visited[i]  = 0;
+#endif
+		}
+
+		// Keep stepping every key that is still searching.  A key drops out
+		// by finding its node or by running off the bottom of the tree.
+		int active = (NULL != m_pRoot) ? groupSize : 0;
+
+		while (active > 0) {
+			active = 0;
+
+			for (int i = 0; i < groupSize; ++i) {
+				LLTB_t *pNode = nodes[i];
+
+				if (NULL == pNode) {
+					continue;
+				}
+
+				LLRB_COUNT(visited[i]);
+
+				const int key = groupKeys[i];
+
+				if (key == pNode->Ref.Key) {
+					groupOut[i] = pNode->Ref.pContext;
+					nodes[i]    = NULL;
+					continue;
+				}
+
+				pNode    = (key < pNode->Ref.Key) ? pNode->pLeft : pNode->pRight;
+				nodes[i] = pNode;
+
+				if (NULL != pNode) {
+					LLRB_PREFETCH(pNode);
+					++active;
+				}
+			}
+		}
+
+#if defined(USE_LLRB_STATS)
+		LLRBLookUpCounts_t &counts = m_LookUpCounts[LLRBStatShard()];
+
+		for (int i = 0; i < groupSize; ++i) {
+			LLRB_COUNT_SHARED(counts.LookUpNodes[visited[i]], 1);
+		}
+#endif
+	}
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	RotateRight()
-//
-//	Rotate the subtree to the right:
-//
-//	   4        2
-//	  / \        \
-//	 2   6  -->   4
-//	               \
-//	                6
+//	SubtreeSize()
 //
-//	Node '2' will take on the color '4' used to have, while '4' becomes a
-//	red node.
-//
-static LLTB_t* RotateRight(LLTB_t *pNode)
+#if defined(USE_LLRB_SUBTREE_SIZE)
+static inline int SubtreeSize(LLTB_t *pNode)
 {
-	LLTB_t *pTemp = pNode->pLeft;
-	pNode->pLeft    = pTemp->pRight;
-	pTemp->pRight   = pNode;
-	pTemp->IsRed    = pNode->IsRed;
-	pNode->IsRed    = true;
-
-	return pTemp;
+	return (NULL != pNode) ? pNode->Size : 0;
 }
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	ColorFlip()
-//
-//	Flips the color of the node and both of its children from black to red
-//	(or red to black).
+//	UpdateSize()
 //
-//	Any time that a color flip is applied, it may cause pNode to end up
-//	with an invalid color relative to its parent node.  Therefore some kind
-//	of fix-up operation will be required after this function is called.
+//	Recomputes the key count of pNode from its children, which must already
+//	be correct.
 //
-static void ColorFlip(LLTB_t *pNode)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::UpdateSize(LLTB_t *pNode)
 {
-	pNode->IsRed = !pNode->IsRed;
-
-	if (NULL != pNode->pLeft) {
-		pNode->pLeft->IsRed  = !pNode->pLeft->IsRed;
-	}
-
-	if (NULL != pNode->pRight) {
-		pNode->pRight->IsRed = !pNode->pRight->IsRed;
-	}
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pNode->Size = 1 + SubtreeSize(pNode->pLeft) + SubtreeSize(pNode->pRight);
+#else
+	(void)pNode;
+#endif
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	Insert()
+//	CopySize()
 //
-bool LeftLeaningRedBlack::Insert(VoidRef_t ref)
+//	After a rotation, the new root of the subtree holds every key that the
+//	old root did.
+//
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::CopySize(LLTB_t *pTo, LLTB_t *pFrom)
 {
-	m_pRoot = InsertRec(m_pRoot, ref);
-
-	// The root node of a red-black tree must be black.
-	m_pRoot->IsRed = false;
-
-	return true;
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pTo->Size = pFrom->Size;
+#else
+	(void)pTo;
+	(void)pFrom;
+#endif
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	InsertRec()
+//	Count()
 //
-//	Note that during rebalancing, a rotation may change the value assigned
-//	to pNode.  This will change which node is the root of the subtree that
-//	is being modified.  The caller will need to use the returned pointer
-//	to replace whichever value was passed into InsertRec.
+//	Called by LLRBCore for each rebalancing step.  The op is always a
+//	constant at the call site, so once inlined this is a single increment.
 //
-LLTB_t* LeftLeaningRedBlack::InsertRec(LLTB_t* pNode, VoidRef_t ref)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::Count(LLRBOp_t op)
 {
-	// Special case for inserting a leaf.  Just return the pointer;
-	// the caller will insert the new node into the parent node.
-	if (NULL == pNode) {
-		pNode      = NewNode();
-		pNode->Ref = ref;
-		return pNode;
-	}
-
-	// If we perform the color flip here, the tree is assembled as a
-	// mapping of a 2-3-4 tree.
-#if defined(USE_234_TREE)
-	// This color flip will effectively split 4-nodes on the way down
-	// the tree (since 4-nodes must be represented by a node with two
-	// red children).  By performing the color flip here, the 4-nodes
-	// will remain in the tree after the insertion.
-	if (IsRed(pNode->pLeft) && IsRed(pNode->pRight)) {
-		ColorFlip(pNode);
+#if defined(USE_LLRB_STATS)
+	switch (op) {
+		case LLRBOp_RotateLeft:   LLRB_COUNT(m_Stats.RotateLeft);   break;
+		case LLRBOp_RotateRight:  LLRB_COUNT(m_Stats.RotateRight);  break;
+		case LLRBOp_ColorFlip:    LLRB_COUNT(m_Stats.ColorFlip);    break;
+		case LLRBOp_MoveRedLeft:  LLRB_COUNT(m_Stats.MoveRedLeft);  break;
+		case LLRBOp_MoveRedRight: LLRB_COUNT(m_Stats.MoveRedRight); break;
 	}
+#else
+	(void)op;
 #endif
+}
 
-	// Check to see if the value is already in the tree.  If so, we
-	// simply replace the value of the key, since duplicate keys are
-	// not allowed.
-	if (ref.Key == pNode->Ref.Key) {
-		pNode->Ref = ref;
-	}
-
-	// Otherwise recurse left or right depending on key value.
-	//
-	// Note: pLeft or pRight may be a NULL pointer before recursing.
-	// This indicates that pNode is a leaf (or only has one child),
-	// so the new node will be inserted using the return value.
-	//
-	// The other reason for pass-by-value, followed by an assignment,
-	// is that the recursive call may perform a rotation, so the
-	// pointer that gets passed in may end up not being the root of
-	// the subtree once the recursion returns.
-	//
-	else {
-		if (ref.Key < pNode->Ref.Key) {
-			pNode->pLeft = InsertRec(pNode->pLeft, ref);
-		}
-		else {
-			pNode->pRight = InsertRec(pNode->pRight, ref);
-		}
-	}
-
-	// If necessary, apply a rotation to get the correct representation
-	// in the parent node as we're backing out of the recursion.  This
-	// places the tree in a state where the parent can safely apply a
-	// rotation to restore the required black/red balance of the tree.
-
-	// Fix a right-leaning red node: this will assure that a 3-node is
-	// the left child.
-	if (IsRed(pNode->pRight) && (false == IsRed(pNode->pLeft))) {
-		pNode = RotateLeft(pNode);
-	}
-
-	// Fix two reds in a row: this will rebalance a 4-node.
-	if (IsRed(pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
-		pNode = RotateRight(pNode);
-	}
 
-	// If we perform the color flip here, the tree is assembled as a
-	// mapping of a 2-3 tree.
-#if !defined(USE_234_TREE)
-	// This color flip will effectively split 4-nodes on the way back
-	// out of the tree.  By doing this here, there will be no 4-nodes
-	// left in the tree after the insertion is complete.
-	if (IsRed(pNode->pLeft) && IsRed(pNode->pRight)) {
-		ColorFlip(pNode);
+/////////////////////////////////////////////////////////////////////////////
+//
+//	CompareKey()
+//
+template <class Policy>
+int LeftLeaningRedBlackT<Policy>::CompareKey(const int key, LLTB_t *pNode) const
+{
+	if (key == pNode->Ref.Key) {
+		return 0;
 	}
-#endif
 
-	// Return the new root of the subtree that was just updated,
-	// since rotations may have changed the value of this pointer.
-	return pNode;
+	return (key < pNode->Ref.Key) ? -1 : 1;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	MoveRedLeft()
+//	NewLeaf()
 //
-//	This code assumes that either pNode or pNode->pLeft are red.
+//	The key is already in ref, LLRBCore passes it separately since the map
+//	keeps its key and value apart.
 //
-static LLTB_t* MoveRedLeft(LLTB_t *pNode)
+template <class Policy>
+LLTB_t* LeftLeaningRedBlackT<Policy>::NewLeaf(const int, const VoidRef_t &ref)
 {
-	// If both children are black, we turn these three nodes into a
-	// 4-node by applying a color flip.
-	ColorFlip(pNode);
-
-	// But we may end up with a case where pRight has a red child.
-	// Apply a pair of rotations and a color flip to make pNode a
-	// red node, both of its children become black nodes, and pLeft
-	// becomes a 3-node.
-	if ((NULL != pNode->pRight) && IsRed(pNode->pRight->pLeft)) {
-		pNode->pRight = RotateRight(pNode->pRight);
-		pNode         = RotateLeft(pNode);
-
-		ColorFlip(pNode);
-	}
+	LLTB_t *pNode = NewNode();
+	pNode->Ref    = ref;
 
 	return pNode;
 }
@@ -393,196 +462,254 @@ static LLTB_t* MoveRedLeft(LLTB_t *pNode)
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	MoveRedRight()
-//
-//	This code assumes that either pNode or pNode->Right is a red node.
+//	Insert()
 //
-static LLTB_t* MoveRedRight(LLTB_t *pNode)
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::Insert(VoidRef_t ref)
 {
-	// Applying a color flip may turn pNode into a 4-node,
-	// with both of its children being red.
-	ColorFlip(pNode);
+	Core_t::Insert(*this, &m_pRoot, ref.Key, ref);
 
-	// However, this may cause a situation where both of pNode's
-	// children are red, along with pNode->pLeft->pLeft.  Applying a
-	// rotation and a color flip will fix this special case, since
-	// it makes pNode red and pNode's children black.
-	if ((NULL != pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
-		pNode = RotateRight(pNode);
-
-		ColorFlip(pNode);
-	}
-
-	return pNode;
+	return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	FindMin()
-//
-//	Find the node under pNode that contains the smallest key value.
+//	Delete()
 //
-static LLTB_t* FindMin(LLTB_t *pNode)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::Delete(const int key)
 {
-	while (NULL != pNode->pLeft) {
-		pNode = pNode->pLeft;
-	}
-
-	return pNode;
+	Core_t::Delete(*this, &m_pRoot, key);
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	FixUp()
+//	BulkBuild()
+//
+//	Replaces the contents of the tree with the given references, which must
+//	be sorted by strictly increasing key.  Returns false (leaving the tree
+//	unchanged) if the keys are out of order or contain duplicates.
+//
+//	Calling Insert() for each key costs O(n log n) and applies a lot of
+//	rotations and color flips that end up being undone later.  Since the
+//	keys are already in order, the tree can instead be laid out directly in
+//	O(n) time, visiting each key once.
 //
-//	Apply fix-up logic during deletion.  Applying color flips and rotations
-//	will preserve perfect black-link balance.  This will also fix any
-//	right-leaning red nodes and eliminate 4-nodes when backing out of
-//	recursive calls.
+//	The tree is built as a 2-3 tree with every leaf at the same depth.  The
+//	number of black levels is chosen so that each subtree can hold its share
+//	of the keys using a mix of 2-nodes (a black node) and 3-nodes (a black
+//	node with a red left child).  The result is a valid LLRB for both the
+//	2-3 and 2-3-4 configurations, so later inserts and deletes work as
+//	normal.
 //
-static LLTB_t* FixUp(LLTB_t *pNode)
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::BulkBuild(const VoidRef_t refs[], int count)
 {
-	// Fix right-leaning red nodes.
-	if (IsRed(pNode->pRight)) {
-		pNode = RotateLeft(pNode);
+	for (int i = 1; i < count; ++i) {
+		if (refs[i-1].Key >= refs[i].Key) {
+			return false;
+		}
 	}
 
-	// Detect if there is a 4-node that traverses down the left.
-	// This is fixed by a right rotation, making both of the red
-	// nodes the children of pNode.
-	if (IsRed(pNode->pLeft) && IsRed(pNode->pLeft->pLeft)) {
-		pNode = RotateRight(pNode);
+	FreeAll();
+
+	if (count <= 0) {
+		return true;
 	}
 
-	// Split 4-nodes.
-	if (IsRed(pNode->pLeft) && IsRed(pNode->pRight)) {
-		ColorFlip(pNode);
+	// maxKeys[h] is the largest number of keys that fit in a subtree with
+	// black height h, which happens when every node is a 3-node.  The
+	// smallest number is 2^h - 1, when every node is a 2-node.  An int key
+	// count never needs more than 31 levels, and 3^40 would overflow.
+	long long maxKeys[40];
+	maxKeys[0] = 0;
+	for (int h = 1; h < int(ArraySize(maxKeys)); ++h) {
+		maxKeys[h] = (3 * maxKeys[h-1]) + 2;
 	}
 
-	return pNode;
+	// Use the tallest black height that has enough keys to fill every
+	// level with 2-nodes.  The extra keys are absorbed by 3-nodes.
+	int blackHeight = 0;
+	while ((2LL << blackHeight) - 1 <= count) {
+		++blackHeight;
+	}
+
+	m_pRoot = BulkBuildRec(refs, count, blackHeight, maxKeys);
+
+	m_pRoot->IsRed = false;
+
+	return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	Delete()
+//	BulkBuildRec()
+//
+//	Builds a subtree with exactly blackHeight black nodes along every path,
+//	holding all count keys in refs[].  The caller guarantees that count is
+//	in the range [2^h - 1, 3^h - 1], which is always possible to satisfy.
+//
+//	A 2-node is used if the remaining keys can be split between two
+//	children.  Otherwise a 3-node is used, and the keys are split three
+//	ways.  Splitting evenly keeps each child within the range allowed for
+//	the next black height down.
 //
-void LeftLeaningRedBlack::Delete(const int key)
+template <class Policy>
+LLTB_t* LeftLeaningRedBlackT<Policy>::BulkBuildRec(const VoidRef_t refs[], int count, int blackHeight, const long long maxKeys[])
 {
-	if (NULL != m_pRoot) {
-		m_pRoot = DeleteRec(m_pRoot, key);
+	if (0 == count) {
+		return NULL;
+	}
 
-		// Assuming we have not deleted the last node from the tree, we
-		// need to force the root to be a black node to conform with the
-		// the rules of a red-black tree.
-		if (NULL != m_pRoot) {
-			m_pRoot->IsRed = false;
-		}
+	long long childMax = maxKeys[blackHeight - 1];
+
+	if ((count - 1) <= (2 * childMax)) {
+		int leftCount  = (count - 1) / 2;
+		int rightCount = count - 1 - leftCount;
+
+		LLTB_t *pNode = NewNode();
+		pNode->Ref    = refs[leftCount];
+		pNode->IsRed  = false;
+		pNode->pLeft  = BulkBuildRec(refs, leftCount, blackHeight - 1, maxKeys);
+		pNode->pRight = BulkBuildRec(refs + leftCount + 1, rightCount, blackHeight - 1, maxKeys);
+#if defined(USE_LLRB_SUBTREE_SIZE)
+		pNode->Size   = count;
+#endif
+
+		return pNode;
 	}
+
+	// 3-node: a black node with a red left child, and three subtrees.
+	int remain = count - 2;
+	int countA = remain / 3;
+	int countB = (remain - countA) / 2;
+	int countC = remain - countA - countB;
+
+	LLTB_t *pRed = NewNode();
+	pRed->Ref    = refs[countA];
+	pRed->IsRed  = true;
+	pRed->pLeft  = BulkBuildRec(refs, countA, blackHeight - 1, maxKeys);
+	pRed->pRight = BulkBuildRec(refs + countA + 1, countB, blackHeight - 1, maxKeys);
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pRed->Size   = countA + countB + 1;
+#endif
+
+	LLTB_t *pNode = NewNode();
+	pNode->Ref    = refs[countA + countB + 1];
+	pNode->IsRed  = false;
+	pNode->pLeft  = pRed;
+	pNode->pRight = BulkBuildRec(refs + countA + countB + 2, countC, blackHeight - 1, maxKeys);
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pNode->Size   = count;
+#endif
+
+	return pNode;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	DeleteRec()
+//	BulkMerge()
+//
+//	Inserts a batch of references, sorted by strictly increasing key, into
+//	the existing tree.  As with Insert(), a reference whose key is already
+//	in the tree replaces the old value.  Returns false (leaving the tree
+//	unchanged) if the batch is not sorted.
 //
-LLTB_t* LeftLeaningRedBlack::DeleteRec(LLTB_t *pNode, const int key)
+//	Small batches are inserted one key at a time, which costs about
+//	count * log(n).  Large batches are merged with an in-order copy of the
+//	tree, then the whole tree is rebuilt with BulkBuild(), which costs
+//	about n + count.
+//
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::BulkMerge(const VoidRef_t refs[], int count)
 {
-	if (key < pNode->Ref.Key) {
-		if (NULL != pNode->pLeft) {
-			// If pNode and pNode->pLeft are black, we may need to
-			// move pRight to become the left child if a deletion
-			// would produce a red node.
-			if ((false == IsRed(pNode->pLeft)) && (false == IsRed(pNode->pLeft->pLeft))) {
-				pNode = MoveRedLeft(pNode);
-			}
-
-			pNode->pLeft = DeleteRec(pNode->pLeft, key);
+	for (int i = 1; i < count; ++i) {
+		if (refs[i-1].Key >= refs[i].Key) {
+			return false;
 		}
 	}
-	else {
-		// If the left child is red, apply a rotation so we make
-		// the right child red.
-		if (IsRed(pNode->pLeft)) {
-			pNode = RotateRight(pNode);
-		}
 
-		// Special case for deletion of a leaf node.
-		// The arrangement logic of LLRBs assures that in this case,
-		// pNode cannot have a left child.
-		if ((key == pNode->Ref.Key) && (NULL == pNode->pRight)) {
-			Free(pNode);
-			return NULL;
+	int treeCount = KeyCount();
+
+	if (0 == treeCount) {
+		return BulkBuild(refs, count);
+	}
+
+	int logTotal = 1;
+	while ((1LL << logTotal) < (long long)(treeCount) + count) {
+		++logTotal;
+	}
+
+	if ((long long)(count) * logTotal < (long long)(treeCount) + count) {
+		for (int i = 0; i < count; ++i) {
+			Insert(refs[i]);
 		}
 
-		// If we get here, we need to traverse down the right node.
-		// However, if there is no right node, then the target key is
-		// not in the tree, so we can break out of the recursion.
-		if (NULL != pNode->pRight) {
-			if ((false == IsRed(pNode->pRight)) && (false == IsRed(pNode->pRight->pLeft))) {
-				pNode = MoveRedRight(pNode);
-			}
+		return true;
+	}
 
-			// Deletion of an internal node: We cannot delete this node
-			// from the tree, so we have to find the node containing
-			// the smallest key value that is larger than the key we're
-			// deleting.  This other key will replace the value we're
-			// deleting, then we can delete the node that previously
-			// held the key/value pair we just moved.
-			if (key == pNode->Ref.Key) {
-				pNode->Ref    = FindMin(pNode->pRight)->Ref;
-				pNode->pRight = DeleteMin(pNode->pRight);
-			}
-			else {
-				pNode->pRight = DeleteRec(pNode->pRight, key);
-			}
+	VoidRef_t *pOld = new VoidRef_t[treeCount];
+	VoidRef_t *pNew = new VoidRef_t[treeCount + count];
+
+	int oldCount = 0;
+	FlattenRec(m_pRoot, pOld, oldCount);
+
+	// Standard merge of two sorted arrays.  On a key collision the value
+	// from the batch wins.
+	int a = 0;
+	int b = 0;
+	int n = 0;
+
+	while ((a < oldCount) && (b < count)) {
+		if (pOld[a].Key < refs[b].Key) {
+			pNew[n++] = pOld[a++];
+		}
+		else if (refs[b].Key < pOld[a].Key) {
+			pNew[n++] = refs[b++];
+		}
+		else {
+			pNew[n++] = refs[b++];
+			++a;
 		}
 	}
 
-	// Fix right-leaning red nodes and eliminate 4-nodes on the way up.
-	// Need to avoid allowing search operations to terminate on 4-nodes,
-	// or searching may not locate intended key.
-	return FixUp(pNode);
+	while (a < oldCount) {
+		pNew[n++] = pOld[a++];
+	}
+
+	while (b < count) {
+		pNew[n++] = refs[b++];
+	}
+
+	BulkBuild(pNew, n);
+
+	SafeDeleteArray(pOld);
+	SafeDeleteArray(pNew);
+
+	return true;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 //
-//	DeleteMin()
+//	FlattenRec()
 //
-//	Delete the bottom node on the left spine while maintaining balance.
-//	To do so, we maintain the invariant that the current node or its left
-//	child is red.
+//	Copies the references from the subtree into refs[] in sorted order.
 //
-//	The only reason this is a member function instead of a static function
-//	like all of the other support functions is because it needs to call
-//	Free().
-//
-LLTB_t* LeftLeaningRedBlack::DeleteMin(LLTB_t *pNode)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::FlattenRec(LLTB_t *pNode, VoidRef_t refs[], int &index)
 {
-	// If this node has no children, we're done.
-	// Due to the arrangement of an LLRB tree, the node cannot have a
-	// right child.
-	if (NULL == pNode->pLeft) {
-		Free(pNode);
-		return NULL;
-	}
-
-	// If these nodes are black, we need to rearrange this subtree to
-	// force the left child to be red.
-	if ((false == IsRed(pNode->pLeft)) && (false == IsRed(pNode->pLeft->pLeft))) {
-		pNode = MoveRedLeft(pNode);
-	}
+	if (NULL != pNode) {
+		FlattenRec(pNode->pLeft, refs, index);
 
-	// Continue recursing to locate the node to delete.
-	pNode->pLeft = DeleteMin(pNode->pLeft);
+		refs[index++] = pNode->Ref;
 
-	// Fix right-leaning red nodes and eliminate 4-nodes on the way up.
-	// Need to avoid allowing search operations to terminate on 4-nodes,
-	// or searching may not locate intended key.
-	return FixUp(pNode);
+		FlattenRec(pNode->pRight, refs, index);
+	}
 }
 
 
@@ -590,7 +717,8 @@ LLTB_t* LeftLeaningRedBlack::DeleteMin(LLTB_t *pNode)
 //
 //	SanityCheck()
 //
-void LeftLeaningRedBlack::SanityCheck(void)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::SanityCheck(void)
 {
 	if (NULL != m_pRoot) {
 		int minBlack = 0xFFFFFFFF;
@@ -612,7 +740,8 @@ void LeftLeaningRedBlack::SanityCheck(void)
 //
 //	Verifies that the red-black tree is properly formed.
 //
-void LeftLeaningRedBlack::SanityCheckRec(LLTB_t *pNode, bool isParentRed, int blackDepth, int &minBlack, int &maxBlack)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::SanityCheckRec(LLTB_t *pNode, bool isParentRed, int blackDepth, int &minBlack, int &maxBlack)
 {
 	if (pNode->IsRed) {
 		// The parent of a red node must be black.
@@ -631,10 +760,10 @@ void LeftLeaningRedBlack::SanityCheckRec(LLTB_t *pNode, bool isParentRed, int bl
 	// Only apply this test if the LLRB is arranged as a 2-3 tree.
 	// Otherwise it is a 2-3-4 tree, in which case this rule does
 	// not apply.
-#if !defined(USE_234_TREE)
+	//
 	// If the node has two children, only one of them may be red.
 	// The other must be black.
-	if ((NULL != pNode->pLeft) && (NULL != pNode->pRight)) {
+	if ((false == Policy::SplitOnWayDown) && (NULL != pNode->pLeft) && (NULL != pNode->pRight)) {
 		if (IsRed(pNode->pLeft)) {
 			//QzAssert(false == IsRed(pNode->pRight));
 		}
@@ -642,6 +771,10 @@ void LeftLeaningRedBlack::SanityCheckRec(LLTB_t *pNode, bool isParentRed, int bl
 			//QzAssert(false == IsRed(pNode->pLeft));
 		}
 	}
+
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	// The key count must match the children.
+	//QzAssert(pNode->Size == 1 + SubtreeSize(pNode->pLeft) + SubtreeSize(pNode->pRight));
 #endif
 
 	if (NULL != pNode->pLeft) {
@@ -672,11 +805,17 @@ void LeftLeaningRedBlack::SanityCheckRec(LLTB_t *pNode, bool isParentRed, int bl
 //
 //	KeyCount()
 //
-//	Recursively count the number of keys in the tree.
+//	When subtree sizes are stored, the root already holds the count.
+//	Otherwise recursively count the number of keys in the tree.
 //
-int LeftLeaningRedBlack::KeyCount(void)
+template <class Policy>
+int LeftLeaningRedBlackT<Policy>::KeyCount(void)
 {
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	return SubtreeSize(m_pRoot);
+#else
 	return KeyCountRec(m_pRoot);
+#endif
 }
 
 
@@ -684,7 +823,8 @@ int LeftLeaningRedBlack::KeyCount(void)
 //
 //	KeyCountRec()
 //
-int LeftLeaningRedBlack::KeyCountRec(LLTB_t *pNode)
+template <class Policy>
+int LeftLeaningRedBlackT<Policy>::KeyCountRec(LLTB_t *pNode)
 {
 	int tally = 0;
 
@@ -718,38 +858,51 @@ int LeftLeaningRedBlack::KeyCountRec(LLTB_t *pNode)
 //	nodes found for each leaf.  Due to the nature of a red-black tree, these
 //	two values must be the same.
 //
-void LeftLeaningRedBlack::LeafDepth(void)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::LeafDepth(void)
 {
-	// This array will be used to track the number of nodes at each depth of
-	// the binary tree.  This is the true depth of each node, not the black
-	// depth.
-	int ary[64];
-	for (size_t i = 0; i < ArraySize(ary); ++i) {
-		ary[i] = 0;
-	}
-
-	int maxDepth = 0;
-	int minBlack = 0xFFFFFFFF;
-	int maxBlack = 0;
-
-	if (NULL != m_pRoot) {
-		maxDepth = LeafDepthRec(m_pRoot, 0, ary, ArraySize(ary), 0, minBlack, maxBlack);
-	}
+	LLRBDepthHistogram_t hist;
+	DepthHistogram(hist);
 
 	int tally = 0;
 
-	for (int i = 0; i < maxDepth; ++i) {
-		tally += ary[i];
+	for (int i = 0; i < hist.Height; ++i) {
+		tally += hist.NodeCount[i];
 
-		printf("%3d: %5d = %5d\n", i, ary[i], tally);
+		printf("%3d: %5d = %5d\n", i, hist.NodeCount[i], tally);
 	}
 
-	printf("black depth: %d to %d\n", minBlack, maxBlack);
+	printf("black depth: %d to %d\n", hist.MinBlackDepth, hist.MaxBlackDepth);
 
 	// All leaf nodes must have the same number of black nodes between the
 	// root and each leaf.  Therefore the minimum and maximum number of black
 	// nodes must be the same.
-	//QzAssert(minBlack == maxBlack);
+	//QzAssert(hist.MinBlackDepth == hist.MaxBlackDepth);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	DepthHistogram()
+//
+//	Fills in the counts that LeafDepth() reports, so they can be examined
+//	by the caller instead of being printed.  This is the true depth of each
+//	node, not the black depth.  An empty tree has a height of zero and a
+//	black depth of zero.
+//
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::DepthHistogram(LLRBDepthHistogram_t &hist)
+{
+	SafeZeroVar(hist);
+
+	if (NULL != m_pRoot) {
+		int minBlack = 0x7FFFFFFF;
+		int maxBlack = 0;
+
+		hist.Height        = LeafDepthRec(m_pRoot, 0, hist.NodeCount, ArraySize(hist.NodeCount), 0, minBlack, maxBlack);
+		hist.MinBlackDepth = minBlack;
+		hist.MaxBlackDepth = maxBlack;
+	}
 }
 
 
@@ -757,7 +910,8 @@ void LeftLeaningRedBlack::LeafDepth(void)
 //
 //	LeafDepthRec()
 //
-int LeftLeaningRedBlack::LeafDepthRec(LLTB_t *pNode, int depth, int ary[], int depthLimit, int blackDepth, int &minBlack, int &maxBlack)
+template <class Policy>
+int LeftLeaningRedBlackT<Policy>::LeafDepthRec(LLTB_t *pNode, int depth, int ary[], int depthLimit, int blackDepth, int &minBlack, int &maxBlack)
 {
 	// Increment the count of nodes at the current depth of the tree.
 	ary[depth] += 1;
@@ -768,8 +922,11 @@ int LeftLeaningRedBlack::LeafDepthRec(LLTB_t *pNode, int depth, int ary[], int d
 		++blackDepth;
 	}
 
-	// If this is a leaf node, return the total depth of this node.
+	// If this is a leaf node, record its black depth and return the total
+	// depth of this node.
 	if ((NULL == pNode->pLeft) && (NULL == pNode->pRight)) {
+		minBlack = Min(minBlack, blackDepth);
+		maxBlack = Max(maxBlack, blackDepth);
 		return depth + 1;
 	}
 
@@ -812,7 +969,8 @@ int LeftLeaningRedBlack::LeafDepthRec(LLTB_t *pNode, int depth, int ary[], int d
 //	Perform an in-order traversal of the tree, printing out all of the key
 //	values in the tree.  This should display all keys in their sorted order.
 //
-void LeftLeaningRedBlack::Traverse(void)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::Traverse(void)
 {
 	if (NULL != m_pRoot) {
 		int prev = 0;
@@ -825,7 +983,8 @@ void LeftLeaningRedBlack::Traverse(void)
 //
 //	TraverseRec()
 //
-void LeftLeaningRedBlack::TraverseRec(LLTB_t *pNode, int &prev)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::TraverseRec(LLTB_t *pNode, int &prev)
 {
 	//QzAssert(NULL != pNode);
 
@@ -845,7 +1004,8 @@ void LeftLeaningRedBlack::TraverseRec(LLTB_t *pNode, int &prev)
 	}
 }
 
-bool LeftLeaningRedBlack::printParentRec(LLTB_t *pNode, int key)
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::printParentRec(LLTB_t *pNode, int key)
 {
     //if tree is empty aka no immediate parent
     if(pNode == NULL)
@@ -863,12 +1023,14 @@ bool LeftLeaningRedBlack::printParentRec(LLTB_t *pNode, int key)
 
     return false;
 }
-bool LeftLeaningRedBlack::printParent(int key)
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::printParent(int key)
 {
     return printParentRec(m_pRoot, key);
 }
 
-LLTB_t* LeftLeaningRedBlack::searchRec(LLTB_t *pNode, int key)
+template <class Policy>
+LLTB_t* LeftLeaningRedBlackT<Policy>::searchRec(LLTB_t *pNode, int key)
 {
     if(pNode == NULL)
         return pNode;
@@ -883,10 +1045,544 @@ LLTB_t* LeftLeaningRedBlack::searchRec(LLTB_t *pNode, int key)
 
 }
 
-void LeftLeaningRedBlack::printNode(int key)
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::printNode(int key)
 {
     LLTB_t* pNode = searchRec(m_pRoot, key);
 
     std::cout << " " << pNode->Ref.Key << " (" << (pNode->IsRed ? "Red" : "Black") << ")";
 }
 
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	begin()
+//
+template <class Policy>
+LLRBIterator LeftLeaningRedBlackT<Policy>::begin(void)
+{
+	LLRBIterator it;
+	it.m_pRoot = m_pRoot;
+	it.PushLeftSpine(m_pRoot);
+
+	return it;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	end()
+//
+template <class Policy>
+LLRBIterator LeftLeaningRedBlackT<Policy>::end(void)
+{
+	LLRBIterator it;
+	it.m_pRoot = m_pRoot;
+
+	return it;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	lower_bound()
+//
+//	Returns an iterator to the first key that is not less than key, or
+//	end() if every key is less than key.
+//
+//	The search records the full path as it descends.  The result is the
+//	last node where the search went left (or matched), so the path is
+//	truncated back to that node once the search reaches the bottom.
+//
+template <class Policy>
+LLRBIterator LeftLeaningRedBlackT<Policy>::lower_bound(const int key)
+{
+	LLRBIterator it;
+	it.m_pRoot = m_pRoot;
+
+	int     found = 0;
+	LLTB_t *pNode = m_pRoot;
+
+	while (NULL != pNode) {
+		it.m_Path[it.m_Depth++] = pNode;
+
+		if (key == pNode->Ref.Key) {
+			return it;
+		}
+
+		if (key < pNode->Ref.Key) {
+			found = it.m_Depth;
+			pNode = pNode->pLeft;
+		}
+		else {
+			pNode = pNode->pRight;
+		}
+	}
+
+	it.m_Depth = found;
+
+	return it;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	upper_bound()
+//
+//	Returns an iterator to the first key that is greater than key, or
+//	end() if there is no such key.
+//
+template <class Policy>
+LLRBIterator LeftLeaningRedBlackT<Policy>::upper_bound(const int key)
+{
+	LLRBIterator it;
+	it.m_pRoot = m_pRoot;
+
+	int     found = 0;
+	LLTB_t *pNode = m_pRoot;
+
+	while (NULL != pNode) {
+		it.m_Path[it.m_Depth++] = pNode;
+
+		if (key < pNode->Ref.Key) {
+			found = it.m_Depth;
+			pNode = pNode->pLeft;
+		}
+		else {
+			pNode = pNode->pRight;
+		}
+	}
+
+	it.m_Depth = found;
+
+	return it;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBIterator::PushLeftSpine()
+//
+//	Descends from pNode to the smallest key in its subtree.
+//
+void LLRBIterator::PushLeftSpine(LLTB_t *pNode)
+{
+	while (NULL != pNode) {
+		m_Path[m_Depth++] = pNode;
+		pNode = pNode->pLeft;
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBIterator::PushRightSpine()
+//
+//	Descends from pNode to the largest key in its subtree.
+//
+void LLRBIterator::PushRightSpine(LLTB_t *pNode)
+{
+	while (NULL != pNode) {
+		m_Path[m_Depth++] = pNode;
+		pNode = pNode->pRight;
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBIterator::operator++()
+//
+//	If the current node has a right subtree, the next key is the smallest
+//	key in that subtree.  Otherwise back up the path until we arrive at a
+//	parent from its left child.  Backing out of the root means the iterator
+//	has reached end().
+//
+LLRBIterator& LLRBIterator::operator++(void)
+{
+	LLTB_t *pNode = m_Path[m_Depth - 1];
+
+	if (NULL != pNode->pRight) {
+		PushLeftSpine(pNode->pRight);
+		return *this;
+	}
+
+	while (--m_Depth > 0) {
+		if (m_Path[m_Depth - 1]->pLeft == pNode) {
+			break;
+		}
+
+		pNode = m_Path[m_Depth - 1];
+	}
+
+	return *this;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBIterator::operator--()
+//
+//	Mirror image of operator++().  Decrementing end() moves to the largest
+//	key in the tree.
+//
+LLRBIterator& LLRBIterator::operator--(void)
+{
+	if (0 == m_Depth) {
+		PushRightSpine(m_pRoot);
+		return *this;
+	}
+
+	LLTB_t *pNode = m_Path[m_Depth - 1];
+
+	if (NULL != pNode->pLeft) {
+		PushRightSpine(pNode->pLeft);
+		return *this;
+	}
+
+	while (--m_Depth > 0) {
+		if (m_Path[m_Depth - 1]->pRight == pNode) {
+			break;
+		}
+
+		pNode = m_Path[m_Depth - 1];
+	}
+
+	return *this;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Rank()
+//
+//	Returns the number of keys in the tree that are less than key.  This is
+//	also the index that key has (or would have) in sorted order.
+//
+//	With subtree sizes, each step to the right skips over the left subtree
+//	and the node itself, so this is O(log n).  Without them, the keys are
+//	counted one at a time.
+//
+template <class Policy>
+int LeftLeaningRedBlackT<Policy>::Rank(const int key)
+{
+	int rank = 0;
+
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	LLTB_t *pNode = m_pRoot;
+
+	while (NULL != pNode) {
+		if (key <= pNode->Ref.Key) {
+			if (key == pNode->Ref.Key) {
+				return rank + SubtreeSize(pNode->pLeft);
+			}
+
+			pNode = pNode->pLeft;
+		}
+		else {
+			rank += 1 + SubtreeSize(pNode->pLeft);
+			pNode = pNode->pRight;
+		}
+	}
+#else
+	for (LLRBIterator it = begin(); (it != end()) && (it->Key < key); ++it) {
+		++rank;
+	}
+#endif
+
+	return rank;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Select()
+//
+//	Returns an iterator to the key at the given zero-based position in
+//	sorted order, or end() if the index is out of range.  The iterator can
+//	be used to continue walking the keys from that point, such as scanning
+//	everything above a percentile.
+//
+template <class Policy>
+LLRBIterator LeftLeaningRedBlackT<Policy>::Select(int index)
+{
+	if ((index < 0) || (index >= KeyCount())) {
+		return end();
+	}
+
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	LLRBIterator it;
+	it.m_pRoot = m_pRoot;
+
+	LLTB_t *pNode = m_pRoot;
+
+	for (;;) {
+		it.m_Path[it.m_Depth++] = pNode;
+
+		int leftSize = SubtreeSize(pNode->pLeft);
+
+		if (index == leftSize) {
+			return it;
+		}
+
+		if (index < leftSize) {
+			pNode = pNode->pLeft;
+		}
+		else {
+			index -= leftSize + 1;
+			pNode  = pNode->pRight;
+		}
+	}
+#else
+	LLRBIterator it = begin();
+
+	while (index-- > 0) {
+		++it;
+	}
+
+	return it;
+#endif
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SaveSnapshot()
+//
+//	Writes the tree to a file that LLRBSnapshot can map and search in place
+//	(see LLRBSnapshot.h).  The whole node array is built in memory first,
+//	since a node's offset is not known until its left subtree has been
+//	numbered, then written with a single call.
+//
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::SaveSnapshot(const char filename[])
+{
+	uint32_t count = uint32_t(KeyCount());
+
+	LLRBSnapshotNode_t *pNodes = new LLRBSnapshotNode_t[Max(count, 1u)];
+
+	uint32_t next = 0;
+	uint32_t root = SaveSnapshotRec(m_pRoot, pNodes, next);
+
+	bool success = LLRBSnapshot::Write(filename, pNodes, count, root, Policy::SplitOnWayDown);
+
+	SafeDeleteArray(pNodes);
+
+	return success;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SaveSnapshotRec()
+//
+//	Numbers the nodes in sorted order.  Returns the offset of pNode, which
+//	is its index in the array plus one, or zero for a NULL node.
+//
+template <class Policy>
+uint32_t LeftLeaningRedBlackT<Policy>::SaveSnapshotRec(LLTB_t *pNode, LLRBSnapshotNode_t nodes[], uint32_t &next)
+{
+	if (NULL == pNode) {
+		return 0;
+	}
+
+	uint32_t left  = SaveSnapshotRec(pNode->pLeft, nodes, next);
+	uint32_t index = next++;
+	uint32_t right = SaveSnapshotRec(pNode->pRight, nodes, next);
+
+	LLRBSnapshotNode_t &node = nodes[index];
+	node.Key   = pNode->Ref.Key;
+	node.Left  = left;
+	node.Right = right;
+	node.IsRed = pNode->IsRed ? 1 : 0;
+	node.Value = uint64_t(reinterpret_cast<uintptr_t>(pNode->Ref.pContext));
+
+	return index + 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LoadSnapshot()
+//
+//	Replaces the contents of the tree with a mapped snapshot, which is how
+//	the tree is brought back once it needs to be modified again.
+//
+//	When the snapshot was written by a tree with the same split policy (or
+//	by a 2-3 tree, since every 2-3 tree is also a valid 2-3-4 tree), the
+//	nodes are copied with their colors and links intact, so there are no
+//	comparisons or rotations.  Nodes are allocated in key order, which also
+//	leaves them in key order within the slabs.  A 2-3-4 snapshot can contain
+//	4-nodes, which a 2-3 tree never has, so those are rebuilt from the
+//	sorted node array with BulkBuild() instead.
+//
+//	The snapshot is checked while it is being copied.  If it is damaged,
+//	the tree is left empty and this returns false.
+//
+template <class Policy>
+bool LeftLeaningRedBlackT<Policy>::LoadSnapshot(const LLRBSnapshot &snapshot)
+{
+	if (false == snapshot.IsOpen()) {
+		return false;
+	}
+
+	const LLRBSnapshotNode_t *pNodes = snapshot.Nodes();
+	uint32_t                  count  = snapshot.KeyCount();
+
+	if (snapshot.SplitOnWayDown() && !Policy::SplitOnWayDown) {
+		VoidRef_t *pRefs = new VoidRef_t[Max(count, 1u)];
+
+		for (uint32_t i = 0; i < count; ++i) {
+			pRefs[i].Key      = pNodes[i].Key;
+			pRefs[i].pContext = reinterpret_cast<void*>(uintptr_t(pNodes[i].Value));
+		}
+
+		bool success = BulkBuild(pRefs, int(count));
+
+		SafeDeleteArray(pRefs);
+
+		return success;
+	}
+
+	FreeAll();
+
+	bool valid       = true;
+	int  blackHeight = 0;
+	m_pRoot = LoadSnapshotRec(pNodes, snapshot.Root(), 0, count, 0, blackHeight, valid);
+
+	if (false == valid) {
+		FreeAll();
+		return false;
+	}
+
+	if (NULL != m_pRoot) {
+		m_pRoot->IsRed = false;
+	}
+
+	return true;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LoadSnapshotRec()
+//
+//	Copies the subtree at link, which must hold exactly the nodes lo through
+//	hi - 1 of the array.  Enforcing those bounds means that every node is
+//	copied at most once even if the links are damaged.  Comparing each key
+//	with the one before it in the array catches keys that are out of order.
+//
+//	The colors are checked as well: both subtrees must have the same black
+//	height, a red node cannot have a red child, and a red right child
+//	needs a red left sibling.  Without this, a damaged color bit would
+//	quietly produce a tree that is no longer balanced.
+//
+//	A partly copied subtree is still returned when valid is cleared, so
+//	that it is linked into the tree and can be freed along with the rest.
+//
+template <class Policy>
+LLTB_t* LeftLeaningRedBlackT<Policy>::LoadSnapshotRec(const LLRBSnapshotNode_t nodes[], uint32_t link, uint32_t lo, uint32_t hi, int depth, int &blackHeight, bool &valid)
+{
+	if (false == valid) {
+		return NULL;
+	}
+
+	if (0 == link) {
+		blackHeight = 0;
+		valid       = (lo == hi);
+		return NULL;
+	}
+
+	uint32_t index = link - 1;
+
+	if ((index < lo) || (index >= hi) || (depth >= LLRB_MAX_DEPTH) ||
+		((index > 0) && (nodes[index-1].Key >= nodes[index].Key)))
+	{
+		valid = false;
+		return NULL;
+	}
+
+	const LLRBSnapshotNode_t &node = nodes[index];
+
+	int leftHeight  = 0;
+	int rightHeight = 0;
+
+	LLTB_t *pLeft = LoadSnapshotRec(nodes, node.Left, lo, index, depth + 1, leftHeight, valid);
+
+	LLTB_t *pNode = NewNode();
+	pNode->Ref.Key      = node.Key;
+	pNode->Ref.pContext = reinterpret_cast<void*>(uintptr_t(node.Value));
+	pNode->IsRed        = (0 != node.IsRed);
+	pNode->pLeft        = pLeft;
+	pNode->pRight       = LoadSnapshotRec(nodes, node.Right, index + 1, hi, depth + 1, rightHeight, valid);
+
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	pNode->Size = int(hi - lo);
+#endif
+
+	if ((leftHeight != rightHeight) ||
+		(pNode->IsRed && (IsRed(pNode->pLeft) || IsRed(pNode->pRight))) ||
+		(IsRed(pNode->pRight) && !IsRed(pNode->pLeft)))
+	{
+		valid = false;
+	}
+
+	blackHeight = leftHeight + (pNode->IsRed ? 0 : 1);
+
+	return pNode;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Stats()
+//
+//	Returns a copy of the counts, with the look-up counts of every shard
+//	added together.  If look-ups are running on other threads the look-up
+//	counts are only a close snapshot, since they keep changing while they
+//	are being copied.
+//
+template <class Policy>
+LLRBStats_t LeftLeaningRedBlackT<Policy>::Stats(void) const
+{
+	LLRBStats_t stats = m_Stats;
+
+	stats.LookUps         = 0;
+	stats.LookUpNodeTotal = 0;
+
+	for (int n = 0; n <= LLRB_MAX_DEPTH; ++n) {
+		long long count = 0;
+
+		for (int shard = 0; shard < LLRB_STAT_SHARDS; ++shard) {
+			count += m_LookUpCounts[shard].LookUpNodes[n].load(std::memory_order_relaxed);
+		}
+
+		stats.LookUpNodes[n]   = count;
+		stats.LookUps         += count;
+		stats.LookUpNodeTotal += count * n;
+	}
+
+	return stats;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ResetStats()
+//
+template <class Policy>
+void LeftLeaningRedBlackT<Policy>::ResetStats(void)
+{
+	SafeZeroVar(m_Stats);
+
+	for (int shard = 0; shard < LLRB_STAT_SHARDS; ++shard) {
+		for (int n = 0; n <= LLRB_MAX_DEPTH; ++n) {
+			m_LookUpCounts[shard].LookUpNodes[n].store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+// Generate code for both arrangements of the tree.
+template class LeftLeaningRedBlackT<LLRB23Policy>;
+template class LeftLeaningRedBlackT<LLRB234Policy>;
@@ -17,12 +17,13 @@
 //	the node a 4-node.
 //
 //	Depending on how values are inserted into the tree, the tree may emulate
-//	either a 2-3 tree or a 2-3-4 tree.  The USE_234_TREE symbol controls
-//	which rule is applied.  Empirically, 2-3 trees are slightly faster for
-//	insertions and look-ups, since fewer special cases are triggered due to
-//	how the nodes in the tree are arranged.  Test it if it matters, but in
-//	general, leave the USE_234_TREE symbol undefined for better overall
-//	performance.
+//	either a 2-3 tree or a 2-3-4 tree.  The split policy that the tree
+//	template is instantiated with controls which rule is applied, so both
+//	arrangements can be used in the same program.  Empirically, 2-3 trees
+//	are slightly faster for insertions and look-ups, since fewer special
+//	cases are triggered due to how the nodes in the tree are arranged.  Test
+//	it if it matters (see BenchmarkSplitPolicy()), but in general, use the
+//	2-3 policy for better overall performance.
 //
 //	By enforcing the left-leaning rule, fewer special cases need to be tested
 //	when performing insertions and deletions, meaning that less code needs to
@@ -51,10 +52,15 @@
 
 
 #include "VoidRef.h"
+#include "SlabAllocator.h"
+#include "LLRBCore.h"
+#include <atomic>
 #include <cstddef>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <iostream>
+#include <iterator>
 
 //Function includes from QzCommon.h
 
@@ -78,25 +84,246 @@
 
 template <class T> void Swap(T &a, T &b) { T temp; temp = a; a = b; b = temp; }
 
+// Define this symbol to store the number of keys in each node's subtree.
+// This makes KeyCount() O(1) and lets Rank() and Select() run in O(log n)
+// instead of walking the tree.  The count fits into padding that follows
+// IsRed, so LLTB_t does not grow, but every rotation has to update it.
+//
+#define USE_LLRB_SUBTREE_SIZE
+
+
 struct LLTB_t
 {
 	VoidRef_t Ref;
 
 	bool IsRed;
 
+#if defined(USE_LLRB_SUBTREE_SIZE)
+	int Size;
+#endif
+
 	LLTB_t *pLeft;
 	LLTB_t *pRight;
 };
 
 
-class LeftLeaningRedBlack
+// Number of keys that LookUpBatch() walks down the tree together.  This
+// needs to be large enough that the prefetches cover the latency of a
+// cache miss, but every key in the group needs its own register or stack
+// slot, so there is nothing to gain from going much larger.
+#define LLRB_BATCH_SIZE		16
+
+
+// Define this symbol to count the rebalancing operations and the nodes
+// visited by LookUp().  Each count is a single increment of a member of
+// the tree, so it is cheap enough to leave on.  When it is not defined the
+// counting code is compiled out, and Stats() always reports zeros.
+//
+// The rebalancing counts are only written by Insert() and Delete(), which
+// already need the tree to themselves.  The look-up counts are written by
+// LookUp() and LookUpBatch(), which may run on several threads at once, so
+// those are kept in atomics and bumped with LLRB_COUNT_SHARED(), in one of
+// LLRB_STAT_SHARDS copies picked by the thread doing the look-up.
+//
+#define USE_LLRB_STATS
+
+// Number of copies of the look-up counts.  Each copy has its own cache
+// lines, so up to this many reader threads never write to the same line.
+#define LLRB_STAT_SHARDS	16
+
+#if defined(USE_LLRB_STATS)
+#define LLRB_COUNT(x)				(++(x))
+#define LLRB_COUNT_SHARED(x, n)		LLRBBump(x, n)
+#else
+#define LLRB_COUNT(x)
+#define LLRB_COUNT_SHARED(x, n)
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBBump()
+//
+//	A relaxed load followed by a relaxed store compiles to the same code as
+//	++ on a plain integer, without the locked instruction that fetch_add()
+//	needs, and without the data race that ++ would be.  When two threads
+//	bump the same counter at the same moment one of the increments can be
+//	lost.  Threads only share a shard when there are more than
+//	LLRB_STAT_SHARDS of them, so this rarely happens.
+//
+inline void LLRBBump(std::atomic<long long> &counter, long long amount)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBStats_t
+//
+//	Operation counts since the stats were last reset.
+//
+//	LookUpNodes[n] is the number of look-ups that visited exactly n nodes
+//	before finding the key or running off the bottom of the tree.  The
+//	shape of this histogram shows where slow look-ups come from, which an
+//	average would hide.
+//
+struct LLRBStats_t
+{
+	long long RotateLeft;
+	long long RotateRight;
+	long long ColorFlip;
+	long long MoveRedLeft;
+	long long MoveRedRight;
+
+	long long LookUps;
+	long long LookUpNodeTotal;
+	long long LookUpNodes[LLRB_MAX_DEPTH + 1];
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBLookUpCounts_t
+//
+//	One shard of the look-up half of LLRBStats_t, as the tree stores it.
+//	Only the histogram is kept, so a look-up does a single store.  Stats()
+//	adds up the shards and works out LookUps and LookUpNodeTotal from the
+//	histogram.
+//
+struct alignas(64) LLRBLookUpCounts_t
+{
+	std::atomic<long long> LookUpNodes[LLRB_MAX_DEPTH + 1];
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBDepthHistogram_t
+//
+//	Shape of the tree as measured by LeafDepth().  NodeCount[d] is the
+//	number of nodes at depth d, where the root is at depth 0.  All leaves
+//	should have the same black depth, so MinBlackDepth and MaxBlackDepth
+//	will match in a valid tree.
+//
+struct LLRBDepthHistogram_t
+{
+	int NodeCount[LLRB_MAX_DEPTH];
+	int Height;
+	int MinBlackDepth;
+	int MaxBlackDepth;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LLRBIterator
+//
+//	Bidirectional in-order iterator.  There are no parent pointers in the
+//	tree, so the iterator records the path from the root down to the
+//	current node.  Stepping to the next or previous key is amortized O(1).
+//
+//	An iterator with an empty path is the end() position.  Any Insert() or
+//	Delete() will invalidate all iterators, since rotations rearrange the
+//	paths.
+//
+class LLRBIterator
 {
+	template <class Policy> friend class LeftLeaningRedBlackT;
+
 private:
 	LLTB_t* m_pRoot;
+	LLTB_t* m_Path[LLRB_MAX_DEPTH];
+	int     m_Depth;
+
+	void PushLeftSpine(LLTB_t *pNode);
+	void PushRightSpine(LLTB_t *pNode);
 
 public:
-	LeftLeaningRedBlack(void);
-	~LeftLeaningRedBlack(void);
+	typedef std::bidirectional_iterator_tag iterator_category;
+	typedef VoidRef_t                       value_type;
+	typedef std::ptrdiff_t                  difference_type;
+	typedef const VoidRef_t*                pointer;
+	typedef const VoidRef_t&                reference;
+
+	LLRBIterator(void) : m_pRoot(NULL), m_Depth(0) { }
+
+	LLTB_t* Node(void) const { return (m_Depth > 0) ? m_Path[m_Depth - 1] : NULL; }
+
+	reference operator*(void) const  { return m_Path[m_Depth - 1]->Ref; }
+	pointer   operator->(void) const { return &(m_Path[m_Depth - 1]->Ref); }
+
+	LLRBIterator& operator++(void);
+	LLRBIterator& operator--(void);
+
+	LLRBIterator operator++(int) { LLRBIterator temp = *this; ++(*this); return temp; }
+	LLRBIterator operator--(int) { LLRBIterator temp = *this; --(*this); return temp; }
+
+	bool operator==(const LLRBIterator &other) const { return Node() == other.Node(); }
+	bool operator!=(const LLRBIterator &other) const { return Node() != other.Node(); }
+};
+
+
+// Defined in LLRBSnapshot.h.
+class  LLRBSnapshot;
+struct LLRBSnapshotNode_t;
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LeftLeaningRedBlackT
+//
+//	The member functions are defined in LeftLeaningRedBlack.cpp, which
+//	explicitly instantiates the tree for both split policies.  Insertion
+//	and deletion are done by LLRBCore, through the accessors and hooks
+//	declared below.
+//
+template <class Policy>
+class LeftLeaningRedBlackT
+{
+private:
+	typedef LLRBCore<Policy, LeftLeaningRedBlackT> Core_t;
+	friend class LLRBCore<Policy, LeftLeaningRedBlackT>;
+
+	typedef LLTB_t   Node_t;
+	typedef LLTB_t** Link_t;
+
+	LLTB_t* m_pRoot;
+
+	// Nodes are pooled in slabs owned by the tree unless the caller asks
+	// for the old one-heap-allocation-per-node behavior.
+	SlabAllocator m_Slab;
+	bool          m_UseSlab;
+
+	// Only the rebalancing counts of m_Stats are used, the look-up counts
+	// are kept separately since they are written by readers.
+	LLRBStats_t        m_Stats;
+	LLRBLookUpCounts_t m_LookUpCounts[LLRB_STAT_SHARDS];
+
+	static LLTB_t*  Get(LLTB_t **ppLink)                { return *ppLink; }
+	static void     Set(LLTB_t **ppLink, LLTB_t *pNode) { *ppLink = pNode; }
+	static LLTB_t** LeftLink(LLTB_t *pNode)             { return &(pNode->pLeft); }
+	static LLTB_t** RightLink(LLTB_t *pNode)            { return &(pNode->pRight); }
+	static LLTB_t*  Left(LLTB_t *pNode)                 { return pNode->pLeft; }
+	static LLTB_t*  Right(LLTB_t *pNode)                { return pNode->pRight; }
+
+	static bool IsRed(LLTB_t *pNode)               { return (NULL != pNode) && pNode->IsRed; }
+	static void SetRed(LLTB_t *pNode, bool isRed)  { pNode->IsRed = isRed; }
+	static void FlipRed(LLTB_t *pNode)             { pNode->IsRed = !pNode->IsRed; }
+
+	static void UpdateSize(LLTB_t *pNode);
+	static void CopySize(LLTB_t *pTo, LLTB_t *pFrom);
+
+	void    Count(LLRBOp_t op);
+	int     CompareKey(const int key, LLTB_t *pNode) const;
+	LLTB_t* NewLeaf(const int key, const VoidRef_t &ref);
+	void    ReplaceItem(LLTB_t *pNode, const VoidRef_t &ref) { pNode->Ref = ref; }
+	void    MoveItem(LLTB_t *pTo, LLTB_t *pFrom)            { pTo->Ref = pFrom->Ref; }
+
+public:
+	LeftLeaningRedBlackT(bool useSlab = true);
+	LeftLeaningRedBlackT(const VoidRef_t refs[], int count, bool useSlab = true);
+	~LeftLeaningRedBlackT(void);
 
 	bool IsEmpty(void) { return NULL == m_pRoot; }
 
@@ -104,15 +331,34 @@ public:
 	void Free(LLTB_t *pNode);
 
 	LLTB_t* NewNode(void);
+	void    ReleaseNode(LLTB_t *pNode);
 
 	void* LookUp(const int value);
+	void  LookUpBatch(const int keys[], void* out[], size_t count);
 
 	bool Insert(VoidRef_t ref);
-	LLTB_t* InsertRec(LLTB_t *pNode, VoidRef_t ref);
-
 	void Delete(const int value);
-	LLTB_t* DeleteRec(LLTB_t *pNode, const int value);
-	LLTB_t* DeleteMin(LLTB_t *pNode);
+
+	bool    BulkBuild(const VoidRef_t refs[], int count);
+	LLTB_t* BulkBuildRec(const VoidRef_t refs[], int count, int blackHeight, const long long maxKeys[]);
+	bool    BulkMerge(const VoidRef_t refs[], int count);
+	void    FlattenRec(LLTB_t *pNode, VoidRef_t refs[], int &index);
+
+	bool     SaveSnapshot(const char filename[]);
+	uint32_t SaveSnapshotRec(LLTB_t *pNode, LLRBSnapshotNode_t nodes[], uint32_t &next);
+	bool     LoadSnapshot(const LLRBSnapshot &snapshot);
+	LLTB_t*  LoadSnapshotRec(const LLRBSnapshotNode_t nodes[], uint32_t link, uint32_t lo, uint32_t hi, int depth, int &blackHeight, bool &valid);
+
+	typedef LLRBIterator iterator;
+	typedef LLRBIterator const_iterator;
+
+	LLRBIterator begin(void);
+	LLRBIterator end(void);
+	LLRBIterator lower_bound(const int key);
+	LLRBIterator upper_bound(const int key);
+
+	template <class Fn> void ForEachInRange(const int lo, const int hi, Fn fn);
+	template <class Fn> void ForEachInRangeRec(LLTB_t *pNode, const int lo, const int hi, Fn &fn);
 
 	void SanityCheck(void);
 	void SanityCheckRec(LLTB_t *pNode, bool isParentRed, int blackDepth, int &minBlack, int &maxBlack);
@@ -120,6 +366,14 @@ public:
 	int  KeyCount(void);
 	int  KeyCountRec(LLTB_t *pNode);
 
+	int          Rank(const int key);
+	LLRBIterator Select(int index);
+
+	LLRBStats_t Stats(void) const;
+	void        ResetStats(void);
+
+	void DepthHistogram(LLRBDepthHistogram_t &hist);
+
 	void LeafDepth(void);
 	int  LeafDepthRec(LLTB_t *pNode, int depth, int ary[], int depthLimit, int blackDepth, int &minBlack, int &maxBlack);
 
@@ -135,4 +389,71 @@ public:
 };
 
 
+// Define this symbol to make LeftLeaningRedBlack a 2-3-4 tree.  If this is
+// not defined, it is arranged as a 2-3 tree.  Either variant can always be
+// named directly.
+//
+// In general, defining this symbol will reduce performance of all
+// operations on the LLRB.
+//
+//#define USE_234_TREE
+
+typedef LeftLeaningRedBlackT<LLRB23Policy>  LeftLeaningRedBlack23;
+typedef LeftLeaningRedBlackT<LLRB234Policy> LeftLeaningRedBlack234;
+
+#if defined(USE_234_TREE)
+typedef LeftLeaningRedBlack234 LeftLeaningRedBlack;
+#else
+typedef LeftLeaningRedBlack23  LeftLeaningRedBlack;
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ForEachInRange()
+//
+//	Calls fn(const VoidRef_t&) for every key in the range [lo, hi), in
+//	sorted order.  Subtrees that lie entirely outside of the range are
+//	skipped, so the cost is O(log n) plus the number of keys visited.
+//
+template <class Policy>
+template <class Fn>
+void LeftLeaningRedBlackT<Policy>::ForEachInRange(const int lo, const int hi, Fn fn)
+{
+	if (lo < hi) {
+		ForEachInRangeRec(m_pRoot, lo, hi, fn);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ForEachInRangeRec()
+//
+template <class Policy>
+template <class Fn>
+void LeftLeaningRedBlackT<Policy>::ForEachInRangeRec(LLTB_t *pNode, const int lo, const int hi, Fn &fn)
+{
+	while (NULL != pNode) {
+		// Only keys greater than or equal to lo can be found on the left.
+		if (lo < pNode->Ref.Key) {
+			ForEachInRangeRec(pNode->pLeft, lo, hi, fn);
+		}
+
+		if ((lo <= pNode->Ref.Key) && (pNode->Ref.Key < hi)) {
+			fn(pNode->Ref);
+		}
+
+		// The right subtree only holds keys greater than this one, so it can
+		// be skipped once this key reaches the end of the range.  Looping
+		// instead of recursing on the right keeps the stack shallow.
+		if ((hi - 1) <= pNode->Ref.Key) {
+			break;
+		}
+
+		pNode = pNode->pRight;
+	}
+}
+
+
 
@@ -0,0 +1,421 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: LeftLeaningRedBlackMap.h
+//
+//	$Header: $
+//
+//
+//	Templated version of the left-leaning red-black tree.  Where the
+//	LeftLeaningRedBlack class only stores VoidRef_t pairs (an int key plus a
+//	void* to the real data), this version stores an arbitrary key and value
+//	directly in each node.  Looking up a value no longer needs to chase an
+//	extra pointer out of the tree, and keys can be any type that Compare can
+//	order, such as 64-bit ints or strings.
+//
+//	To keep the nodes small, the red/black flag is packed into the low bit
+//	of the left child link.  Nodes are always at least pointer aligned, so
+//	that bit is otherwise unused.  For an int key and a void* value the node
+//	is 32 bytes, compared to 40 bytes for LLTB_t, and an int/int node is
+//	only 24 bytes.
+//
+//	The balancing is done by LLRBCore, the same code that LeftLeaningRedBlack
+//	uses, so the map supports both split policies and the iterative insert
+//	and delete paths.  The map only supplies the accessors that know about
+//	the packed links.  Refer to LeftLeaningRedBlack.cpp for the reasoning
+//	behind each of the rotations and color flips.
+//
+//	All nodes are allocated from a SlabAllocator owned by the tree.  Keys
+//	and values are constructed with placement new, and destructors are only
+//	run when the key or value type actually needs them.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include "LLRBCore.h"
+#include "SlabAllocator.h"
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+
+template <class Key, class Value, class Compare = std::less<Key>, class Policy = LLRB23Policy>
+class LeftLeaningRedBlackMap
+{
+private:
+	typedef LLRBCore<Policy, LeftLeaningRedBlackMap> Core_t;
+	friend class LLRBCore<Policy, LeftLeaningRedBlackMap>;
+
+	struct Node_t
+	{
+		Key     K;
+		Value   V;
+
+		// LeftWord is the left child pointer, with the IsRed flag of this
+		// node stored in the low bit.  RightWord is the right child pointer,
+		// and its low bit is always zero.  Only access these through the
+		// helpers below.
+		uintptr_t LeftWord;
+		uintptr_t RightWord;
+	};
+
+	// A link is the address of a word holding a node pointer: the root, or
+	// one of the child words of a node.  Writing through a link keeps the
+	// low bit of the word, so replacing a left child does not change the
+	// color of its parent.
+	typedef uintptr_t* Link_t;
+
+	static const bool c_TrivialNode = std::is_trivially_destructible<Key>::value
+								   && std::is_trivially_destructible<Value>::value;
+
+	uintptr_t     m_Root;
+	int           m_KeyCount;
+	Compare       m_Less;
+	SlabAllocator m_Slab;
+
+	static Node_t* Get(uintptr_t *pLink)
+	{
+		return reinterpret_cast<Node_t*>(*pLink & ~uintptr_t(1));
+	}
+
+	static void Set(uintptr_t *pLink, Node_t *pNode)
+	{
+		*pLink = reinterpret_cast<uintptr_t>(pNode) | (*pLink & 1);
+	}
+
+	static uintptr_t* LeftLink(Node_t *pNode)  { return &(pNode->LeftWord); }
+	static uintptr_t* RightLink(Node_t *pNode) { return &(pNode->RightWord); }
+
+	static Node_t* Left(Node_t *pNode)
+	{
+		return reinterpret_cast<Node_t*>(pNode->LeftWord & ~uintptr_t(1));
+	}
+
+	static Node_t* Right(Node_t *pNode)
+	{
+		return reinterpret_cast<Node_t*>(pNode->RightWord);
+	}
+
+	// Used by LookUp(), see the comments there.
+	static Node_t* Child(Node_t *pNode, bool goLeft)
+	{
+		uintptr_t word = goLeft ? pNode->LeftWord : pNode->RightWord;
+
+		return reinterpret_cast<Node_t*>(word & ~uintptr_t(1));
+	}
+
+	static bool IsRed(Node_t *pNode)
+	{
+		return (NULL != pNode) && (0 != (pNode->LeftWord & 1));
+	}
+
+	static void SetRed(Node_t *pNode, bool isRed)
+	{
+		pNode->LeftWord = (pNode->LeftWord & ~uintptr_t(1)) | (isRed ? 1 : 0);
+	}
+
+	static void FlipRed(Node_t *pNode)
+	{
+		pNode->LeftWord ^= 1;
+	}
+
+	// The map does not keep subtree sizes or operation counts.
+	static void UpdateSize(Node_t *)        { }
+	static void CopySize(Node_t *, Node_t *) { }
+	void        Count(LLRBOp_t)              { }
+
+	Node_t* Root(void) const { return reinterpret_cast<Node_t*>(m_Root); }
+
+	int CompareKey(const Key &key, Node_t *pNode) const
+	{
+		if (m_Less(key, pNode->K)) {
+			return -1;
+		}
+
+		return m_Less(pNode->K, key) ? 1 : 0;
+	}
+
+	Node_t* NewLeaf(const Key &key, const Value &value) { return NewNode(key, value); }
+	void    ReplaceItem(Node_t *pNode, const Value &value) { pNode->V = value; }
+	void    MoveItem(Node_t *pTo, Node_t *pFrom);
+
+	Node_t* NewNode(const Key &key, const Value &value);
+	void    ReleaseNode(Node_t *pNode);
+	void    Free(Node_t *pNode);
+
+	bool SanityCheckRec(Node_t *pNode, bool isParentRed, int blackDepth, int &leafBlack);
+
+public:
+	LeftLeaningRedBlackMap(void);
+	~LeftLeaningRedBlackMap(void);
+
+	bool IsEmpty(void) const  { return 0 == m_Root; }
+	int  KeyCount(void) const { return m_KeyCount; }
+
+	static size_t NodeSize(void) { return sizeof(Node_t); }
+
+	void FreeAll(void);
+
+	const Value* LookUp(const Key &key) const;
+
+	void Insert(const Key &key, const Value &value);
+	void Delete(const Key &key);
+
+	bool SanityCheck(void);
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	constructor
+//
+template <class Key, class Value, class Compare, class Policy>
+LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::LeftLeaningRedBlackMap(void)
+	:	m_Root(0),
+		m_KeyCount(0),
+		m_Slab(sizeof(Node_t), 1024, alignof(Node_t))
+{
+	static_assert(alignof(Node_t) >= 2, "low pointer bit is needed for the color flag");
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	destructor
+//
+template <class Key, class Value, class Compare, class Policy>
+LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::~LeftLeaningRedBlackMap(void)
+{
+	FreeAll();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FreeAll()
+//
+//	If neither the key nor the value has a destructor, the nodes can be
+//	dropped by releasing the slabs.  Otherwise every node has to be visited
+//	so its destructors can run.
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::FreeAll(void)
+{
+	if (false == c_TrivialNode) {
+		Free(Root());
+	}
+
+	m_Slab.FreeAll();
+
+	m_Root     = 0;
+	m_KeyCount = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Free()
+//
+//	Runs the destructors of every node in the subtree.  The memory itself is
+//	returned to the slab free list.
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::Free(Node_t *pNode)
+{
+	if (NULL != pNode) {
+		Free(Left(pNode));
+		Free(Right(pNode));
+		ReleaseNode(pNode);
+	}
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	NewNode()
+//
+//	Note that a new node defaults to being red.
+//
+template <class Key, class Value, class Compare, class Policy>
+typename LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::Node_t*
+LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::NewNode(const Key &key, const Value &value)
+{
+	Node_t *pNew = static_cast<Node_t*>(m_Slab.Alloc());
+
+	new (&(pNew->K)) Key(key);
+	new (&(pNew->V)) Value(value);
+
+	pNew->LeftWord  = 1;
+	pNew->RightWord = 0;
+
+	++m_KeyCount;
+
+	return pNew;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	ReleaseNode()
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::ReleaseNode(Node_t *pNode)
+{
+	pNode->K.~Key();
+	pNode->V.~Value();
+
+	m_Slab.Free(pNode);
+
+	--m_KeyCount;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	MoveItem()
+//
+//	Deleting an internal node moves the successor's key and value into it,
+//	after which the successor's node is deleted instead.
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::MoveItem(Node_t *pTo, Node_t *pFrom)
+{
+	pTo->K = std::move(pFrom->K);
+	pTo->V = std::move(pFrom->V);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	LookUp()
+//
+//	Returns a pointer to the value stored in the tree, or NULL if the key
+//	is not in the tree.  The pointer is only valid until the next time the
+//	tree is modified.
+//
+//	For random keys, which way to go at each node is a coin toss, so a
+//	branch on the comparison mispredicts about half of the time.  Child()
+//	picks the link word first and masks off the color bit afterward, which
+//	lets the compiler select the next node with a conditional move, the
+//	same code it generates for LeftLeaningRedBlack::LookUp().  The two
+//	comparisons are combined with | rather than || for the same reason.
+//
+template <class Key, class Value, class Compare, class Policy>
+const Value* LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::LookUp(const Key &key) const
+{
+	Node_t *pNode = Root();
+
+	while (NULL != pNode) {
+		bool goLeft  = m_Less(key, pNode->K);
+		bool goRight = m_Less(pNode->K, key);
+
+		if (false == (goLeft | goRight)) {
+			return &(pNode->V);
+		}
+
+		pNode = Child(pNode, goLeft);
+	}
+
+	return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Insert()
+//
+//	If the key is already in the tree, its value is replaced.
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::Insert(const Key &key, const Value &value)
+{
+	Core_t::Insert(*this, &m_Root, key, value);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	Delete()
+//
+template <class Key, class Value, class Compare, class Policy>
+void LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::Delete(const Key &key)
+{
+	Core_t::Delete(*this, &m_Root, key);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SanityCheck()
+//
+//	Verifies that the tree is properly formed.  Returns false if the order,
+//	the red-black rules, or the black-link balance is violated.
+//
+template <class Key, class Value, class Compare, class Policy>
+bool LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::SanityCheck(void)
+{
+	if (0 == m_Root) {
+		return true;
+	}
+
+	if (IsRed(Root())) {
+		return false;
+	}
+
+	int leafBlack = -1;
+
+	return SanityCheckRec(Root(), false, 0, leafBlack);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	SanityCheckRec()
+//
+template <class Key, class Value, class Compare, class Policy>
+bool LeftLeaningRedBlackMap<Key, Value, Compare, Policy>::SanityCheckRec(Node_t *pNode, bool isParentRed, int blackDepth, int &leafBlack)
+{
+	if (NULL == pNode) {
+		if (leafBlack < 0) {
+			leafBlack = blackDepth;
+		}
+
+		return leafBlack == blackDepth;
+	}
+
+	if (IsRed(pNode)) {
+		if (isParentRed) {
+			return false;
+		}
+	}
+	else {
+		++blackDepth;
+	}
+
+	Node_t *pLeft  = Left(pNode);
+	Node_t *pRight = Right(pNode);
+
+	// Red links must lean left.  A 2-3-4 tree may also have a 4-node,
+	// where both children are red.
+	if (IsRed(pRight) && !(Policy::SplitOnWayDown && IsRed(pLeft))) {
+		return false;
+	}
+
+	if ((NULL != pLeft) && (false == m_Less(pLeft->K, pNode->K))) {
+		return false;
+	}
+
+	if ((NULL != pRight) && (false == m_Less(pNode->K, pRight->K))) {
+		return false;
+	}
+
+	return SanityCheckRec(pLeft, IsRed(pNode), blackDepth, leafBlack)
+		&& SanityCheckRec(pRight, IsRed(pNode), blackDepth, leafBlack);
+}
+
+
@@ -0,0 +1,117 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: SlabAllocator.cpp
+//
+//	$Header: $
+//
+//
+//	Fixed-size block allocator used to pool the nodes of the balanced trees.
+//	See SlabAllocator.h for details.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#include "SlabAllocator.h"
+#include <stdint.h>
+
+
+// By default, blocks are padded out to pointer alignment so that any node
+// containing pointers can be safely stored in a block.  Callers that want
+// each block to start on a cache line can ask for a larger alignment.
+#define SlabRoundUp(x, a)	((((x) + (a) - 1) / (a)) * (a))
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	constructor
+//
+//	Each block must be large enough to hold a free list link, since freed
+//	blocks are threaded together through their first bytes.  The block size
+//	is rounded up to a multiple of the alignment, which must be a power of
+//	two, so that every block in a slab stays aligned.
+//
+SlabAllocator::SlabAllocator(size_t blockSize, size_t blocksPerSlab, size_t blockAlign)
+	:	m_BlockAlign((blockAlign < sizeof(void*)) ? sizeof(void*) : blockAlign),
+		m_BlocksPerSlab((0 == blocksPerSlab) ? 1 : blocksPerSlab),
+		m_pSlabList(NULL),
+		m_pFreeList(NULL),
+		m_pCursor(NULL),
+		m_pLimit(NULL),
+		m_SlabCount(0),
+		m_LiveCount(0)
+{
+	m_BlockSize = SlabRoundUp((blockSize < sizeof(FreeBlock_t)) ? sizeof(FreeBlock_t) : blockSize, m_BlockAlign);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	destructor
+//
+SlabAllocator::~SlabAllocator(void)
+{
+	FreeAll();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	FreeAll()
+//
+//	Drops every slab back to the heap.  The cost depends on the number of
+//	slabs, not the number of blocks, so a tree with a million nodes only
+//	needs to make about a thousand calls to delete.
+//
+void SlabAllocator::FreeAll(void)
+{
+	while (NULL != m_pSlabList) {
+		Slab_t *pNext = m_pSlabList->pNext;
+		delete [] reinterpret_cast<char*>(m_pSlabList);
+		m_pSlabList = pNext;
+	}
+
+	m_pFreeList = NULL;
+	m_pCursor   = NULL;
+	m_pLimit    = NULL;
+	m_SlabCount = 0;
+	m_LiveCount = 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////
+//
+//	AllocSlow()
+//
+//	Called by Alloc() when the free list is empty and the current slab has
+//	been used up.  Allocates a new slab, links it into the slab list, then
+//	hands out the first block of the new slab.
+//
+//	new[] only guarantees alignment suitable for the fundamental types, so
+//	enough extra space is requested to slide the first block forward to the
+//	requested alignment.
+//
+void* SlabAllocator::AllocSlow(void)
+{
+	size_t headerSize = sizeof(Slab_t);
+	size_t byteCount  = headerSize + (m_BlockAlign - 1) + (m_BlockSize * m_BlocksPerSlab);
+
+	char   *pMemory = new char[byteCount];
+	Slab_t *pSlab   = reinterpret_cast<Slab_t*>(pMemory);
+
+	pSlab->pNext = m_pSlabList;
+	m_pSlabList  = pSlab;
+
+	++m_SlabCount;
+
+	uintptr_t first = SlabRoundUp(reinterpret_cast<uintptr_t>(pMemory + headerSize), m_BlockAlign);
+
+	m_pCursor = reinterpret_cast<char*>(first);
+	m_pLimit  = m_pCursor + (m_BlockSize * m_BlocksPerSlab);
+
+	void *pBlock = m_pCursor;
+	m_pCursor += m_BlockSize;
+
+	return pBlock;
+}
+
+
@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+//	File: SlabAllocator.h
+//
+//	$Header: $
+//
+//
+//	A fixed-size block allocator.  Memory is requested from the heap in
+//	large slabs, each of which is carved up into equal-sized blocks.  Blocks
+//	that are freed go onto a free list so they can be recycled by the next
+//	allocation, which keeps a tree that churns through inserts and deletes
+//	from touching the heap at all once it reaches a steady size.
+//
+//	Since blocks are handed out sequentially from each slab, nodes that are
+//	allocated close together in time also end up close together in memory,
+//	instead of being scattered around the heap by malloc.
+//
+//	FreeAll() releases entire slabs without visiting individual blocks.
+//	It does not run destructors, so this should only be used for POD types
+//	such as tree nodes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+
+#include <cstddef>
+
+
+class SlabAllocator
+{
+private:
+	// Every slab starts with this header, which links all of the slabs
+	// together so they can be released by FreeAll().
+	struct Slab_t
+	{
+		Slab_t *pNext;
+	};
+
+	// Freed blocks are reused to hold the free list link.
+	struct FreeBlock_t
+	{
+		FreeBlock_t *pNext;
+	};
+
+	size_t       m_BlockSize;
+	size_t       m_BlockAlign;
+	size_t       m_BlocksPerSlab;
+
+	Slab_t*      m_pSlabList;
+	FreeBlock_t* m_pFreeList;
+
+	// Bump pointer into the most recently allocated slab.  Blocks are
+	// carved off of this slab until m_pCursor reaches m_pLimit.
+	char*        m_pCursor;
+	char*        m_pLimit;
+
+	size_t       m_SlabCount;
+	size_t       m_LiveCount;
+
+	void* AllocSlow(void);
+
+public:
+	SlabAllocator(size_t blockSize, size_t blocksPerSlab = 1024, size_t blockAlign = sizeof(void*));
+	~SlabAllocator(void);
+
+	void FreeAll(void);
+
+	size_t SlabCount(void) const { return m_SlabCount; }
+	size_t LiveCount(void) const { return m_LiveCount; }
+
+	/////////////////////////////////////////////////////////////////////////
+	//
+	//	Alloc()
+	//
+	//	Recycled blocks are preferred over fresh ones, since they are more
+	//	likely to still be in cache.
+	//
+	void* Alloc(void)
+	{
+		++m_LiveCount;
+
+		if (NULL != m_pFreeList) {
+			FreeBlock_t *pBlock = m_pFreeList;
+			m_pFreeList = pBlock->pNext;
+			return pBlock;
+		}
+
+		if (m_pCursor < m_pLimit) {
+			void *pBlock = m_pCursor;
+			m_pCursor += m_BlockSize;
+			return pBlock;
+		}
+
+		return AllocSlow();
+	}
+
+	/////////////////////////////////////////////////////////////////////////
+	//
+	//	Free()
+	//
+	void Free(void *pBlock)
+	{
+		if (NULL != pBlock) {
+			FreeBlock_t *pFree = reinterpret_cast<FreeBlock_t*>(pBlock);
+			pFree->pNext = m_pFreeList;
+			m_pFreeList  = pFree;
+
+			--m_LiveCount;
+		}
+	}
+};
+
+
@@ -1,81 +1,69 @@
 #include <iostream>
-#include <vector> //std::vector
-#include <stdlib.h> //srand()
-#include "LeftLeaningRedBlack.h"
+#include <stdlib.h> //atoll()
+#include <string.h> //strcmp()
+#include "Benchmark.h"
 
-void Performance(void);
-
-int main()
+//with no arguments compares the LLRB against the B+-tree from 1K to 100M
+//keys, otherwise runs the named benchmark
+int main(int argc, char *argv[])
 {
-    Performance();
-
-    return 0;
-}
+    if ((argc < 2) || (strcmp(argv[1], "compare") == 0))
+    {
+        //an optional second argument caps the number of keys
+        long long maxKeys = 100000000;
 
-//Function to test left leaning red black tree
-void Performance(void)
-{
-    int limit = 10;
-    int *pKeys = new int[limit];
-    srand(123456);
+        if (argc > 2)
+        {
+            maxKeys = atoll(argv[2]);
+        }
 
-    //fills pKeys with random values
-    for (int i = 0; i < limit; ++i)
+        BenchmarkStructures(maxKeys);
+    }
+    else if (strcmp(argv[1], "alloc") == 0)
     {
-        pKeys[i] = rand() % 100;
+        BenchmarkAllocator();
     }
-
-    //LLRB tree
-    LeftLeaningRedBlack sort4;
-
-    int dummy;
-	VoidRef_t ref;
-	ref.pContext = &dummy;
-
-	//safety check to make sure tree is empty
-	sort4.FreeAll();
-
-	//prints nodes at time of insertion, also prints parent
-	//at time of insertion
-	std::cout << std::endl << "Inserts" << "\t"
-        "| Parent at Insertion" << std::endl
-        << "-----------------------------" << std::endl;
-
-    for (int i = 0; i < limit; ++i)
+    else if (strcmp(argv[1], "ops") == 0)
     {
-        ref.Key = pKeys[i];
-        sort4.Insert(ref);
-        sort4.printNode(pKeys[i]);
-
-        std::cout << "\t";
-
-        sort4.printParent(ref.Key);
-        std::cout << std::endl;
-
+        BenchmarkOperations();
     }
-
-    //prints entire tree
-    std::cout << std::endl << "Traversal After Insertion"
-        << std::endl << "-----------------------------" << std::endl;
-
-    sort4.Traverse();
-
-    //removes 4th element and reprints tree
-    std::cout << std::endl << "Removal of 4th Element Inserted"
-    << std::endl << "-----------------------------" << std::endl;
-
-    sort4.Delete(pKeys[3]); //deletes fourth element
-
-    sort4.Traverse();
-
-    //deletes all keys inside tree
-    for (int i = 0; i < limit; ++i)
+    else if (strcmp(argv[1], "map") == 0)
     {
-        sort4.Delete(pKeys[i]);
+        BenchmarkMap();
+    }
+    else if (strcmp(argv[1], "bulk") == 0)
+    {
+        BenchmarkBulkBuild();
+    }
+    else if (strcmp(argv[1], "range") == 0)
+    {
+        BenchmarkRangeScan();
+    }
+    else if (strcmp(argv[1], "rank") == 0)
+    {
+        BenchmarkRankSelect();
+    }
+    else if (strcmp(argv[1], "policy") == 0)
+    {
+        BenchmarkSplitPolicy();
+    }
+    else if (strcmp(argv[1], "snapshot") == 0)
+    {
+        BenchmarkSnapshot();
+    }
+    else if (strcmp(argv[1], "batch") == 0)
+    {
+        BenchmarkLookUpBatch();
+    }
+    else if (strcmp(argv[1], "concurrent") == 0)
+    {
+        BenchmarkConcurrent();
+    }
+    else
+    {
+        std::cout << "Usage: " << argv[0] << " [compare [max keys] | alloc | ops | map | bulk | range | rank | policy | snapshot | batch | concurrent]" << std::endl;
+        return 1;
     }
 
-    //safety to make sure that nothing is left
-    sort4.FreeAll();
-    delete[] pKeys;
-
+    return 0;
 }
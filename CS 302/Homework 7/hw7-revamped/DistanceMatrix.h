@@ -0,0 +1,64 @@
+/**
+ * @brief  CS-302 Homework 7
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Square matrix of distances between cities, sized at runtime
+ * All of the rows are stored one after another in a single block, so scanning a row
+ * reads memory in order instead of following a pointer to a separate vector per row
+ */
+#pragma once
+#include <vector>
+#include <cstddef>
+
+typedef std::vector<int> VecInt;
+typedef std::vector<VecInt> Graph;
+
+
+class DistanceMatrix {
+	//public methods
+public:
+
+	DistanceMatrix();
+	explicit DistanceMatrix(int n);
+	explicit DistanceMatrix(const Graph& graph);
+
+	int size() const { return n; }
+
+	//returns row i, so m[i][j] works the same as it does on a Graph
+	int* operator[](int i) { return &cells[(size_t)i * n]; }
+	const int* operator[](int i) const { return &cells[(size_t)i * n]; }
+
+	//true if every row of the graph has one entry per row
+	static bool isSquare(const Graph& graph);
+
+private:
+	int n;
+	VecInt cells;
+};
+
+DistanceMatrix::DistanceMatrix() : n(0)
+{
+}
+
+//n by n matrix with every distance set to 0
+DistanceMatrix::DistanceMatrix(int n) : n(n), cells((size_t)n * n, 0)
+{
+}
+
+//copies a graph that has already been checked with isSquare()
+DistanceMatrix::DistanceMatrix(const Graph& graph) : n((int)graph.size()), cells((size_t)n * n, 0)
+{
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			cells[(size_t)i * n + j] = graph[i][j];
+}
+
+bool DistanceMatrix::isSquare(const Graph& graph)
+{
+	for (size_t i = 0; i < graph.size(); i++)
+		if (graph[i].size() != graph.size())
+			return false;
+
+	return true;
+}
@@ -13,8 +13,19 @@
 #include <algorithm>
 #include <fstream>
 #include <climits>
-
-#define V 5 //number of vertices
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+#include <bitset>
+#if defined(__linux__)
+#include <unistd.h> //sysconf
+#endif
+#include "DistanceMatrix.h"
+#include "TSPHeuristic.h"
+#include "TSPEnumerator.h"
 
 //ease of typing for me
 typedef std::vector<int> VecInt;
@@ -22,30 +33,127 @@ typedef std::vector<bool> VecBool;
 typedef std::vector<std::string> VecString;
 typedef std::vector<VecInt> Graph;
 
+//which method printSolution() uses, only the heuristic is not exact
+enum TSPMethod { TSP_BRANCH_AND_BOUND, TSP_HELD_KARP, TSP_HEURISTIC };
+
+//Held-Karp needs a table entry for every subset of the cities (city 0 is never
+//in them), so the table doubles with every city and 26 cities already take 4 GB
+#define HK_MAX_CITIES 26
+//predecessors are compared this many at a time, rows of the table are padded
+//to a multiple of it so the compiler can turn the loop into SIMD min/add
+#define HK_LANES 8
+#define HK_INF (INT_MAX / 2)
+//masks handed to a thread at a time
+#define HK_BLOCK 1024
+
+//a subtree of the search that has not been explored yet
+struct TSPTask
+{
+	long long bound;	//curr_bound at the root of the subtree
+	int weight;		//curr_weight of the path so far
+	int level;		//number of cities already on the path
+	VecInt path;	//the first level entries are the path so far
+};
+
+//tasks owned by one thread of the parallel search, the owner pushes and pops
+//at the back (depth first) while other threads steal the oldest, and usually
+//largest, subtrees from the front
+struct TSPWorkQueue
+{
+	std::mutex lock;
+	std::deque<TSPTask> tasks;
+};
+
 
 class TSP {
 	//public methods
 public:
 
 	TSP();
+	TSP(const Graph& graph, const VecString& names);
+	TSP(const DistanceMatrix& graph, const VecString& names);
 
-	void printSolution(std::ofstream& os);
-	void printAllPaths(std::ofstream& os);
+	int size() const { return vertices; }
+
+	//bytes of memory the Held-Karp table takes for this many cities
+	static size_t heldKarpBytes(int cities);
+	//true if the table is under HK_MAX_CITIES and 3/4 of the physical memory
+	static bool heldKarpFits(int cities);
+
+	//wall-clock seconds the heuristic may run for
+	void setTimeBudget(double seconds) { time_budget = seconds; }
+
+	//threads > 1 runs the parallel search, 0 uses every core
+	void printSolution(std::ofstream& os, unsigned int threads = 1,
+		TSPMethod method = TSP_BRANCH_AND_BOUND);
+	//threads > 1 splits the tours by their second city, 0 uses every core
+	void printAllPaths(std::ofstream& os, unsigned int threads = 1);
 
 	//protected methods, only for helper methods
 protected:
+	static DistanceMatrix squareMatrix(const Graph& graph);
+
 	int firstMin(int i);
 
 	int secondMin(int i);
+	void computeMinEdges();
+
+	long long childBound(long long curr_bound, int level, int last, int next);
+	bool canImprove(long long curr_bound, int curr_weight, int best);
 
 	void TSPUtil();
-	void TSPRec(int curr_bound, int curr_weight,
-		int level, VecInt curr_path);
+	void TSPRec(long long curr_bound, int curr_weight,
+		int level, VecInt& curr_path);
+
+	void TSPParallel(unsigned int threads);
+	void TSPWorker(unsigned int id);
+	void TSPParallelRec(unsigned int id, long long curr_bound, int curr_weight,
+		int level, VecInt& curr_path, VecBool& curr_visited);
+
+	void TSPHeldKarp(unsigned int threads);
+	void TSPLocalSearch(int max_idle_kicks);
+	static void heldKarpLayer(int* table, const int* cost, int cities, int width,
+		int size, unsigned int part, unsigned int parts);
+	static int minPlus(const int* prev, const int* cost, int width);
+
+	void pushTask(unsigned int id, const TSPTask& task);
+	bool popTask(unsigned int id, TSPTask& task);
+	void recordTour(int weight, const VecInt& path);
 
 
 private:
-	//adjacency matrix for cities
-	Graph adj =
+	//adjacency matrix for cities, 0 means there is no road between them
+	DistanceMatrix adj;
+	int vertices = 0;
+
+	//indes of cities in string form
+	VecString index;
+
+	//variables needed
+	int final_weight = INT_MAX;
+	VecInt final_path;
+	VecBool visited;
+
+	//firstMin() and secondMin() of every vertex, the matrix never changes so
+	//they are found once instead of on every branch of the search
+	VecInt first_min;
+	VecInt second_min;
+
+	double time_budget = 1.0;
+
+	//state shared by the threads of the parallel search, shared_bound is the
+	//best complete tour found so far by any thread and is used for pruning
+	std::atomic<int> shared_bound;
+	std::atomic<int> pending_tasks;
+	std::mutex result_lock;
+	std::vector<std::unique_ptr<TSPWorkQueue> > queues;
+	int spawn_level = 1;
+};
+
+//the five Nevada-area cities used for the homework
+TSP::TSP()
+{
+	Graph cities =
 	{	/*R   SF  SLC   SE   LV*/
 /*R*/	{ 0, 218, 518, 705, 439 },
 /*SF*/	{ 218,  0,  0, 806, 570 },
@@ -54,65 +162,141 @@ private:
 /*LV*/	{ 438, 569, 421, 1125, 0},
 	};
 
-	//indes of cities in string form
-	VecString index =
+	adj = DistanceMatrix(cities);
+	vertices = adj.size();
+
+	index =
 	{ "Reno", "San Francisco", "Salt Lake City",
 	"Seattle", "Las Vegas" };
 
-	//variables needed
-	int final_weight = INT_MAX;
-	VecInt final_path;
-	VecBool visited;
-};
+	computeMinEdges();
+}
 
-TSP::TSP()
+//any number of cities, names may be left empty to number the cities from 0
+TSP::TSP(const Graph& graph, const VecString& names)
+	: TSP(squareMatrix(graph), names)
 {
 }
 
-//finding minimum cost of edge at the end of vertex i
+TSP::TSP(const DistanceMatrix& graph, const VecString& names)
+	: adj(graph), vertices(graph.size()), index(names)
+{
+	if (index.empty())
+		for (int i = 0; i < vertices; i++)
+			index.push_back(std::to_string(i));
+
+	if ((int)index.size() != vertices)
+		throw std::invalid_argument("TSP needs one name per city");
+
+	computeMinEdges();
+}
+
+//flat copy of a graph, which must have as many columns as rows
+DistanceMatrix TSP::squareMatrix(const Graph& graph)
+{
+	if (!DistanceMatrix::isSquare(graph))
+		throw std::invalid_argument("TSP graph must be a square matrix");
+
+	return DistanceMatrix(graph);
+}
+
+//finding minimum cost of edge at the end of vertex i, a tour may enter i
+//along either direction of an edge so the cheaper direction is used, which
+//keeps the bound valid when the matrix is not symmetric
 int TSP::firstMin(int i)
 {
 	int min = INT_MAX;
-	for (int j = 0; j < V; j++)
-		if (adj[i][j] < min && i != j)
-			min = adj[i][j];
+	for (int j = 0; j < vertices; j++)
+		if (std::min(adj[i][j], adj[j][i]) < min && i != j)
+			min = std::min(adj[i][j], adj[j][i]);
 
 	return min;
 }
 
-//finding second lowest edge cost at vertex i
+//finding second lowest edge cost at vertex i, which is the same as the
+//lowest cost when two edges tie for it
 int TSP::secondMin(int i)
 {
 	int first = INT_MAX, second = INT_MAX;
 
-	for (int j = 0; j < V; j++)
+	for (int j = 0; j < vertices; j++)
 	{
 		if (i == j)
 			continue;
 
-		if (adj[i][j] <= first)
+		int cost = std::min(adj[i][j], adj[j][i]);
+
+		if (cost <= first)
 		{
 			second = first;
-			first = adj[i][j];
+			first = cost;
 		}
-		else if (adj[i][j] <= second && adj[i][j] != first)
+		else if (cost < second)
 		{
-			second = adj[i][j];
+			second = cost;
 		}
 	}
 
 	return second;
 }
 
-//recursive function to calculate shortest path and weight
-void TSP::TSPRec(int curr_bound, int curr_weight,
-	int level, VecInt curr_path)
+//fills in first_min and second_min for every vertex
+void TSP::computeMinEdges()
+{
+	first_min.resize(vertices);
+	second_min.resize(vertices);
+
+	for (int i = 0; i < vertices; i++)
+	{
+		first_min[i] = firstMin(i);
+		second_min[i] = secondMin(i);
+
+		//with two cities the tour goes out and back along the only road, and
+		//a single city has no roads at all, so neither minimum may stay INT_MAX
+		if (vertices <= 2)
+		{
+			if (first_min[i] == INT_MAX)
+				first_min[i] = 0;
+			second_min[i] = first_min[i];
+		}
+	}
+}
+
+//curr_bound is twice a lower bound on the cost of the rest of the tour,
+//every vertex contributes the cheapest edges it still needs: both ends of
+//the first and second minimum while it is unvisited, only the first minimum
+//once it is one end of the path, and nothing once it is inside the path.
+//keeping the bound doubled avoids rounding it up, which could prune the
+//optimal tour. the minima of long roads add up to more than an int holds,
+//so the bound is a long long
+long long TSP::childBound(long long curr_bound, int level, int last, int next)
+{
+	//at level 1 the start is both ends of the path, so it gives up its
+	//second minimum and keeps the first for the edge that closes the tour
+	if (level == 1)
+		return curr_bound - second_min[last] - second_min[next];
+
+	return curr_bound - first_min[last] - second_min[next];
+}
+
+//true if a path with this bound and weight could still beat best
+bool TSP::canImprove(long long curr_bound, int curr_weight, int best)
+{
+	return (curr_bound + 1) / 2 + curr_weight < best;
+}
+
+//recursive function to calculate shortest path and weight, curr_path and
+//visited are shared by every level, so each child only undoes its own city
+void TSP::TSPRec(long long curr_bound, int curr_weight,
+	int level, VecInt& curr_path)
 {
-	if (level == V)
+	int last = curr_path[level - 1];
+
+	if (level == vertices)
 	{
-		if (adj[curr_path[level - 1]][curr_path[0]] != 0)
+		if (adj[last][curr_path[0]] != 0)
 		{
-			int curr_res = curr_weight + adj[curr_path[level - 1]][curr_path[0]];
+			int curr_res = curr_weight + adj[last][curr_path[0]];
 
 			if (curr_res < final_weight)
 			{
@@ -120,38 +304,25 @@ void TSP::TSPRec(int curr_bound, int curr_weight,
 				final_path = curr_path;
 			}
 		}
+		return;
 	}
 
-	for (int i = 0; i < V; i++)
+	for (int i = 0; i < vertices; i++)
 	{
-		if (adj[curr_path[level - 1]][i] != 0 &&
-			visited[i] == false)
+		if (adj[last][i] != 0 && visited[i] == false)
 		{
-			int temp = curr_bound;
-			curr_weight += adj[curr_path[level - 1]][i];
-
-			if (level == 1)
-				curr_bound -= ((firstMin(curr_path[level - 1]) +
-					firstMin(i)) / 2);
-			else
-				curr_bound -= ((secondMin(curr_path[level - 1]) +
-					firstMin(i)) / 2);
+			int weight = curr_weight + adj[last][i];
+			long long bound = childBound(curr_bound, level, last, i);
 
-			if (curr_bound + curr_weight < final_weight)
+			if (canImprove(bound, weight, final_weight))
 			{
 				curr_path[level] = i;
 				visited[i] = true;
 
-				TSPRec(curr_bound, curr_weight, level + 1,
-					curr_path);
-			}
-
-			curr_weight -= adj[curr_path[level - 1]][i];
-			curr_bound = temp;
+				TSPRec(bound, weight, level + 1, curr_path);
 
-			visited.assign(visited.size(), false);
-			for (int j = 0; j <= level - 1; j++)
-				visited[curr_path[j]] = true;
+				visited[i] = false;
+			}
 		}
 	}
 }
@@ -160,18 +331,16 @@ void TSP::TSPRec(int curr_bound, int curr_weight,
 void TSP::TSPUtil()
 {
 	VecInt curr_path;
-	int curr_bound = 0;
+	long long curr_bound = 0;
 
-	curr_path.resize(V + 1);
+	curr_path.resize(vertices + 1);
 	visited.resize(curr_path.size());
 
 	curr_path.assign(curr_path.size(), -1);
 	visited.assign(curr_path.size(), false);
 
-	for (int i = 0; i < V; i++)
-		curr_bound += (firstMin(i) + secondMin(i));
-
-	curr_bound /= 2;
+	for (int i = 0; i < vertices; i++)
+		curr_bound += (long long)first_min[i] + second_min[i];
 
 	visited[0] = true;
 	curr_path[0] = 0;
@@ -179,23 +348,406 @@ void TSP::TSPUtil()
 	TSPRec(curr_bound, 0, 1, curr_path);
 }
 
+//parallel version of TSPUtil(), the levels of the search tree above
+//spawn_level are split into tasks that the threads share by work stealing,
+//and the levels below are searched depth first within a single task
+void TSP::TSPParallel(unsigned int threads)
+{
+	long long curr_bound = 0;
+
+	for (int i = 0; i < vertices; i++)
+		curr_bound += (long long)first_min[i] + second_min[i];
+
+	//split deep enough to give every thread plenty of tasks to balance
+	//with, each level multiplies the number of tasks by the cities left
+	long long tasks = vertices - 1;
+	spawn_level = 1;
+	while (tasks < 64LL * threads && spawn_level < vertices - 2)
+	{
+		spawn_level++;
+		tasks *= (vertices - spawn_level);
+	}
+
+	queues.clear();
+	for (unsigned int i = 0; i < threads; i++)
+		queues.emplace_back(new TSPWorkQueue);
+
+	shared_bound = final_weight;
+	pending_tasks = 1;
+
+	TSPTask root;
+	root.bound = curr_bound;
+	root.weight = 0;
+	root.level = 1;
+	root.path.assign(vertices + 1, -1);
+	root.path[0] = 0;
+	queues[0]->tasks.push_back(root);
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++)
+		workers.emplace_back(&TSP::TSPWorker, this, i);
+
+	TSPWorker(0);
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	queues.clear();
+}
+
+//runs tasks until every task has been finished by some thread, a task is
+//only counted as finished after the tasks it spawned have been queued, so
+//pending_tasks cannot reach zero while there is still work left
+void TSP::TSPWorker(unsigned int id)
+{
+	VecBool curr_visited(vertices + 1, false);
+	TSPTask task;
+
+	while (pending_tasks.load() > 0)
+	{
+		if (!popTask(id, task))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		//the bound may have improved since the task was queued
+		if (canImprove(task.bound, task.weight, shared_bound.load(std::memory_order_relaxed)))
+		{
+			curr_visited.assign(curr_visited.size(), false);
+			for (int j = 0; j < task.level; j++)
+				curr_visited[task.path[j]] = true;
+
+			TSPParallelRec(id, task.bound, task.weight, task.level,
+				task.path, curr_visited);
+		}
+
+		pending_tasks--;
+	}
+}
+
+//same search as TSPRec(), but the path and visited flags belong to the
+//calling thread, so they are passed by reference and undone after each child
+void TSP::TSPParallelRec(unsigned int id, long long curr_bound, int curr_weight,
+	int level, VecInt& curr_path, VecBool& curr_visited)
+{
+	int last = curr_path[level - 1];
+
+	if (level == vertices)
+	{
+		if (adj[last][curr_path[0]] != 0)
+		{
+			int curr_res = curr_weight + adj[last][curr_path[0]];
+
+			if (curr_res < shared_bound.load(std::memory_order_relaxed))
+				recordTour(curr_res, curr_path);
+		}
+		return;
+	}
+
+	for (int i = 0; i < vertices; i++)
+	{
+		if (adj[last][i] != 0 && curr_visited[i] == false)
+		{
+			int weight = curr_weight + adj[last][i];
+			long long bound = childBound(curr_bound, level, last, i);
+
+			if (canImprove(bound, weight, shared_bound.load(std::memory_order_relaxed)))
+			{
+				curr_path[level] = i;
+
+				if (level < spawn_level)
+				{
+					TSPTask task;
+					task.bound = bound;
+					task.weight = weight;
+					task.level = level + 1;
+					task.path = curr_path;
+					pushTask(id, task);
+				}
+				else
+				{
+					curr_visited[i] = true;
+					TSPParallelRec(id, bound, weight, level + 1,
+						curr_path, curr_visited);
+					curr_visited[i] = false;
+				}
+			}
+		}
+	}
+}
+
+//queues a task on the calling thread's own queue
+void TSP::pushTask(unsigned int id, const TSPTask& task)
+{
+	pending_tasks++;
+
+	std::lock_guard<std::mutex> guard(queues[id]->lock);
+	queues[id]->tasks.push_back(task);
+}
+
+//takes the newest task from the thread's own queue, or steals the oldest
+//task from another thread if its own queue is empty
+bool TSP::popTask(unsigned int id, TSPTask& task)
+{
+	{
+		std::lock_guard<std::mutex> guard(queues[id]->lock);
+		if (!queues[id]->tasks.empty())
+		{
+			task = std::move(queues[id]->tasks.back());
+			queues[id]->tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (unsigned int i = 1; i < queues.size(); i++)
+	{
+		TSPWorkQueue& victim = *queues[(id + i) % queues.size()];
+
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//keeps a complete tour if it is still the best one once the lock is held,
+//since another thread may have found a better one in the meantime
+void TSP::recordTour(int weight, const VecInt& path)
+{
+	std::lock_guard<std::mutex> guard(result_lock);
+
+	if (weight < final_weight)
+	{
+		final_weight = weight;
+		final_path = path;
+		shared_bound.store(weight);
+	}
+}
+
+size_t TSP::heldKarpBytes(int cities)
+{
+	if (cities < 2)
+		return 0;
+
+	size_t others = cities - 1;
+	size_t width = (others + HK_LANES - 1) / HK_LANES * HK_LANES;
+	return ((size_t)1 << others) * width * sizeof(int) + others * width * sizeof(int);
+}
+
+bool TSP::heldKarpFits(int cities)
+{
+	if (cities > HK_MAX_CITIES)
+		return false;
+
+#if defined(__linux__)
+	double memory = (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+	if (memory > 0 && heldKarpBytes(cities) > memory * 0.75)
+		return false;
+#endif
+
+	return true;
+}
+
+//smallest prev[k] + cost[k], width is a multiple of HK_LANES so the inner loop
+//always runs HK_LANES times and is vectorized, the INF padding never wins
+int TSP::minPlus(const int* prev, const int* cost, int width)
+{
+	int lanes[HK_LANES];
+	for (int l = 0; l < HK_LANES; l++)
+		lanes[l] = HK_INF;
+
+	for (int k = 0; k < width; k += HK_LANES)
+		for (int l = 0; l < HK_LANES; l++)
+		{
+			int v = prev[k + l] + cost[k + l];
+			lanes[l] = (v < lanes[l]) ? v : lanes[l];
+		}
+
+	int best = lanes[0];
+	for (int l = 1; l < HK_LANES; l++)
+		best = std::min(best, lanes[l]);
+
+	return std::min(best, HK_INF);
+}
+
+//fills in every subset with size cities, the subsets are handed out to the
+//parts in blocks of masks so that each part gets a mix of the whole range
+void TSP::heldKarpLayer(int* table, const int* cost, int cities, int width,
+	int size, unsigned int part, unsigned int parts)
+{
+	size_t masks = (size_t)1 << cities;
+
+	for (size_t start = part * HK_BLOCK; start < masks; start += parts * HK_BLOCK)
+	{
+		size_t end = std::min(start + HK_BLOCK, masks);
+		for (size_t mask = start; mask < end; mask++)
+		{
+			if ((int)std::bitset<HK_MAX_CITIES>(mask).count() != size)
+				continue;
+
+			for (int j = 0; j < cities; j++)
+				if (mask & ((size_t)1 << j))
+				{
+					size_t prev = mask ^ ((size_t)1 << j);
+					table[mask * width + j] = minPlus(&table[prev * width], &cost[(size_t)j * width], width);
+				}
+		}
+	}
+}
+
+//exact dynamic programming solution in O(n^2 2^n) time, table[mask][j] is the
+//cheapest path that starts at 0, visits the cities in mask and ends at j, where
+//bit j of mask is city j + 1. every subset only depends on subsets one city
+//smaller, so each size is split between the threads and joined before the next
+void TSP::TSPHeldKarp(unsigned int threads)
+{
+	int cities = vertices - 1;
+	if (cities < 1)
+		return;
+
+	if (!heldKarpFits(vertices))
+		throw std::length_error("Held-Karp table for " + std::to_string(vertices) + " cities does not fit in memory");
+
+	int width = (cities + HK_LANES - 1) / HK_LANES * HK_LANES;
+	size_t masks = (size_t)1 << cities;
+
+	//cost[j][k] is the road from k + 1 to j + 1, so the predecessors of j are
+	//next to each other, missing roads and the padding are never chosen
+	VecInt cost((size_t)cities * width, HK_INF);
+	for (int j = 0; j < cities; j++)
+		for (int k = 0; k < cities; k++)
+			if (j != k && adj[k + 1][j + 1] != 0)
+				cost[(size_t)j * width + k] = adj[k + 1][j + 1];
+
+	VecInt table(masks * width, HK_INF);
+	for (int j = 0; j < cities; j++)
+		if (adj[0][j + 1] != 0)
+			table[((size_t)1 << j) * width + j] = adj[0][j + 1];
+
+	//small instances do not have a block for every thread
+	threads = (unsigned int)std::min<size_t>(std::max(threads, 1u), (masks + HK_BLOCK - 1) / HK_BLOCK);
+
+	for (int size = 2; size <= cities; size++)
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int t = 1; t < threads; t++)
+			workers.emplace_back(heldKarpLayer, table.data(), cost.data(), cities, width, size, t, threads);
+
+		heldKarpLayer(table.data(), cost.data(), cities, width, size, 0, threads);
+
+		for (size_t t = 0; t < workers.size(); t++)
+			workers[t].join();
+	}
+
+	size_t full = masks - 1;
+	int last = -1;
+	for (int j = 0; j < cities; j++)
+	{
+		int weight = table[full * width + j];
+		if (adj[j + 1][0] == 0 || weight >= HK_INF)
+			continue;
+
+		if (weight + adj[j + 1][0] < final_weight)
+		{
+			final_weight = weight + adj[j + 1][0];
+			last = j;
+		}
+	}
+
+	if (last < 0)
+		return;
+
+	//walk back from the last city, the previous city is any one whose entry
+	//plus the road matches, so no table of choices has to be kept
+	final_path.assign(vertices + 1, -1);
+	final_path[0] = 0;
+
+	size_t mask = full;
+	for (int pos = cities; pos >= 1; pos--)
+	{
+		final_path[pos] = last + 1;
+
+		size_t prev = mask ^ ((size_t)1 << last);
+		for (int k = 0; prev != 0 && k < cities; k++)
+			if ((prev & ((size_t)1 << k)) &&
+				table[prev * width + k] + cost[(size_t)last * width + k] == table[mask * width + last])
+			{
+				last = k;
+				break;
+			}
+
+		mask = prev;
+	}
+}
+
+//keeps the heuristic tour if it beats final_weight, the branch and bound
+//uses it as a starting upper bound, so it only keeps searching subtrees
+//that could still beat a good tour
+void TSP::TSPLocalSearch(int max_idle_kicks)
+{
+	if (vertices < 2)
+		return;
+
+	TSPHeuristic heuristic(adj);
+	VecInt tour;
+	long long weight = heuristic.solve(time_budget, max_idle_kicks, tour);
+
+	//the tour used a missing road
+	if (weight >= HEUR_MISSING || weight >= final_weight)
+		return;
+
+	final_weight = (int)weight;
+	final_path = tour;
+	final_path.push_back(-1);
+}
+
 //printing of the optimal path
-void TSP::printSolution(std::ofstream &os)
+void TSP::printSolution(std::ofstream &os, unsigned int threads, TSPMethod method)
 {
-	TSPUtil();
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	if (method == TSP_HEURISTIC)
+		TSPLocalSearch(INT_MAX);
+	else if (method == TSP_HELD_KARP)
+		TSPHeldKarp(threads);
+	else
+	{
+		//a quick tour to prune against, the search stops kicking it once a
+		//kick per city has not helped
+		TSPLocalSearch(vertices);
+
+		if (threads > 1 && vertices > 3)
+			TSPParallel(threads);
+		else
+			TSPUtil();
+	}
+
+	//every remaining city has to be reachable for there to be a tour
+	if (final_path.empty())
+	{
+		os << "No tour visits every city" << std::endl;
+		return;
+	}
 
 	os << "Minimun cost: " << final_weight
 		<< "\nPath by Vertex: ";
-	for (unsigned int i = 0; i < V; i++)
+	for (int i = 0; i < vertices; i++)
 	{
 		os << final_path.at(i);
-		if (i != final_path.size() - 1)
+		if (i != (int)final_path.size() - 1)
 			os << " -> ";
 	}
 	os << final_path.at(0) << std::endl;
 
 	os << "Path by City: ";
-	for (unsigned int i = 0; i < V; i++)
+	for (int i = 0; i < vertices; i++)
 	{
 		os << index[final_path.at(i)];
 		os << " -> ";
@@ -203,27 +755,50 @@ void TSP::printSolution(std::ofstream &os)
 	os << index[0] << std::endl;
 }
 
-//printing all possible paths
-void TSP::printAllPaths(std::ofstream& os)
+//printing all possible paths with their costs, with more than one thread
+//each thread takes the tours of one second city at a time and writes its
+//lines a block at a time, so the blocks are in whichever order they finish
+void TSP::printAllPaths(std::ofstream& os, unsigned int threads)
 {
-
 	os << std::endl << "All Possible Paths" << std::endl
-		<< "Assuming direct connections between all vertexes" << std::endl;
+		<< "Cost of each tour, or no road if it needs a road that does not exist" << std::endl;
 
-	std::sort(index.begin() + 1, index.end());
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, (unsigned int)std::max(1, vertices - 1));
 
-	while (std::next_permutation(index.begin() + 1, index.end()))
+	if (threads == 1 || vertices < 3)
 	{
+		TSPEnumerator tours(adj);
+		TourWriter out(os, index);
 
-		for (int i = 0; i < V; i++)
+		while (tours.next())
+			out.write(tours.path(), tours.cost(), tours.complete());
+		return;
+	}
+
+	std::mutex lock;
+	std::atomic<int> next_city(1);
+
+	auto work = [&]()
+	{
+		TourWriter out(os, index, &lock);
+
+		for (int city = next_city++; city < vertices; city = next_city++)
 		{
-			os << index[i];
-			if (i != index.size() - 1)
-			{
-				os << " -> ";
-			}
+			TSPEnumerator tours(adj, VecInt(1, city));
+
+			while (tours.next())
+				out.write(tours.path(), tours.cost(), tours.complete());
 		}
-		os << std::endl;
-	}
+	};
 
-}
\ No newline at end of file
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threads; i++)
+		workers.emplace_back(work);
+
+	work();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
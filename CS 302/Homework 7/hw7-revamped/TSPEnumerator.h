@@ -0,0 +1,233 @@
+/**
+ * @brief  CS-302 Homework 7
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Lazy enumeration of every tour that starts at city 0, one tour per call to next()
+ * The cities after a fixed prefix are permuted with Heap's algorithm, which swaps two cities per
+ * tour, so the cost is updated from the few roads next to the swapped cities instead of summed again.
+ * Tours with different prefixes can be enumerated by different threads
+ * https://en.wikipedia.org/wiki/Heap%27s_algorithm used for reference
+ *
+ * TourWriter formats tours into a large buffer and writes it out a block at a time, so that writing
+ * every tour is limited by the disk and not by formatting one << at a time
+ */
+#pragma once
+#include "DistanceMatrix.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <mutex>
+#include <algorithm>
+
+typedef std::vector<int> VecInt;
+typedef std::vector<std::string> VecString;
+
+//bytes formatted before TourWriter writes them out
+#define TOUR_BUFFER_SIZE (1 << 20)
+
+
+class TSPEnumerator {
+	//public methods
+public:
+
+	//tours that start with city 0 and then the cities in prefix, which must
+	//not contain 0 or any city twice
+	TSPEnumerator(const DistanceMatrix& graph, const VecInt& prefix = VecInt());
+
+	//moves to the next tour, false once every tour has been seen
+	bool next();
+
+	//the current tour, ending back at city 0
+	const VecInt& path() const { return tour; }
+
+	//the current tour's cost, which only counts roads that exist
+	long long cost() const { return weight; }
+
+	//true if every road of the current tour exists
+	bool complete() const { return missing == 0; }
+
+	//protected methods, only for helper methods
+protected:
+	void addRoad(int from, int to, int sign);
+	void swapCities(int a, int b);
+
+private:
+	const DistanceMatrix& adj;
+
+	//tour[0] and tour.back() are city 0, the cities from first on are permuted
+	VecInt tour;
+	int first;
+	int count;
+
+	long long weight = 0;
+	int missing = 0;
+
+	//Heap's algorithm state, c[i] counts the swaps made at depth i
+	VecInt c;
+	int i = 1;
+	bool started = false;
+};
+
+//formats tours as "name -> name -> ...: cost" lines
+class TourWriter {
+	//public methods
+public:
+
+	//lock is held while writing to os, so several writers can share it
+	TourWriter(std::ostream& os, const VecString& names, std::mutex* lock = NULL);
+	~TourWriter() { flush(); }
+
+	void write(const VecInt& path, long long cost, bool complete);
+	void flush();
+
+private:
+	std::ostream& os;
+	std::mutex* lock;
+
+	//names with " -> " already added, so a tour is copied a city at a time
+	VecString arrows;
+	VecString names;
+	std::string buffer;
+};
+
+TSPEnumerator::TSPEnumerator(const DistanceMatrix& graph, const VecInt& prefix)
+	: adj(graph)
+{
+	int vertices = adj.size();
+	std::vector<bool> used(vertices, false);
+
+	tour.push_back(0);
+	used[0] = true;
+	for (size_t k = 0; k < prefix.size(); k++)
+	{
+		tour.push_back(prefix[k]);
+		used[prefix[k]] = true;
+	}
+
+	first = (int)tour.size();
+	for (int v = 0; v < vertices; v++)
+		if (!used[v])
+			tour.push_back(v);
+	tour.push_back(0);
+
+	count = (int)tour.size() - 1 - first;
+	c.assign(std::max(count, 1), 0);
+
+	for (size_t k = 0; k + 1 < tour.size(); k++)
+		addRoad(tour[k], tour[k + 1], 1);
+}
+
+//adds (sign 1) or removes (sign -1) the road from one city to the next
+void TSPEnumerator::addRoad(int from, int to, int sign)
+{
+	if (adj[from][to] != 0)
+		weight += sign * adj[from][to];
+	else
+		missing += sign;
+}
+
+//swaps the cities at tour positions a < b, only the roads into and out of
+//them change, and the road between them is counted once when they are next
+//to each other
+void TSPEnumerator::swapCities(int a, int b)
+{
+	addRoad(tour[a - 1], tour[a], -1);
+	addRoad(tour[a], tour[a + 1], -1);
+	if (b != a + 1)
+		addRoad(tour[b - 1], tour[b], -1);
+	addRoad(tour[b], tour[b + 1], -1);
+
+	std::swap(tour[a], tour[b]);
+
+	addRoad(tour[a - 1], tour[a], 1);
+	addRoad(tour[a], tour[a + 1], 1);
+	if (b != a + 1)
+		addRoad(tour[b - 1], tour[b], 1);
+	addRoad(tour[b], tour[b + 1], 1);
+}
+
+//the iterative form of Heap's algorithm, stopped after every swap
+bool TSPEnumerator::next()
+{
+	if (!started)
+	{
+		started = true;
+		return true;
+	}
+
+	while (i < count)
+	{
+		if (c[i] < i)
+		{
+			int j = (i % 2 == 0) ? 0 : c[i];
+			swapCities(first + j, first + i);
+			c[i]++;
+			i = 1;
+			return true;
+		}
+
+		c[i] = 0;
+		i++;
+	}
+
+	return false;
+}
+
+TourWriter::TourWriter(std::ostream& os, const VecString& names, std::mutex* lock)
+	: os(os), lock(lock), names(names)
+{
+	for (size_t k = 0; k < names.size(); k++)
+		arrows.push_back(names[k] + " -> ");
+
+	buffer.reserve(TOUR_BUFFER_SIZE + 4096);
+}
+
+void TourWriter::write(const VecInt& path, long long cost, bool complete)
+{
+	for (size_t k = 0; k + 1 < path.size(); k++)
+		buffer += arrows[path[k]];
+	buffer += names[path.back()];
+
+	if (complete)
+	{
+		//digits are written backwards into a small buffer, faster than a stream
+		char digits[24];
+		int n = 0;
+		do
+		{
+			digits[n++] = (char)('0' + cost % 10);
+			cost /= 10;
+		} while (cost > 0);
+
+		buffer += ": ";
+		while (n > 0)
+			buffer += digits[--n];
+	}
+	else
+	{
+		buffer += ": no road";
+	}
+	buffer += '\n';
+
+	if (buffer.size() >= TOUR_BUFFER_SIZE)
+		flush();
+}
+
+void TourWriter::flush()
+{
+	if (buffer.empty())
+		return;
+
+	if (lock != NULL)
+	{
+		std::lock_guard<std::mutex> guard(*lock);
+		os.write(buffer.data(), buffer.size());
+	}
+	else
+	{
+		os.write(buffer.data(), buffer.size());
+	}
+
+	buffer.clear();
+}
@@ -0,0 +1,444 @@
+/**
+ * @brief  CS-302 Homework 7
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Heuristic tours for instances too large for an exact solver
+ * A nearest neighbour tour is improved with 2-opt and Or-opt moves until no move helps, then the
+ * tour is kicked with a random double bridge and improved again until the time budget runs out.
+ * Moves are only tried against the closest few cities of each city (neighbour lists), and a city
+ * is only looked at again once a move has changed one of its roads (don't-look bits)
+ *
+ * 2-opt reverses part of the tour, which changes its cost when the matrix is not symmetric, so
+ * only Or-opt moves are used for those instances
+ */
+#pragma once
+#include "DistanceMatrix.h"
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <climits>
+
+typedef std::vector<int> VecInt;
+typedef std::vector<bool> VecBool;
+
+//closest cities kept for each city
+#define HEUR_NEIGHBOURS 10
+//longest run of cities an Or-opt move takes out of the tour
+#define HEUR_SEGMENT 3
+//cost of a missing road, high enough that local search gets rid of it when it can
+#define HEUR_MISSING ((long long)INT_MAX)
+
+//tour being improved, pos[c] is where city c is in order
+struct TSPTour
+{
+	VecInt order;
+	VecInt pos;
+
+	int size() const { return (int)order.size(); }
+	int at(int i) const { return order[(i % size() + size()) % size()]; }
+	int next(int c) const { return at(pos[c] + 1); }
+	int prev(int c) const { return at(pos[c] - 1); }
+
+	void place();
+	void reverse(int i, int j);
+};
+
+
+class TSPHeuristic {
+	//public methods
+public:
+
+	explicit TSPHeuristic(const DistanceMatrix& graph);
+
+	//best tour found within seconds, starting at city 0, or stopping early after
+	//max_idle_kicks kicks in a row that did not improve it. returns its cost,
+	//which is at least HEUR_MISSING if the tour needs a road that does not exist
+	long long solve(double seconds, int max_idle_kicks, VecInt& tour);
+
+	//protected methods, only for helper methods
+protected:
+	typedef std::chrono::steady_clock Clock;
+
+	long long cost(int i, int j) const;
+	long long tourCost(const TSPTour& tour) const;
+
+	void buildNeighbours();
+	void nearestNeighbour(TSPTour& tour) const;
+
+	bool localSearch(TSPTour& tour, std::deque<int>& active, VecBool& queued, Clock::time_point deadline);
+	bool twoOptMove(TSPTour& tour, int a, VecInt& touched) const;
+	bool orOptMove(TSPTour& tour, int a, VecInt& touched) const;
+	void moveSegment(TSPTour& tour, int first, int length, int after) const;
+	void doubleBridge(TSPTour& tour, std::mt19937& rng, VecInt& touched) const;
+
+private:
+	const DistanceMatrix& adj;
+	int vertices;
+	bool symmetric;
+
+	//neighbours[i] are the closest cities to i, closest first
+	std::vector<VecInt> neighbours;
+};
+
+//recomputes pos after order has been rebuilt
+void TSPTour::place()
+{
+	pos.resize(order.size());
+	for (int i = 0; i < size(); i++)
+		pos[order[i]] = i;
+}
+
+//reverses the cities from position i to position j, wrapping around the end.
+//the tour is a cycle, so reversing the other side instead gives the same
+//tour in the other direction, and the shorter side is the one reversed
+void TSPTour::reverse(int i, int j)
+{
+	int n = size();
+	int length = ((j - i) % n + n) % n + 1;
+
+	if (2 * length > n)
+	{
+		int start = j + 1;
+		j = i - 1;
+		i = start;
+		length = n - length;
+	}
+
+	for (int k = 0; k < length / 2; k++)
+	{
+		int a = ((i + k) % n + n) % n;
+		int b = ((j - k) % n + n) % n;
+		std::swap(order[a], order[b]);
+		pos[order[a]] = a;
+		pos[order[b]] = b;
+	}
+}
+
+TSPHeuristic::TSPHeuristic(const DistanceMatrix& graph)
+	: adj(graph), vertices(graph.size()), symmetric(true)
+{
+	for (int i = 0; i < vertices && symmetric; i++)
+		for (int j = i + 1; j < vertices; j++)
+			if (adj[i][j] != adj[j][i])
+			{
+				symmetric = false;
+				break;
+			}
+
+	buildNeighbours();
+}
+
+//road from i to j, 0 means there is no road
+long long TSPHeuristic::cost(int i, int j) const
+{
+	if (i == j)
+		return 0;
+
+	return (adj[i][j] != 0) ? adj[i][j] : HEUR_MISSING;
+}
+
+long long TSPHeuristic::tourCost(const TSPTour& tour) const
+{
+	long long total = 0;
+	for (int i = 0; i < tour.size(); i++)
+		total += cost(tour.order[i], tour.at(i + 1));
+
+	return total;
+}
+
+//the cities are ordered by the cheaper direction of the road, so the key is
+//never more than the road actually used in either direction
+void TSPHeuristic::buildNeighbours()
+{
+	int k = std::min(HEUR_NEIGHBOURS, vertices - 1);
+	neighbours.assign(vertices, VecInt());
+
+	for (int i = 0; i < vertices; i++)
+	{
+		VecInt others;
+		for (int j = 0; j < vertices; j++)
+			if (j != i)
+				others.push_back(j);
+
+		auto closer = [&](int a, int b)
+		{
+			return std::min(cost(i, a), cost(a, i)) < std::min(cost(i, b), cost(b, i));
+		};
+
+		std::partial_sort(others.begin(), others.begin() + k, others.end(), closer);
+		neighbours[i].assign(others.begin(), others.begin() + k);
+	}
+}
+
+//starts at city 0 and always goes to the closest city not yet visited
+void TSPHeuristic::nearestNeighbour(TSPTour& tour) const
+{
+	VecBool visited(vertices, false);
+	tour.order.assign(1, 0);
+	visited[0] = true;
+
+	for (int step = 1; step < vertices; step++)
+	{
+		int last = tour.order.back();
+		int best = -1;
+
+		for (int j = 0; j < vertices; j++)
+			if (!visited[j] && (best < 0 || cost(last, j) < cost(last, best)))
+				best = j;
+
+		tour.order.push_back(best);
+		visited[best] = true;
+	}
+
+	tour.place();
+}
+
+//tries a 2-opt move that replaces one of the roads at a with a road from a to
+//one of its neighbours, in either direction along the tour
+bool TSPHeuristic::twoOptMove(TSPTour& tour, int a, VecInt& touched) const
+{
+	for (int forward = 1; forward >= 0; forward--)
+	{
+		int b = forward ? tour.next(a) : tour.prev(a);
+		long long ab = cost(a, b);
+
+		for (size_t n = 0; n < neighbours[a].size(); n++)
+		{
+			int c = neighbours[a][n];
+			long long ac = cost(a, c);
+
+			//the rest of the list is no closer than the road being replaced
+			if (ac >= ab)
+				break;
+
+			int d = forward ? tour.next(c) : tour.prev(c);
+			if (c == b || d == a)
+				continue;
+
+			if (ac + cost(b, d) - ab - cost(c, d) < 0)
+			{
+				//a b ... c d becomes a c ... b d, and b a ... d c becomes b d ... a c
+				if (forward)
+					tour.reverse(tour.pos[b], tour.pos[c]);
+				else
+					tour.reverse(tour.pos[a], tour.pos[d]);
+
+				touched.push_back(a);
+				touched.push_back(b);
+				touched.push_back(c);
+				touched.push_back(d);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+//tries moving the run of up to HEUR_SEGMENT cities starting at a to between
+//two cities next to each other elsewhere, one of which is a neighbour of an
+//end of the run. the run keeps its direction, so this also works when the
+//matrix is not symmetric
+bool TSPHeuristic::orOptMove(TSPTour& tour, int a, VecInt& touched) const
+{
+	int n = tour.size();
+
+	for (int length = 1; length <= HEUR_SEGMENT && length + 3 <= n; length++)
+	{
+		int first = a;
+		int last = tour.at(tour.pos[a] + length - 1);
+		int p = tour.prev(first);
+		int nx = tour.next(last);
+
+		long long removed = cost(p, first) + cost(last, nx) - cost(p, nx);
+		if (removed <= 0)
+			continue;
+
+		//the run goes between c and d, c is a neighbour of first or d is a
+		//neighbour of last
+		for (int side = 0; side < 2; side++)
+		{
+			const VecInt& close = neighbours[side == 0 ? first : last];
+
+			for (size_t k = 0; k < close.size(); k++)
+			{
+				int city = close[k];
+				int end = (side == 0) ? first : last;
+				if (std::min(cost(city, end), cost(end, city)) >= removed)
+					break;
+
+				int c = (side == 0) ? city : tour.prev(city);
+				int d = tour.next(c);
+
+				//c is inside the run, or the run is already between c and d
+				if ((tour.pos[c] - tour.pos[first] + n) % n < length || c == p)
+					continue;
+
+				if (cost(c, first) + cost(last, d) - cost(c, d) < removed)
+				{
+					moveSegment(tour, first, length, c);
+
+					touched.push_back(p);
+					touched.push_back(nx);
+					touched.push_back(first);
+					touched.push_back(last);
+					touched.push_back(c);
+					touched.push_back(d);
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+//takes length cities starting at first out of the tour and puts them back
+//right after the city after, the tour is rebuilt so this is O(n)
+void TSPHeuristic::moveSegment(TSPTour& tour, int first, int length, int after) const
+{
+	int n = tour.size();
+	int start = tour.pos[first];
+
+	VecInt order;
+	order.reserve(n);
+
+	for (int i = start + length; i < start + n; i++)
+	{
+		int c = tour.at(i);
+		order.push_back(c);
+
+		if (c == after)
+			for (int k = 0; k < length; k++)
+				order.push_back(tour.at(start + k));
+	}
+
+	tour.order.swap(order);
+	tour.place();
+}
+
+//cuts the tour into four parts A B C D and joins them as A C B D, which
+//2-opt and Or-opt cannot undo in a single move
+void TSPHeuristic::doubleBridge(TSPTour& tour, std::mt19937& rng, VecInt& touched) const
+{
+	int n = tour.size();
+	std::uniform_int_distribution<int> pick(1, n - 1);
+
+	int cut[3];
+	do
+	{
+		for (int k = 0; k < 3; k++)
+			cut[k] = pick(rng);
+		std::sort(cut, cut + 3);
+	} while (cut[0] == cut[1] || cut[1] == cut[2]);
+
+	VecInt order(tour.order.begin(), tour.order.begin() + cut[0]);
+	order.insert(order.end(), tour.order.begin() + cut[1], tour.order.begin() + cut[2]);
+	order.insert(order.end(), tour.order.begin() + cut[0], tour.order.begin() + cut[1]);
+	order.insert(order.end(), tour.order.begin() + cut[2], tour.order.end());
+
+	for (int k = 0; k < 3; k++)
+	{
+		touched.push_back(tour.order[cut[k] - 1]);
+		touched.push_back(tour.order[cut[k]]);
+	}
+
+	tour.order.swap(order);
+	tour.place();
+}
+
+//improves the tour until none of the active cities has a move left, returns
+//false if the deadline came first
+bool TSPHeuristic::localSearch(TSPTour& tour, std::deque<int>& active, VecBool& queued, Clock::time_point deadline)
+{
+	VecInt touched;
+
+	while (!active.empty())
+	{
+		if (Clock::now() >= deadline)
+			return false;
+
+		int a = active.front();
+		active.pop_front();
+		queued[a] = false;
+
+		touched.clear();
+		if ((symmetric && twoOptMove(tour, a, touched)) || orOptMove(tour, a, touched))
+		{
+			for (size_t k = 0; k < touched.size(); k++)
+				if (!queued[touched[k]])
+				{
+					queued[touched[k]] = true;
+					active.push_back(touched[k]);
+				}
+		}
+	}
+
+	return true;
+}
+
+long long TSPHeuristic::solve(double seconds, int max_idle_kicks, VecInt& tour)
+{
+	Clock::time_point deadline = Clock::now() +
+		std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+	TSPTour best;
+	nearestNeighbour(best);
+
+	//too few cities for the moves to have anywhere to go
+	if (vertices >= 5)
+	{
+		std::deque<int> active;
+		VecBool queued(vertices, true);
+		for (int i = 0; i < vertices; i++)
+			active.push_back(best.order[i]);
+
+		bool finished = localSearch(best, active, queued, deadline);
+		long long best_cost = tourCost(best);
+
+		//same seed every run so that results can be repeated
+		std::mt19937 rng(302);
+		VecInt touched;
+
+		for (int idle = 0; finished && vertices >= 8 && idle < max_idle_kicks; idle++)
+		{
+			TSPTour kicked = best;
+
+			touched.clear();
+			doubleBridge(kicked, rng, touched);
+			for (size_t k = 0; k < touched.size(); k++)
+				if (!queued[touched[k]])
+				{
+					queued[touched[k]] = true;
+					active.push_back(touched[k]);
+				}
+
+			finished = localSearch(kicked, active, queued, deadline);
+
+			long long kicked_cost = tourCost(kicked);
+			if (kicked_cost < best_cost)
+			{
+				best = kicked;
+				best_cost = kicked_cost;
+				idle = -1;
+			}
+
+			//a search cut off by the deadline leaves cities queued
+			while (!active.empty())
+			{
+				queued[active.front()] = false;
+				active.pop_front();
+			}
+		}
+	}
+
+	//the tour starts at city 0
+	tour.clear();
+	for (int i = 0; i < vertices; i++)
+		tour.push_back(best.at(best.pos[0] + i));
+
+	return tourCost(best);
+}
@@ -0,0 +1,462 @@
+/**
+ * @brief  CS-302 Homework 7
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Loaders for TSP instances stored as TSPLIB .tsp files or CSV distance matrices
+ * Both read the input a line (or a number) at a time, the file is never loaded into memory as a whole
+ * http://comopt.ifi.uni-heidelberg.de/software/TSPLIB95/tsp95.pdf used for reference
+ *
+ * The solver treats a distance of 0 between two different cities as "no road", so an instance with
+ * two cities at the same location will not allow that edge
+ */
+#pragma once
+#include "DistanceMatrix.h"
+#include <vector>
+#include <string>
+#include <istream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+
+typedef std::vector<std::string> VecString;
+
+
+class TSPLoader {
+	//public methods
+public:
+
+	//each returns false and sets error if the input could not be used
+	static bool loadTSPLIB(std::istream& in, DistanceMatrix& matrix, VecString& names, std::string& error);
+	static bool loadCSV(std::istream& in, DistanceMatrix& matrix, VecString& names, std::string& error);
+
+	//picks the format from the extension, .tsp/.atsp for TSPLIB, anything else is read as CSV
+	static bool loadFile(const std::string& filename, DistanceMatrix& matrix, VecString& names, std::string& error);
+
+	//protected methods, only for helper methods
+protected:
+	static std::string trim(const std::string& s);
+	static bool looksNumeric(const std::string& s);
+	static bool parseInt(const std::string& s, int& value);
+	static int coordDistance(const std::string& type, double x1, double y1, double x2, double y2);
+	static double geoRadians(double x);
+	static bool readExplicit(std::istream& in, const std::string& format, DistanceMatrix& matrix, std::string& error);
+};
+
+//removes spaces, tabs, carriage returns and quotes from both ends
+std::string TSPLoader::trim(const std::string& s)
+{
+	const char* junk = " \t\r\n\"";
+	size_t first = s.find_first_not_of(junk);
+	if (first == std::string::npos)
+		return "";
+
+	size_t last = s.find_last_not_of(junk);
+	return s.substr(first, last - first + 1);
+}
+
+//true if s is written as a whole number, whether or not it fits in an int,
+//so a number that is too large is reported instead of taken for a name
+bool TSPLoader::looksNumeric(const std::string& s)
+{
+	size_t first = (!s.empty() && (s[0] == '-' || s[0] == '+')) ? 1 : 0;
+	if (first == s.size())
+		return false;
+
+	for (size_t i = first; i < s.size(); i++)
+		if (s[i] < '0' || s[i] > '9')
+			return false;
+
+	return true;
+}
+
+//true if all of s is a whole number that fits in an int
+bool TSPLoader::parseInt(const std::string& s, int& value)
+{
+	if (s.empty())
+		return false;
+
+	char* end = NULL;
+	errno = 0;
+	long result = std::strtol(s.c_str(), &end, 10);
+	if (*end != '\0' || errno == ERANGE || result < INT_MIN || result > INT_MAX)
+		return false;
+
+	value = (int)result;
+	return true;
+}
+
+//latitude or longitude in TSPLIB's DDD.MM format converted to radians
+double TSPLoader::geoRadians(double x)
+{
+	const double PI = 3.141592;
+	int deg = (int)x;
+	double min = x - deg;
+	return PI * (deg + 5.0 * min / 3.0) / 180.0;
+}
+
+//distance between two nodes for each EDGE_WEIGHT_TYPE that uses coordinates,
+//rounded the way the TSPLIB documentation specifies so optimal tour lengths match
+int TSPLoader::coordDistance(const std::string& type, double x1, double y1, double x2, double y2)
+{
+	double dx = x1 - x2;
+	double dy = y1 - y2;
+
+	if (type == "CEIL_2D")
+		return (int)std::ceil(std::sqrt(dx * dx + dy * dy));
+
+	if (type == "MAN_2D")
+		return (int)(std::fabs(dx) + std::fabs(dy) + 0.5);
+
+	if (type == "MAX_2D")
+		return std::max((int)(std::fabs(dx) + 0.5), (int)(std::fabs(dy) + 0.5));
+
+	if (type == "ATT")
+	{
+		double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+		int t = (int)(r + 0.5);
+		return (t < r) ? t + 1 : t;
+	}
+
+	if (type == "GEO")
+	{
+		const double RRR = 6378.388;
+		double lat1 = geoRadians(x1), lon1 = geoRadians(y1);
+		double lat2 = geoRadians(x2), lon2 = geoRadians(y2);
+		double q1 = std::cos(lon1 - lon2);
+		double q2 = std::cos(lat1 - lat2);
+		double q3 = std::cos(lat1 + lat2);
+		return (int)(RRR * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+	}
+
+	//EUC_2D
+	return (int)(std::sqrt(dx * dx + dy * dy) + 0.5);
+}
+
+//reads the numbers of an EDGE_WEIGHT_SECTION in the order given by format,
+//the column formats list the same entries as the opposite row format since
+//the matrix is symmetric, so they share the same loop
+bool TSPLoader::readExplicit(std::istream& in, const std::string& format, DistanceMatrix& matrix, std::string& error)
+{
+	int n = matrix.size();
+
+	if (format == "FULL_MATRIX")
+	{
+		for (int i = 0; i < n; i++)
+			for (int j = 0; j < n; j++)
+				if (!(in >> matrix[i][j]))
+				{
+					error = "EDGE_WEIGHT_SECTION ended early";
+					return false;
+				}
+
+		for (int i = 0; i < n; i++)
+			matrix[i][i] = 0;
+
+		return true;
+	}
+
+	bool upper, diagonal;
+	if (format == "UPPER_ROW" || format == "LOWER_COL")
+		upper = true, diagonal = false;
+	else if (format == "LOWER_ROW" || format == "UPPER_COL")
+		upper = false, diagonal = false;
+	else if (format == "UPPER_DIAG_ROW" || format == "LOWER_DIAG_COL")
+		upper = true, diagonal = true;
+	else if (format == "LOWER_DIAG_ROW" || format == "UPPER_DIAG_COL")
+		upper = false, diagonal = true;
+	else
+	{
+		error = "unsupported EDGE_WEIGHT_FORMAT " + format;
+		return false;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		int first = upper ? (diagonal ? i : i + 1) : 0;
+		int last = upper ? n - 1 : (diagonal ? i : i - 1);
+
+		for (int j = first; j <= last; j++)
+		{
+			int value;
+			if (!(in >> value))
+			{
+				error = "EDGE_WEIGHT_SECTION ended early";
+				return false;
+			}
+
+			if (i != j)
+				matrix[i][j] = matrix[j][i] = value;
+		}
+	}
+
+	return true;
+}
+
+//reads a TSP or ATSP instance, the nodes are named by their TSPLIB numbers
+bool TSPLoader::loadTSPLIB(std::istream& in, DistanceMatrix& matrix, VecString& names, std::string& error)
+{
+	std::string type = "TSP", weightType, weightFormat = "FULL_MATRIX";
+	int n = 0;
+	bool haveWeights = false;
+	std::vector<double> xs, ys;
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		std::string key = line, value;
+		size_t colon = line.find(':');
+		if (colon != std::string::npos)
+		{
+			key = line.substr(0, colon);
+			value = trim(line.substr(colon + 1));
+		}
+		key = trim(key);
+
+		if (key.empty())
+			continue;
+
+		if (key == "EOF")
+			break;
+
+		if (key == "NAME" || key == "COMMENT" || key == "DISPLAY_DATA_TYPE" || key == "NODE_COORD_TYPE")
+			continue;
+
+		if (key == "TYPE")
+		{
+			type = value;
+			if (type != "TSP" && type != "ATSP")
+			{
+				error = "unsupported TYPE " + type;
+				return false;
+			}
+		}
+		else if (key == "DIMENSION")
+		{
+			if (!parseInt(value, n) || n < 1)
+			{
+				error = "bad DIMENSION " + value;
+				return false;
+			}
+			matrix = DistanceMatrix(n);
+		}
+		else if (key == "EDGE_WEIGHT_TYPE")
+			weightType = value;
+		else if (key == "EDGE_WEIGHT_FORMAT")
+			weightFormat = value;
+		else if (n == 0)
+		{
+			error = "DIMENSION must come before " + key;
+			return false;
+		}
+		else if (key == "NODE_COORD_SECTION" || key == "DISPLAY_DATA_SECTION")
+		{
+			std::vector<double> x(n), y(n);
+			for (int i = 0; i < n; i++)
+			{
+				int id;
+				if (!(in >> id >> x[i] >> y[i]))
+				{
+					error = key + " ended early";
+					return false;
+				}
+			}
+
+			//display coordinates are only used to draw the tour
+			if (key == "NODE_COORD_SECTION")
+				xs.swap(x), ys.swap(y);
+		}
+		else if (key == "EDGE_WEIGHT_SECTION")
+		{
+			if (!readExplicit(in, weightFormat, matrix, error))
+				return false;
+			haveWeights = true;
+		}
+		else if (key == "FIXED_EDGES_SECTION")
+		{
+			int id;
+			while ((in >> id) && id != -1)
+				;
+		}
+		else
+		{
+			error = "unsupported section " + key;
+			return false;
+		}
+	}
+
+	if (n == 0)
+	{
+		error = "no DIMENSION";
+		return false;
+	}
+
+	if (!haveWeights)
+	{
+		if (xs.empty())
+		{
+			error = "no NODE_COORD_SECTION or EDGE_WEIGHT_SECTION";
+			return false;
+		}
+
+		if (weightType != "EUC_2D" && weightType != "CEIL_2D" && weightType != "MAN_2D" &&
+			weightType != "MAX_2D" && weightType != "ATT" && weightType != "GEO")
+		{
+			error = "unsupported EDGE_WEIGHT_TYPE " + weightType;
+			return false;
+		}
+
+		for (int i = 0; i < n; i++)
+			for (int j = 0; j < n; j++)
+				matrix[i][j] = (i == j) ? 0 : coordDistance(weightType, xs[i], ys[i], xs[j], ys[j]);
+	}
+
+	names.resize(n);
+	for (int i = 0; i < n; i++)
+		names[i] = std::to_string(i + 1);
+
+	return true;
+}
+
+//reads a square matrix of whole numbers separated by commas, the first line
+//may be a header of city names and each row may start with the city's name,
+//cities without a name are numbered from 0. the first row of distances sets
+//the number of cities, and every row is parsed straight into the matrix
+bool TSPLoader::loadCSV(std::istream& in, DistanceMatrix& matrix, VecString& names, std::string& error)
+{
+	VecString header, labels, cells;
+	std::string line, cell;
+	int n = 0, rows = 0;
+
+	while (std::getline(in, line))
+	{
+		if (trim(line).empty())
+			continue;
+
+		cells.clear();
+		std::stringstream ss(line);
+		while (std::getline(ss, cell, ','))
+			cells.push_back(trim(cell));
+
+		//ignore trailing commas
+		while (!cells.empty() && cells.back().empty())
+			cells.pop_back();
+
+		//the header is the first line if any of its cells are not numbers
+		if (rows == 0 && header.empty())
+		{
+			bool numeric = true;
+			for (size_t i = 1; i < cells.size() && numeric; i++)
+				numeric = looksNumeric(cells[i]);
+
+			if (!numeric)
+			{
+				header = cells;
+				continue;
+			}
+		}
+
+		//a first cell that is not a number is the row's label
+		size_t start = 0;
+		std::string label;
+		if (!cells.empty() && !looksNumeric(cells[0]))
+		{
+			label = cells[0];
+			start = 1;
+		}
+
+		int count = (int)(cells.size() - start);
+
+		if (rows == 0)
+		{
+			if (count == 0)
+			{
+				error = "row 1 has no distances";
+				return false;
+			}
+
+			n = count;
+			matrix = DistanceMatrix(n);
+			labels.assign(n, "");
+		}
+
+		if (rows == n)
+		{
+			error = "more than " + std::to_string(n) + " rows of distances";
+			return false;
+		}
+
+		if (count != n)
+		{
+			error = "row " + std::to_string(rows + 1) + " has " + std::to_string(count) +
+				" distances, expected " + std::to_string(n);
+			return false;
+		}
+
+		int* row = matrix[rows];
+		for (int j = 0; j < n; j++)
+		{
+			if (!parseInt(cells[start + j], row[j]))
+			{
+				error = "not a number in int range: " + cells[start + j];
+				return false;
+			}
+		}
+		row[rows] = 0;
+
+		labels[rows] = label;
+		rows++;
+	}
+
+	if (rows == 0)
+	{
+		error = "no distances";
+		return false;
+	}
+
+	if (rows != n)
+	{
+		error = "only " + std::to_string(rows) + " rows of distances, expected " + std::to_string(n);
+		return false;
+	}
+
+	//the header lines up with the distances, unless there is an extra cell
+	//above the row labels
+	size_t offset = (header.size() == (size_t)n + 1) ? 1 : 0;
+
+	names.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		if (header.size() >= (size_t)n + offset && !header[i + offset].empty())
+			names[i] = header[i + offset];
+		else if (!labels[i].empty())
+			names[i] = labels[i];
+		else
+			names[i] = std::to_string(i);
+	}
+
+	return true;
+}
+
+bool TSPLoader::loadFile(const std::string& filename, DistanceMatrix& matrix, VecString& names, std::string& error)
+{
+	std::ifstream in(filename);
+	if (!in)
+	{
+		error = "could not open " + filename;
+		return false;
+	}
+
+	size_t dot = filename.find_last_of('.');
+	std::string ext = (dot == std::string::npos) ? "" : filename.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	if (ext == "tsp" || ext == "atsp")
+		return loadTSPLIB(in, matrix, names, error);
+
+	return loadCSV(in, matrix, names, error);
+}
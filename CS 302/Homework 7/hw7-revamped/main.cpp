@@ -1,17 +1,70 @@
 #include "TSP.h"
+#include "TSPLoader.h"
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
 
+//largest instance that all of the possible paths are written out for
+#define MAX_PRINTED_CITIES 10
 
-int main()
+//with no arguments solves the five Nevada-area cities, otherwise loads a
+//TSPLIB .tsp file or a CSV distance matrix, -hk solves with Held-Karp
+//instead of branch and bound, -heur finds a good tour with local search
+//within -time seconds (1 by default) for instances too large to solve exactly
+int main(int argc, char *argv[])
 {
+	DistanceMatrix graph;
+	VecString names;
+	TSPMethod method = TSP_BRANCH_AND_BOUND;
+	const char* filename = NULL;
+	double seconds = 1.0;
 
-	TSP t; //class with all functions and data
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-hk") == 0)
+			method = TSP_HELD_KARP;
+		else if (std::strcmp(argv[i], "-heur") == 0)
+			method = TSP_HEURISTIC;
+		else if (std::strcmp(argv[i], "-time") == 0 && i + 1 < argc)
+			seconds = std::atof(argv[++i]);
+		else
+			filename = argv[i];
+	}
+
+	if (filename != NULL)
+	{
+		std::string error;
+		if (!TSPLoader::loadFile(filename, graph, names, error))
+		{
+			std::cout << filename << ": " << error << std::endl;
+			return 1;
+		}
+	}
+
+	//class with all functions and data
+	std::unique_ptr<TSP> t((filename != NULL) ? new TSP(graph, names) : new TSP());
 	std::ofstream fp("paths.txt", std::ios::out | std::ios::trunc); //for outputting paths
+	t->setTimeBudget(seconds);
+
+	if (method == TSP_HELD_KARP)
+	{
+		std::cout << "Held-Karp table for " << t->size() << " cities needs "
+			<< TSP::heldKarpBytes(t->size()) / (1024.0 * 1024.0) << " MB." << std::endl;
 
-	t.printSolution(fp);
+		if (!TSP::heldKarpFits(t->size()))
+		{
+			std::cout << "Held-Karp supports at most " << HK_MAX_CITIES
+				<< " cities and 3/4 of the memory." << std::endl;
+			return 1;
+		}
+	}
 
-	t.printAllPaths(fp);
+	t->printSolution(fp, 0, method); //0 uses every core
+
+	if (t->size() <= MAX_PRINTED_CITIES)
+		t->printAllPaths(fp);
 
 	fp.close();
 
@@ -19,4 +72,3 @@ int main()
 
 	return 0;
 }
-
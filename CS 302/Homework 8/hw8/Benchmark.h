@@ -0,0 +1,466 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Timing of prim() against boruvka() on large random graphs, and of shortest path queries
+ * Random geometric graphs join points in the unit square that are close together, so they are sparse
+ * and local. Power-law graphs are grown by preferential attachment (Barabasi-Albert), so a few vertices
+ * have a huge degree. Both use a fixed seed so that runs can be compared, and the total weight of both
+ * trees is printed so that the results can be checked against each other
+ *
+ * The shortest path benchmark runs the same random queries with every search on a geometric graph and
+ * reports the latency of each, the point coordinates give A* its straight line heuristic
+ *
+ * The dynamic MST benchmark applies random updates to a geometric graph and compares the latency of each
+ * kind of update against recomputing the whole tree with prim()
+ *
+ * The dense benchmark times densePrim() with and without AVX2 on complete graphs stored as a DenseGraph,
+ * and prim() on the same graph in CSR form while the edge list still fits in memory
+ */
+#pragma once
+#include "CSRGraph.h"
+#include "MST.h"
+#include "ShortestPath.h"
+#include "DynamicMST.h"
+#include "DenseGraph.h"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+//average degree of the generated graphs, so a graph of E edges has about E / 4 vertices
+#define BENCH_DEGREE 8
+//geometric graph edges weigh their length times this, plus 1
+#define BENCH_SCALE 1e9
+
+//points of the unit square within radius of each other, found by sorting
+//the points into square cells of side radius and only comparing points in
+//neighbouring cells. weights are the distances scaled up to integers, and
+//the points are left in x and y. the vertices are numbered cell by cell, the
+//way road networks are usually stored, so that vertices close together in
+//the plane are also close together in memory
+EdgeList geometricGraph(int vertices, std::mt19937& rng, VecDouble& x, VecDouble& y)
+{
+	std::uniform_real_distribution<double> coord(0.0, 1.0);
+	x.resize(vertices);
+	y.resize(vertices);
+	for (int v = 0; v < vertices; v++)
+		x[v] = coord(rng), y[v] = coord(rng);
+
+	double radius = std::sqrt(BENCH_DEGREE / (M_PI * vertices));
+	int cells = std::max(1, (int)(1.0 / radius));
+
+	auto cellOf = [&](int v)
+	{
+		int cx = std::min(cells - 1, (int)(x[v] * cells));
+		int cy = std::min(cells - 1, (int)(y[v] * cells));
+		return (size_t)cy * cells + cx;
+	};
+
+	//counting sort of the points by cell
+	std::vector<size_t> start((size_t)cells * cells + 1, 0);
+	for (int v = 0; v < vertices; v++)
+		start[cellOf(v) + 1]++;
+	for (size_t c = 0; c + 1 < start.size(); c++)
+		start[c + 1] += start[c];
+
+	VecDouble sx(vertices), sy(vertices);
+	std::vector<size_t> fill(start.begin(), start.end() - 1);
+	for (int v = 0; v < vertices; v++)
+	{
+		size_t i = fill[cellOf(v)]++;
+		sx[i] = x[v];
+		sy[i] = y[v];
+	}
+	x.swap(sx);
+	y.swap(sy);
+
+	EdgeList edges;
+	edges.reserve((size_t)vertices * BENCH_DEGREE / 2);
+
+	for (int cy = 0; cy < cells; cy++)
+		for (int cx = 0; cx < cells; cx++)
+			for (int dy = -1; dy <= 1; dy++)
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					int nx = cx + dx, ny = cy + dy;
+					if (nx < 0 || ny < 0 || nx >= cells || ny >= cells)
+						continue;
+
+					size_t a = (size_t)cy * cells + cx, b = (size_t)ny * cells + nx;
+					for (size_t i = start[a]; i < start[a + 1]; i++)
+						for (size_t j = start[b]; j < start[b + 1]; j++)
+						{
+							int u = (int)i, v = (int)j;
+							if (u >= v)
+								continue;
+
+							double d = std::hypot(x[u] - x[v], y[u] - y[v]);
+							if (d <= radius)
+								edges.push_back({ u, v, (int)(d * BENCH_SCALE) + 1 });
+						}
+				}
+
+	return edges;
+}
+
+//every new vertex joins BENCH_DEGREE / 2 edges to vertices picked in
+//proportion to their degree, by picking a random end of an edge so far
+EdgeList powerLawGraph(int vertices, std::mt19937& rng)
+{
+	const int links = BENCH_DEGREE / 2;
+	std::uniform_int_distribution<int> weight(1, 1000000);
+
+	EdgeList edges;
+	edges.reserve((size_t)vertices * links);
+	VecInt ends;
+	ends.reserve((size_t)vertices * links * 2);
+
+	//the first few vertices are all joined to each other
+	for (int u = 0; u <= links && u < vertices; u++)
+		for (int v = u + 1; v <= links && v < vertices; v++)
+		{
+			edges.push_back({ u, v, weight(rng) });
+			ends.push_back(u);
+			ends.push_back(v);
+		}
+
+	for (int v = links + 1; v < vertices; v++)
+	{
+		std::uniform_int_distribution<size_t> pick(0, ends.size() - 1);
+		for (int k = 0; k < links; k++)
+		{
+			int u = ends[pick(rng)];
+			edges.push_back({ u, v, weight(rng) });
+			ends.push_back(u);
+			ends.push_back(v);
+		}
+	}
+
+	return edges;
+}
+
+double benchMilliseconds(std::chrono::steady_clock::time_point start)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//bytes of memory that can be used without swapping, 0 if it is not known
+double physicalMemory()
+{
+#if defined(__linux__)
+	return (double)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+void benchmarkRun(const char* name, const EdgeList& edges, int vertices, unsigned int threads)
+{
+	CSRGraph g(vertices, edges);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EdgeList a = prim(g);
+	double primTime = benchMilliseconds(start);
+
+	start = std::chrono::steady_clock::now();
+	EdgeList b = boruvka(g, threads);
+	double boruvkaTime = benchMilliseconds(start);
+
+	long long wa = totalWeight(a), wb = totalWeight(b);
+	printf("%-10s %10zu %10d %10.1f %10.1f %18lld %18lld %s\n", name, edges.size(), vertices,
+		primTime, boruvkaTime, wa, wb, (wa == wb && a.size() == b.size()) ? "ok" : "MISMATCH");
+}
+
+//graphs of 10K edges up to max_edges, ten times larger each step and then
+//50M, sizes that would need more than 3/4 of the memory are skipped
+void benchmarkMST(long long max_edges, unsigned int threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	printf("\nMST, %u threads for Boruvka (times in ms)\n", threads);
+	printf("%-10s %10s %10s %10s %10s %18s %18s\n", "graph", "edges", "vertices", "prim", "boruvka", "prim weight", "boruvka weight");
+	printf("-------------------------------------------------------------------------------------------------\n");
+
+	std::vector<long long> sizes;
+	for (long long m = 10000; m <= max_edges && m < 50000000LL; m *= 10)
+		sizes.push_back(m);
+	if (max_edges >= 50000000LL)
+		sizes.push_back(50000000LL);
+
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		//the edge list, the CSR arrays and Boruvka's copies come to about this
+		double bytes = 64.0 * sizes[i];
+		if (physicalMemory() > 0 && bytes > physicalMemory() * 0.75)
+		{
+			printf("%-10s %10lld skipped, needs about %.0f MB\n", "", sizes[i], bytes / (1024 * 1024));
+			continue;
+		}
+
+		int vertices = (int)(sizes[i] * 2 / BENCH_DEGREE);
+
+		std::mt19937 rng(302);
+		VecDouble x, y;
+		benchmarkRun("geometric", geometricGraph(vertices, rng, x, y), vertices, threads);
+
+		rng.seed(302);
+		benchmarkRun("power-law", powerLawGraph(vertices, rng), vertices, threads);
+	}
+}
+
+//mean, median and 99th percentile of the query times, and queries per second
+void printLatency(const char* name, std::vector<double>& micros, long long settled)
+{
+	std::sort(micros.begin(), micros.end());
+
+	double total = 0;
+	for (size_t i = 0; i < micros.size(); i++)
+		total += micros[i];
+
+	size_t q = micros.size();
+	printf("%-14s %10.1f %10.1f %10.1f %10.0f %12.0f\n", name, total / q, micros[q / 2],
+		micros[std::min(q - 1, q * 99 / 100)], q / (total / 1e6), (double)settled / q);
+}
+
+//random point to point queries on a geometric graph of the given size, every
+//search answers the same queries and their distances are compared
+void benchmarkPaths(int vertices, int queries)
+{
+	std::mt19937 rng(302);
+	VecDouble x, y;
+	CSRGraph g(vertices, geometricGraph(vertices, rng, x, y));
+	ShortestPath sp(g);
+
+	printf("\nShortest paths, %d vertices, %zu edges, %d queries (times in microseconds)\n",
+		vertices, g.arcs() / 2, queries);
+	printf("%-14s %10s %10s %10s %10s %12s\n", "search", "mean", "median", "p99", "queries/s", "settled");
+	printf("------------------------------------------------------------------------\n");
+
+	std::uniform_int_distribution<int> pick(0, vertices - 1);
+	std::vector<std::pair<int, int> > pairs(queries);
+	for (int i = 0; i < queries; i++)
+		pairs[i] = std::make_pair(pick(rng), pick(rng));
+
+	EuclideanHeuristic straight = { x, y, BENCH_SCALE };
+	VecLong expected(queries);
+	int mismatches = 0;
+
+	for (int search = 0; search < 3; search++)
+	{
+		std::vector<double> micros(queries);
+		long long settled = 0;
+
+		for (int i = 0; i < queries; i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			PathResult r;
+			if (search == 0)
+				r = sp.dijkstra(pairs[i].first, pairs[i].second);
+			else if (search == 1)
+				r = sp.aStar(pairs[i].first, pairs[i].second, straight);
+			else
+				r = sp.bidirectional(pairs[i].first, pairs[i].second);
+
+			micros[i] = benchMilliseconds(start) * 1000.0;
+			settled += r.settled;
+
+			if (search == 0)
+				expected[i] = r.distance;
+			else if (r.distance != expected[i])
+				mismatches++;
+		}
+
+		const char* names[] = { "dijkstra", "a*", "bidirectional" };
+		printLatency(names[search], micros, settled);
+	}
+
+	printf("%d distances differed from dijkstra\n", mismatches);
+}
+
+//random updates to a geometric graph: new edges, cheaper edges, and removed
+//edges. the tree weight is checked against prim() at the end
+void benchmarkDynamicMST(int vertices, int updates)
+{
+	std::mt19937 rng(302);
+	VecDouble x, y;
+	EdgeList edges = geometricGraph(vertices, rng, x, y);
+
+	DynamicMST dynamic(vertices);
+	for (size_t i = 0; i < edges.size(); i++)
+		dynamic.insertEdge(edges[i].from, edges[i].to, edges[i].weight);
+
+	std::vector<bool> alive(edges.size(), true);
+
+	//0 insert, 1 cheaper, 2 remove an edge outside the tree, 3 remove a tree edge
+	const char* names[] = { "insert", "decrease", "remove other", "remove tree" };
+	std::vector<double> micros[4];
+
+	std::uniform_int_distribution<int> vertex(0, vertices - 1);
+	std::uniform_int_distribution<int> weight(1, (int)(0.02 * BENCH_SCALE));
+
+	for (int u = 0; u < updates; u++)
+	{
+		int kind = (int)(rng() % 100);
+		int id = (int)(rng() % edges.size());
+		std::chrono::steady_clock::time_point start;
+
+		if (kind < 45)
+		{
+			Edge e = { vertex(rng), vertex(rng), weight(rng) };
+			start = std::chrono::steady_clock::now();
+			int added = dynamic.insertEdge(e.from, e.to, e.weight);
+			kind = 0;
+
+			//the id of a removed edge is reused
+			if (added == (int)edges.size())
+			{
+				edges.push_back(e);
+				alive.push_back(true);
+			}
+			else
+			{
+				edges[added] = e;
+				alive[added] = true;
+			}
+		}
+		else if (kind < 90)
+		{
+			if (!alive[id])
+				continue;
+
+			int w = edges[id].weight / 2;
+			start = std::chrono::steady_clock::now();
+			dynamic.changeWeight(id, w);
+			kind = 1;
+
+			edges[id].weight = w;
+		}
+		else
+		{
+			if (!alive[id])
+				continue;
+
+			kind = dynamic.inTree(id) ? 3 : 2;
+			start = std::chrono::steady_clock::now();
+			dynamic.removeEdge(id);
+
+			alive[id] = false;
+		}
+
+		micros[kind].push_back(benchMilliseconds(start) * 1000.0);
+	}
+
+	EdgeList current;
+	for (size_t i = 0; i < edges.size(); i++)
+		if (alive[i])
+			current.push_back(edges[i]);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	long long expected = totalWeight(prim(CSRGraph(vertices, current)));
+	double primTime = benchMilliseconds(start) * 1000.0;
+
+	printf("\nDynamic MST, %d vertices, %zu edges, %d updates (times in microseconds)\n",
+		vertices, current.size(), updates);
+	printf("%-14s %10s %12s %12s\n", "update", "count", "mean", "p99");
+	printf("--------------------------------------------------\n");
+
+	for (int k = 0; k < 4; k++)
+	{
+		std::vector<double>& m = micros[k];
+		if (m.empty())
+			continue;
+
+		std::sort(m.begin(), m.end());
+		double total = 0;
+		for (size_t i = 0; i < m.size(); i++)
+			total += m[i];
+
+		printf("%-14s %10zu %12.1f %12.1f\n", names[k], m.size(), total / m.size(),
+			m[std::min(m.size() - 1, m.size() * 99 / 100)]);
+	}
+
+	printf("%-14s %10d %12.1f\n", "prim() rerun", 1, primTime);
+	printf("tree weight %lld, prim() %lld, %s\n", dynamic.totalWeight(), expected,
+		(dynamic.totalWeight() == expected) ? "ok" : "MISMATCH");
+}
+
+//complete graphs with random weights from 1000 vertices up to the given size,
+//sizes whose matrix would need more than 3/4 of the memory are skipped
+void benchmarkDense(int max_vertices)
+{
+	printf("\nDense MST, complete graphs (times in ms)\n");
+	printf("%-10s %12s %10s %10s %10s %18s\n", "vertices", "edges", "scalar", "avx2", "prim", "weight");
+	printf("----------------------------------------------------------------------------\n");
+
+	const int steps[] = { 1000, 2000, 5000, 10000, 20000, 50000 };
+	std::vector<int> sizes;
+	for (int n : steps)
+		if (n < max_vertices)
+			sizes.push_back(n);
+	sizes.push_back(max_vertices);
+
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		int n = sizes[i];
+		long long edges = (long long)n * (n - 1) / 2;
+
+		double bytes = 4.0 * n * n;
+		if (physicalMemory() > 0 && bytes > physicalMemory() * 0.75)
+		{
+			printf("%-10d %12lld skipped, needs about %.0f MB\n", n, edges, bytes / (1024 * 1024));
+			continue;
+		}
+
+		std::mt19937 rng(302);
+		std::uniform_int_distribution<int> weight(1, 1000000);
+		DenseGraph g(n);
+		for (int a = 0; a < n; a++)
+			for (int b = a + 1; b < n; b++)
+				g[a][b] = g[b][a] = weight(rng);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		long long scalar = totalWeight(densePrim(g, false));
+		double scalarTime = benchMilliseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		long long simd = totalWeight(densePrim(g));
+		double simdTime = benchMilliseconds(start);
+
+		//the edge list and both directions of the CSR arrays come to about
+		//this, which is only worth building for the smaller graphs
+		bool ok = (scalar == simd);
+		if (edges * 32.0 <= physicalMemory() * 0.25)
+		{
+			EdgeList list;
+			list.reserve(edges);
+			for (int a = 0; a < n; a++)
+				for (int b = a + 1; b < n; b++)
+					list.push_back({ a, b, g[a][b] });
+
+			CSRGraph csr(n, list);
+			EdgeList().swap(list);
+
+			start = std::chrono::steady_clock::now();
+			long long heap = totalWeight(prim(csr));
+			ok = ok && (heap == scalar);
+			printf("%-10d %12lld %10.1f %10.1f %10.1f %18lld %s\n", n, edges, scalarTime, simdTime,
+				benchMilliseconds(start), scalar, ok ? "ok" : "MISMATCH");
+		}
+		else
+		{
+			printf("%-10d %12lld %10.1f %10.1f %10s %18lld %s\n", n, edges, scalarTime, simdTime,
+				"-", scalar, ok ? "ok" : "MISMATCH");
+		}
+	}
+}
@@ -0,0 +1,99 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Undirected weighted graph in compressed sparse row (CSR) form
+ * The neighbours of every vertex are stored one after another in a single array, and offsets[v] is where
+ * the neighbours of v start, so a graph with millions of vertices takes two arrays instead of a vector per
+ * vertex or a V by V matrix
+ */
+#pragma once
+#include <vector>
+#include <cstddef>
+
+typedef std::vector<int> VecInt;
+typedef std::vector<VecInt> Graph;
+
+//an undirected edge, also used for the edges of an MST
+struct Edge
+{
+	int from;
+	int to;
+	int weight;
+};
+
+typedef std::vector<Edge> EdgeList;
+
+//one direction of an edge, stored in the neighbour array
+struct Arc
+{
+	int to;
+	int weight;
+};
+
+
+class CSRGraph {
+	//public methods
+public:
+
+	CSRGraph();
+
+	//every edge is stored in both directions, so from and to may be in either order
+	CSRGraph(int vertices, const EdgeList& edges);
+
+	//adjacency matrix where 0 means there is no edge
+	static CSRGraph fromMatrix(const Graph& g);
+
+	int size() const { return vertices; }
+	size_t arcs() const { return neighbours.size(); }
+
+	//neighbours of v are [begin(v), end(v))
+	const Arc* begin(int v) const { return neighbours.data() + offsets[v]; }
+	const Arc* end(int v) const { return neighbours.data() + offsets[v + 1]; }
+
+private:
+	int vertices;
+	std::vector<size_t> offsets;
+	std::vector<Arc> neighbours;
+};
+
+CSRGraph::CSRGraph() : vertices(0), offsets(1, 0)
+{
+}
+
+//counts the degree of every vertex, turns the counts into offsets, then
+//places each edge at the next free slot of both of its ends
+CSRGraph::CSRGraph(int vertices, const EdgeList& edges)
+	: vertices(vertices), offsets(vertices + 1, 0), neighbours(edges.size() * 2)
+{
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		offsets[edges[i].from + 1]++;
+		offsets[edges[i].to + 1]++;
+	}
+
+	for (int v = 0; v < vertices; v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		const Edge& e = edges[i];
+		neighbours[next[e.from]++] = { e.to, e.weight };
+		neighbours[next[e.to]++] = { e.from, e.weight };
+	}
+}
+
+//only the upper triangle is read, the matrix is assumed to be symmetric
+CSRGraph CSRGraph::fromMatrix(const Graph& g)
+{
+	EdgeList edges;
+
+	for (int i = 0; i < (int)g.size(); i++)
+		for (int j = i + 1; j < (int)g.size(); j++)
+			if (g[i][j] != 0)
+				edges.push_back({ i, j, g[i][j] });
+
+	return CSRGraph((int)g.size(), edges);
+}
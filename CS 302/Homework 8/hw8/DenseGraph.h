@@ -0,0 +1,98 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Adjacency matrix for dense graphs, and a bitset of vertices
+ * All of the rows are stored in one block. Each row starts on a cache line and is padded with 0 (no edge)
+ * to a multiple of DENSE_LANES weights, so a row can be read with whole aligned vector loads and no loop
+ * has to handle a partial block at the end
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+typedef std::vector<int> VecInt;
+typedef std::vector<VecInt> Graph;
+
+//every row is padded to a multiple of this many weights, one cache line
+#define DENSE_LANES 16
+//bytes every row is aligned to
+#define DENSE_ALIGN 64
+
+//one bit per vertex, padded like the rows of a DenseGraph
+class VertexSet {
+	//public methods
+public:
+
+	explicit VertexSet(int vertices = 0) : bits((vertices + 63) / 64 + 1, 0) {}
+
+	bool test(int v) const { return (bits[v >> 6] >> (v & 63)) & 1; }
+	void set(int v) { bits[v >> 6] |= (uint64_t)1 << (v & 63); }
+
+	//bits first to first + 7, first must be a multiple of 8
+	unsigned int byte(int first) const { return (unsigned int)(bits[first >> 6] >> (first & 63)) & 0xFF; }
+
+	//marks every vertex from v on, so padding is never picked
+	void setFrom(int v)
+	{
+		for (int i = v; i < (int)bits.size() * 64; i++)
+			set(i);
+	}
+
+private:
+	std::vector<uint64_t> bits;
+};
+
+
+class DenseGraph {
+	//public methods
+public:
+
+	DenseGraph() : n(0), stride(0), offset(0) {}
+	explicit DenseGraph(int vertices);
+
+	//rows move with the block they are in, but a copy would lose the alignment
+	DenseGraph(const DenseGraph&) = delete;
+	DenseGraph& operator=(const DenseGraph&) = delete;
+	DenseGraph(DenseGraph&&) = default;
+	DenseGraph& operator=(DenseGraph&&) = default;
+
+	//adjacency matrix where 0 means there is no edge
+	static DenseGraph fromMatrix(const Graph& g);
+
+	int size() const { return n; }
+
+	//weights per row including the padding, a multiple of DENSE_LANES
+	int rowStride() const { return stride; }
+
+	//returns row i, so g[i][j] works the same as it does on a Graph
+	int* operator[](int i) { return cells.data() + offset + (size_t)i * stride; }
+	const int* operator[](int i) const { return cells.data() + offset + (size_t)i * stride; }
+
+private:
+	int n;
+	int stride;
+	size_t offset; //first int of cells that is on a DENSE_ALIGN boundary
+	VecInt cells;
+};
+
+//n by n with no edges, one spare line is allocated to line the rows up
+DenseGraph::DenseGraph(int vertices)
+	: n(vertices), stride((vertices + DENSE_LANES - 1) / DENSE_LANES * DENSE_LANES),
+	cells((size_t)stride * vertices + DENSE_ALIGN / sizeof(int), 0)
+{
+	uintptr_t address = (uintptr_t)cells.data();
+	offset = ((DENSE_ALIGN - address % DENSE_ALIGN) % DENSE_ALIGN) / sizeof(int);
+}
+
+DenseGraph DenseGraph::fromMatrix(const Graph& g)
+{
+	DenseGraph d((int)g.size());
+	for (int i = 0; i < d.n; i++)
+		for (int j = 0; j < d.n; j++)
+			d[i][j] = g[i][j];
+
+	return d;
+}
@@ -0,0 +1,463 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Minimum spanning forest kept up to date while edges are added, removed and change weight
+ * The forest is stored in a link-cut tree, where every tree edge is a node of its own between its two
+ * vertices, so the heaviest edge on the path between any two vertices is found in O(log n) amortized.
+ * A new or cheaper edge between two connected vertices replaces the heaviest edge on the path between
+ * them if it is lighter (cycle swap). Only removing a tree edge, or making one heavier, can need an edge
+ * from outside the forest. That edge is cut, and the lightest edge between the two trees it leaves is
+ * found by walking both trees at once, so the search stops after the smaller tree and its edges
+ * The id of a removed edge is given to the next new edge, so the storage follows the live graph
+ * https://en.wikipedia.org/wiki/Link/cut_tree used for reference
+ */
+#pragma once
+#include "CSRGraph.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+
+class DynamicMST {
+	//public methods
+public:
+
+	explicit DynamicMST(int vertices);
+
+	//returns the id of the new edge, the same pair of vertices may have more than one edge
+	//the id of a removed edge is reused, so it must not be used after removeEdge()
+	int insertEdge(int from, int to, int weight);
+	void changeWeight(int id, int weight);
+	void removeEdge(int id);
+
+	long long totalWeight() const { return total; }
+	bool inTree(int id) const { return edges[id].tree; }
+
+	//the edges of the forest
+	EdgeList treeEdges() const;
+
+	//protected methods, only for helper methods
+protected:
+	struct EdgeInfo
+	{
+		Edge e;
+		bool alive;
+		bool tree;
+	};
+
+	int edgeNode(int id) const { return vertices + id; }
+	int otherEnd(int id, int v) const { return (edges[id].e.from == v) ? edges[id].e.to : edges[id].e.from; }
+
+	//an edge that has just become cheaper, or is new, joins the forest if
+	//it connects two trees or beats the heaviest edge on the path it closes
+	void offer(int id);
+	void addToTree(int id);
+	void removeFromTree(int id);
+	void reconnect(int a, int b);
+	void detach(int v, int id);
+
+	//link-cut tree over the vertex and edge nodes
+	int addNode(int value);
+	void resetNode(int x, int value);
+	bool isRoot(int x) const;
+	void push(int x);
+	void pull(int x);
+	void rotate(int x);
+	void splay(int x);
+	void access(int x);
+	void makeRoot(int x);
+	int findRoot(int x);
+	void link(int x, int y);
+	void cut(int x, int y);
+	int pathMax(int u, int v);
+
+private:
+	int vertices;
+	long long total = 0;
+	std::vector<EdgeInfo> edges;
+
+	//ids of the live edges at every vertex, and ids of removed edges
+	std::vector<std::vector<int> > incident;
+	std::vector<int> free_ids;
+
+	//which of the two trees reconnect() has reached a vertex from, -1 for
+	//neither, and the vertices each search has reached in order
+	std::vector<signed char> side;
+	std::vector<int> reached[2];
+
+	//child[x][0] and child[x][1] are the children of x in its splay tree, and
+	//up[x] is its parent there or, for the root of a splay tree, the node the
+	//path hangs from. value is the edge weight, INT_MIN for vertices, and
+	//heaviest is the node with the largest value in the splay subtree
+	std::vector<int> child[2];
+	std::vector<int> up;
+	std::vector<int> value;
+	std::vector<int> heaviest;
+	std::vector<bool> flip;
+
+	//nodes from the one being splayed up to the root of its splay tree
+	std::vector<int> path;
+};
+
+DynamicMST::DynamicMST(int vertices) : vertices(vertices), incident(vertices), side(vertices, -1)
+{
+	for (int v = 0; v < vertices; v++)
+		addNode(INT_MIN);
+}
+
+int DynamicMST::addNode(int val)
+{
+	int x = (int)up.size();
+	child[0].push_back(-1);
+	child[1].push_back(-1);
+	up.push_back(-1);
+	value.push_back(val);
+	heaviest.push_back(x);
+	flip.push_back(false);
+	return x;
+}
+
+//a removed edge's node has been cut from everything, only its fields are left
+void DynamicMST::resetNode(int x, int val)
+{
+	child[0][x] = child[1][x] = up[x] = -1;
+	value[x] = val;
+	heaviest[x] = x;
+	flip[x] = false;
+}
+
+int DynamicMST::insertEdge(int from, int to, int weight)
+{
+	if (from < 0 || to < 0 || from >= vertices || to >= vertices)
+		throw std::out_of_range("DynamicMST edge has a vertex that does not exist");
+
+	int id;
+	if (free_ids.empty())
+	{
+		id = (int)edges.size();
+		edges.push_back({ { from, to, weight }, true, false });
+		addNode(weight);
+	}
+	else
+	{
+		id = free_ids.back();
+		free_ids.pop_back();
+		edges[id] = { { from, to, weight }, true, false };
+		resetNode(edgeNode(id), weight);
+	}
+
+	incident[from].push_back(id);
+	incident[to].push_back(id);
+
+	offer(id);
+	return id;
+}
+
+void DynamicMST::changeWeight(int id, int weight)
+{
+	EdgeInfo& info = edges[id];
+	if (!info.alive || weight == info.e.weight)
+		return;
+
+	int old = info.e.weight;
+	info.e.weight = weight;
+
+	if (!info.tree)
+	{
+		if (weight < old)
+			offer(id);
+		return;
+	}
+
+	if (weight < old)
+	{
+		//a cheaper tree edge is still the best way across its cut
+		int x = edgeNode(id);
+		access(x);
+		splay(x);
+		value[x] = weight;
+		pull(x);
+		total += weight - old;
+	}
+	else
+	{
+		//an edge outside the forest may now be cheaper, so the edge is cut
+		//and is one of the edges reconnect() chooses from
+		total += weight - old;
+		removeFromTree(id);
+		reconnect(info.e.from, info.e.to);
+	}
+}
+
+void DynamicMST::removeEdge(int id)
+{
+	EdgeInfo& info = edges[id];
+	if (!info.alive)
+		return;
+
+	info.alive = false;
+	detach(info.e.from, id);
+	detach(info.e.to, id);
+
+	if (info.tree)
+	{
+		removeFromTree(id);
+		reconnect(info.e.from, info.e.to);
+	}
+
+	free_ids.push_back(id);
+}
+
+//removes id from the list of edges at v, the order of the list does not matter
+void DynamicMST::detach(int v, int id)
+{
+	std::vector<int>& list = incident[v];
+	std::vector<int>::iterator it = std::find(list.begin(), list.end(), id);
+	*it = list.back();
+	list.pop_back();
+}
+
+EdgeList DynamicMST::treeEdges() const
+{
+	EdgeList result;
+	for (size_t i = 0; i < edges.size(); i++)
+		if (edges[i].tree)
+			result.push_back(edges[i].e);
+
+	return result;
+}
+
+void DynamicMST::offer(int id)
+{
+	const Edge& e = edges[id].e;
+	if (e.from == e.to)
+		return;
+
+	if (findRoot(e.from) != findRoot(e.to))
+	{
+		addToTree(id);
+		return;
+	}
+
+	int x = pathMax(e.from, e.to);
+	if (value[x] > e.weight)
+	{
+		removeFromTree(x - vertices);
+		addToTree(id);
+	}
+}
+
+void DynamicMST::addToTree(int id)
+{
+	EdgeInfo& info = edges[id];
+	int x = edgeNode(id);
+
+	value[x] = info.e.weight;
+	pull(x);
+	link(x, info.e.from);
+	link(info.e.to, x);
+
+	info.tree = true;
+	total += info.e.weight;
+}
+
+void DynamicMST::removeFromTree(int id)
+{
+	EdgeInfo& info = edges[id];
+	int x = edgeNode(id);
+
+	cut(info.e.from, x);
+	cut(x, info.e.to);
+
+	info.tree = false;
+	total -= info.e.weight;
+}
+
+//a and b were joined by the tree edge that was just cut, and are now in two
+//different trees. both trees are walked along their tree edges at once, one
+//vertex from each in turn, so the walk stops as soon as the smaller one has
+//been reached in full. the lightest edge from it to a vertex outside of it
+//joins the trees again, if there is one
+void DynamicMST::reconnect(int a, int b)
+{
+	reached[0].assign(1, a);
+	reached[1].assign(1, b);
+	side[a] = 0;
+	side[b] = 1;
+
+	size_t next[2] = { 0, 0 };
+	int small = -1;
+
+	while (small == -1)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			if (next[s] == reached[s].size())
+			{
+				small = s;
+				break;
+			}
+
+			int v = reached[s][next[s]++];
+			for (size_t k = 0; k < incident[v].size(); k++)
+			{
+				int id = incident[v][k];
+				int w = otherEnd(id, v);
+				if (edges[id].tree && side[w] == -1)
+				{
+					side[w] = (signed char)s;
+					reached[s].push_back(w);
+				}
+			}
+		}
+	}
+
+	//every tree edge at the smaller tree stays inside it, so any other edge
+	//that leaves it crosses the cut
+	int best = -1;
+	for (size_t i = 0; i < reached[small].size(); i++)
+	{
+		int v = reached[small][i];
+		for (size_t k = 0; k < incident[v].size(); k++)
+		{
+			int id = incident[v][k];
+			if (side[otherEnd(id, v)] != small && (best == -1 || edges[id].e.weight < edges[best].e.weight))
+				best = id;
+		}
+	}
+
+	for (int s = 0; s < 2; s++)
+		for (size_t i = 0; i < reached[s].size(); i++)
+			side[reached[s][i]] = -1;
+
+	if (best != -1)
+		addToTree(best);
+}
+
+//x is the root of its splay tree, which may still hang from another path
+bool DynamicMST::isRoot(int x) const
+{
+	int p = up[x];
+	return p == -1 || (child[0][p] != x && child[1][p] != x);
+}
+
+//hands a pending reversal down to the children
+void DynamicMST::push(int x)
+{
+	if (!flip[x])
+		return;
+
+	std::swap(child[0][x], child[1][x]);
+	for (int d = 0; d < 2; d++)
+		if (child[d][x] != -1)
+			flip[child[d][x]] = !flip[child[d][x]];
+
+	flip[x] = false;
+}
+
+void DynamicMST::pull(int x)
+{
+	heaviest[x] = x;
+	for (int d = 0; d < 2; d++)
+	{
+		int c = child[d][x];
+		if (c != -1 && value[heaviest[c]] > value[heaviest[x]])
+			heaviest[x] = heaviest[c];
+	}
+}
+
+void DynamicMST::rotate(int x)
+{
+	int p = up[x], g = up[p];
+	int d = (child[1][p] == x) ? 1 : 0;
+
+	if (!isRoot(p))
+		child[(child[1][g] == p) ? 1 : 0][g] = x;
+	up[x] = g;
+
+	child[d][p] = child[1 - d][x];
+	if (child[d][p] != -1)
+		up[child[d][p]] = p;
+
+	child[1 - d][x] = p;
+	up[p] = x;
+
+	pull(p);
+	pull(x);
+}
+
+//the reversals above x are handed down first, from the top, so that the
+//children are in their real order while x is rotated up
+void DynamicMST::splay(int x)
+{
+	path.assign(1, x);
+	for (int y = x; !isRoot(y); y = up[y])
+		path.push_back(up[y]);
+	for (size_t i = path.size(); i-- > 0;)
+		push(path[i]);
+
+	while (!isRoot(x))
+	{
+		int p = up[x], g = up[p];
+		if (!isRoot(p))
+			rotate(((child[0][p] == x) == (child[0][g] == p)) ? p : x);
+		rotate(x);
+	}
+}
+
+//makes the path from the root of x's tree to x a single splay tree
+void DynamicMST::access(int x)
+{
+	int last = -1;
+	for (int y = x; y != -1; y = up[y])
+	{
+		splay(y);
+		child[1][y] = last;
+		pull(y);
+		last = y;
+	}
+	splay(x);
+}
+
+void DynamicMST::makeRoot(int x)
+{
+	access(x);
+	flip[x] = !flip[x];
+}
+
+int DynamicMST::findRoot(int x)
+{
+	access(x);
+	for (push(x); child[0][x] != -1; push(x))
+		x = child[0][x];
+
+	splay(x);
+	return x;
+}
+
+void DynamicMST::link(int x, int y)
+{
+	makeRoot(x);
+	up[x] = y;
+}
+
+//x and y must be joined by an edge of the link-cut tree
+void DynamicMST::cut(int x, int y)
+{
+	makeRoot(x);
+	access(y);
+	child[0][y] = -1;
+	up[x] = -1;
+	pull(y);
+}
+
+//node with the largest value on the path from u to v
+int DynamicMST::pathMax(int u, int v)
+{
+	makeRoot(u);
+	access(v);
+	return heaviest[v];
+}
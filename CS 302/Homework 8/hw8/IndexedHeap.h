@@ -0,0 +1,161 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Indexed d-ary min heap of vertices keyed by weight or distance, with decrease-key
+ * pos[v] is where vertex v is in the heap, so the key of a vertex already in the heap can be lowered in
+ * O(log n) instead of pushing it again. Each node has HEAP_ARITY children, which makes the heap shallower
+ * than a binary heap and keeps the children of a node next to each other in memory
+ */
+#pragma once
+#include <vector>
+
+//children of each node of the heap
+#define HEAP_ARITY 4
+
+//a vertex and its key, kept together so sifting only touches the heap array
+template <typename Key>
+struct HeapEntry
+{
+	Key key;
+	int vertex;
+};
+
+
+template <typename Key = int>
+class IndexedHeap {
+	//public methods
+public:
+
+	//vertices are 0 to vertices - 1
+	explicit IndexedHeap(int vertices);
+
+	bool empty() const { return heap.empty(); }
+	bool contains(int v) const { return pos[v] >= 0; }
+
+	//adds v, or lowers its key if it is already in the heap with a larger one
+	void push(int v, Key key);
+
+	//smallest key in the heap, which must not be empty
+	Key top() const { return heap[0].key; }
+
+	//removes and returns the vertex with the smallest key
+	int pop();
+
+	//empties the heap in O(size) so that it can be used again
+	void clear();
+
+	//protected methods, only for helper methods
+protected:
+	void siftUp(int i);
+	void siftDown(int i);
+	void place(int i, const HeapEntry<Key>& e);
+
+private:
+	std::vector<HeapEntry<Key> > heap;
+	std::vector<int> pos; //-1 when the vertex is not in the heap
+};
+
+template <typename Key>
+IndexedHeap<Key>::IndexedHeap(int vertices) : pos(vertices, -1)
+{
+}
+
+template <typename Key>
+void IndexedHeap<Key>::place(int i, const HeapEntry<Key>& e)
+{
+	heap[i] = e;
+	pos[e.vertex] = i;
+}
+
+template <typename Key>
+void IndexedHeap<Key>::push(int v, Key key)
+{
+	if (pos[v] < 0)
+	{
+		heap.push_back({ key, v });
+		pos[v] = (int)heap.size() - 1;
+		siftUp(pos[v]);
+	}
+	else if (key < heap[pos[v]].key)
+	{
+		heap[pos[v]].key = key;
+		siftUp(pos[v]);
+	}
+}
+
+template <typename Key>
+int IndexedHeap<Key>::pop()
+{
+	int v = heap[0].vertex;
+	pos[v] = -1;
+
+	HeapEntry<Key> last = heap.back();
+	heap.pop_back();
+
+	if (!heap.empty())
+	{
+		place(0, last);
+		siftDown(0);
+	}
+
+	return v;
+}
+
+template <typename Key>
+void IndexedHeap<Key>::clear()
+{
+	for (size_t i = 0; i < heap.size(); i++)
+		pos[heap[i].vertex] = -1;
+
+	heap.clear();
+}
+
+//moves the entry at i up past every parent with a larger key
+template <typename Key>
+void IndexedHeap<Key>::siftUp(int i)
+{
+	HeapEntry<Key> e = heap[i];
+
+	while (i > 0)
+	{
+		int parent = (i - 1) / HEAP_ARITY;
+		if (heap[parent].key <= e.key)
+			break;
+
+		place(i, heap[parent]);
+		i = parent;
+	}
+
+	place(i, e);
+}
+
+//moves the entry at i down past every smallest child with a smaller key
+template <typename Key>
+void IndexedHeap<Key>::siftDown(int i)
+{
+	HeapEntry<Key> e = heap[i];
+	int n = (int)heap.size();
+
+	while (true)
+	{
+		int first = i * HEAP_ARITY + 1;
+		if (first >= n)
+			break;
+
+		int best = first;
+		int last = (first + HEAP_ARITY < n) ? first + HEAP_ARITY : n;
+		for (int c = first + 1; c < last; c++)
+			if (heap[c].key < heap[best].key)
+				best = c;
+
+		if (heap[best].key >= e.key)
+			break;
+
+		place(i, heap[best]);
+		i = best;
+	}
+
+	place(i, e);
+}
@@ -0,0 +1,444 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Minimum spanning tree algorithms over a CSRGraph, each returns the edges of the tree
+ * A graph that is not connected gets a minimum spanning forest, one tree per connected part
+ */
+#pragma once
+#include "CSRGraph.h"
+#include "IndexedHeap.h"
+#include "DenseGraph.h"
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+
+//x86 builds with GCC or Clang get AVX2 versions of the dense Prim loops, used
+//when the CPU running the program has AVX2
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DENSE_AVX2 1
+#include <immintrin.h>
+#endif
+
+typedef std::vector<bool> VecBool;
+
+//Boruvka hands the rest of the graph to Kruskal once this few edges are left
+#define KRUSKAL_EDGES (1 << 16)
+
+//dense Prim key of a vertex no edge reaches yet, and of one in the tree
+#define DENSE_UNREACHED (INT_MAX - 1)
+#define DENSE_DONE INT_MAX
+
+//total weight of a list of edges
+long long totalWeight(const EdgeList& edges)
+{
+	long long total = 0;
+	for (size_t i = 0; i < edges.size(); i++)
+		total += edges[i].weight;
+
+	return total;
+}
+
+//Prim's algorithm with an indexed heap in O(E log V), cheap[v] is the lightest
+//edge from the tree to v seen so far and parent[v] is the other end of it.
+//the edges come out in the order the vertices join the tree
+EdgeList prim(const CSRGraph& g)
+{
+	int n = g.size();
+
+	VecInt cheap(n, INT_MAX); //cheapest edge weights
+	VecInt parent(n, -1);
+	VecBool visited(n, false); //if vertex is visted
+	IndexedHeap<int> heap(n);
+
+	EdgeList mst;
+	mst.reserve(n > 0 ? n - 1 : 0);
+
+	for (int root = 0; root < n; root++)
+	{
+		if (visited[root])
+			continue;
+
+		cheap[root] = 0;
+		heap.push(root, 0);
+
+		while (!heap.empty())
+		{
+			int x = heap.pop();
+			visited[x] = true;
+
+			if (parent[x] != -1)
+				mst.push_back({ parent[x], x, cheap[x] });
+
+			for (const Arc* a = g.begin(x); a != g.end(x); a++)
+			{
+				if (visited[a->to] == false && a->weight < cheap[a->to])
+				{
+					parent[a->to] = x;
+					cheap[a->to] = a->weight;
+					heap.push(a->to, a->weight);
+				}
+			}
+		}
+	}
+
+	return mst;
+}
+
+//runs f(begin, end) on threads equal slices of [0, n), the calling thread
+//takes the first slice
+template <typename F>
+void parallelFor(size_t n, unsigned int threads, F f)
+{
+	if (threads <= 1 || n < threads)
+	{
+		f((size_t)0, n);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threads; t++)
+		workers.emplace_back(f, n * t / threads, n * (t + 1) / threads);
+
+	f((size_t)0, n / threads);
+
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+//root of v, halving the path on the way up
+int findRoot(VecInt& parent, int v)
+{
+	while (parent[v] != v)
+		v = parent[v] = parent[parent[v]];
+
+	return v;
+}
+
+//Kruskal's algorithm on the edges ids of list, where label[v] is the
+//component v already belongs to. adds the edges it keeps to mst
+void kruskal(const EdgeList& list, std::vector<uint32_t>& ids, const VecInt& label, EdgeList& mst)
+{
+	std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b)
+	{
+		return list[a].weight < list[b].weight || (list[a].weight == list[b].weight && a < b);
+	});
+
+	VecInt parent(label.size());
+	std::iota(parent.begin(), parent.end(), 0);
+
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		const Edge& e = list[ids[i]];
+		int a = findRoot(parent, label[e.from]);
+		int b = findRoot(parent, label[e.to]);
+
+		if (a != b)
+		{
+			parent[a] = b;
+			mst.push_back(e);
+		}
+	}
+}
+
+//parallel Boruvka, threads 0 uses every core. every round each component
+//picks its lightest edge to another component, all of them are added at
+//once and the edges inside a component are dropped, so there are at most
+//log V rounds. ties are broken by the edge's index, which keeps the picked
+//edges from forming a cycle
+EdgeList boruvka(const CSRGraph& g, unsigned int threads = 0)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	int n = g.size();
+
+	//each edge once, from its smaller end
+	EdgeList list;
+	list.reserve(g.arcs() / 2);
+	for (int v = 0; v < n; v++)
+		for (const Arc* a = g.begin(v); a != g.end(v); a++)
+			if (v < a->to)
+				list.push_back({ v, a->to, a->weight });
+
+	std::vector<uint32_t> live(list.size());
+	std::iota(live.begin(), live.end(), 0);
+
+	//label[v] is the component of v, named after one of its vertices
+	VecInt label(n);
+	std::iota(label.begin(), label.end(), 0);
+	VecInt roots(label);
+
+	EdgeList mst;
+	mst.reserve(n > 0 ? n - 1 : 0);
+
+	std::vector<std::atomic<uint64_t> > best(n);
+	VecInt hook(n), next(n);
+	std::vector<uint32_t> kept(live.size());
+
+	while (live.size() > KRUSKAL_EDGES)
+	{
+		for (size_t i = 0; i < roots.size(); i++)
+			best[roots[i]].store(UINT64_MAX, std::memory_order_relaxed);
+
+		//the weight goes in the high half with its sign bit flipped, so the
+		//keys compare in the same order as (weight, index)
+		parallelFor(live.size(), threads, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const Edge& e = list[live[i]];
+				int a = label[e.from], b = label[e.to];
+				if (a == b)
+					continue;
+
+				uint64_t key = ((uint64_t)((uint32_t)e.weight ^ 0x80000000u) << 32) | live[i];
+				for (int c : { a, b })
+				{
+					uint64_t curr = best[c].load(std::memory_order_relaxed);
+					while (key < curr && !best[c].compare_exchange_weak(curr, key, std::memory_order_relaxed))
+						;
+				}
+			}
+		});
+
+		//every component hooks onto the other end of its edge
+		parallelFor(roots.size(), threads, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				int r = roots[i];
+				uint64_t key = best[r].load(std::memory_order_relaxed);
+
+				if (key == UINT64_MAX)
+					hook[r] = r;
+				else
+				{
+					const Edge& e = list[(uint32_t)key];
+					hook[r] = (label[e.from] == r) ? label[e.to] : label[e.from];
+				}
+			}
+		});
+
+		//two components that picked the same edge point at each other, only
+		//the larger one keeps pointing so that the edge is added once
+		parallelFor(roots.size(), threads, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				int r = roots[i];
+				next[r] = (hook[hook[r]] == r && r < hook[r]) ? r : hook[r];
+			}
+		});
+		hook.swap(next);
+
+		for (size_t i = 0; i < roots.size(); i++)
+			if (hook[roots[i]] != roots[i])
+				mst.push_back(list[(uint32_t)best[roots[i]].load(std::memory_order_relaxed)]);
+
+		//pointer jumping until every component points at the root of its tree
+		std::atomic<bool> changed(true);
+		while (changed)
+		{
+			changed = false;
+			parallelFor(roots.size(), threads, [&](size_t begin, size_t end)
+			{
+				bool moved = false;
+				for (size_t i = begin; i < end; i++)
+				{
+					int r = roots[i];
+					next[r] = hook[hook[r]];
+					moved |= (next[r] != hook[r]);
+				}
+				if (moved)
+					changed = true;
+			});
+
+			parallelFor(roots.size(), threads, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					hook[roots[i]] = next[roots[i]];
+			});
+		}
+
+		parallelFor(n, threads, [&](size_t begin, size_t end)
+		{
+			for (size_t v = begin; v < end; v++)
+				label[v] = hook[label[v]];
+		});
+
+		roots.erase(std::remove_if(roots.begin(), roots.end(), [&](int r) { return hook[r] != r; }), roots.end());
+
+		//keeps the edges between different components, each thread counts
+		//its slice first so that they can copy into place without a lock
+		std::vector<size_t> counts(threads + 1, 0);
+		auto slice = [&](size_t t) { return live.size() * t / threads; };
+
+		parallelFor(threads, threads, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+				for (size_t i = slice(t); i < slice(t + 1); i++)
+					counts[t + 1] += (label[list[live[i]].from] != label[list[live[i]].to]);
+		});
+
+		for (unsigned int t = 0; t < threads; t++)
+			counts[t + 1] += counts[t];
+
+		parallelFor(threads, threads, [&](size_t begin, size_t end)
+		{
+			for (size_t t = begin; t < end; t++)
+			{
+				size_t out = counts[t];
+				for (size_t i = slice(t); i < slice(t + 1); i++)
+					if (label[list[live[i]].from] != label[list[live[i]].to])
+						kept[out++] = live[i];
+			}
+		});
+
+		kept.resize(counts[threads]);
+		live.swap(kept);
+	}
+
+	kruskal(list, live, label, mst);
+
+	return mst;
+}
+
+//index of the smallest key, the first one if there is a tie
+int minIndexScalar(const int* keys, int count)
+{
+	int best = 0;
+	for (int i = 1; i < count; i++)
+		if (keys[i] < keys[best])
+			best = i;
+
+	return best;
+}
+
+//lowers cheap[j] to the edge from x for every vertex j not in the tree
+void relaxScalar(const int* row, int* cheap, int* parent, const VertexSet& visited, int x, int count)
+{
+	for (int j = 0; j < count; j++)
+		if (row[j] != 0 && !visited.test(j) && row[j] < cheap[j])
+			cheap[j] = row[j], parent[j] = x;
+}
+
+#ifdef DENSE_AVX2
+//each lane keeps the smallest key it has seen and where, a lane only moves on
+//a smaller key so it keeps the first of a tie, and so does the final pick
+__attribute__((target("avx2")))
+int minIndexAVX2(const int* keys, int count)
+{
+	__m256i best = _mm256_set1_epi32(INT_MAX);
+	__m256i where = _mm256_setzero_si256();
+	__m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i step = _mm256_set1_epi32(8);
+
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256i k = _mm256_loadu_si256((const __m256i*)(keys + i));
+		__m256i smaller = _mm256_cmpgt_epi32(best, k);
+		best = _mm256_blendv_epi8(best, k, smaller);
+		where = _mm256_blendv_epi8(where, index, smaller);
+		index = _mm256_add_epi32(index, step);
+	}
+
+	alignas(32) int lane_key[8], lane_index[8];
+	_mm256_store_si256((__m256i*)lane_key, best);
+	_mm256_store_si256((__m256i*)lane_index, where);
+
+	int pick = 0;
+	for (int l = 1; l < 8; l++)
+		if (lane_key[l] < lane_key[pick] ||
+			(lane_key[l] == lane_key[pick] && lane_index[l] < lane_index[pick]))
+			pick = l;
+
+	return lane_index[pick];
+}
+
+//eight vertices at a time, the visited bits of the eight are spread into
+//lane masks by testing one bit per lane
+__attribute__((target("avx2")))
+void relaxAVX2(const int* row, int* cheap, int* parent, const VertexSet& visited, int x, int count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i from = _mm256_set1_epi32(x);
+	const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+	for (int j = 0; j < count; j += 8)
+	{
+		__m256i w = _mm256_load_si256((const __m256i*)(row + j));
+		__m256i c = _mm256_loadu_si256((const __m256i*)(cheap + j));
+
+		__m256i bits = _mm256_and_si256(_mm256_set1_epi32((int)visited.byte(j)), bit);
+		__m256i skip = _mm256_or_si256(_mm256_cmpeq_epi32(bits, bit), _mm256_cmpeq_epi32(w, zero));
+		__m256i lower = _mm256_andnot_si256(skip, _mm256_cmpgt_epi32(c, w));
+
+		if (_mm256_testz_si256(lower, lower))
+			continue;
+
+		__m256i p = _mm256_loadu_si256((const __m256i*)(parent + j));
+		_mm256_storeu_si256((__m256i*)(cheap + j), _mm256_blendv_epi8(c, w, lower));
+		_mm256_storeu_si256((__m256i*)(parent + j), _mm256_blendv_epi8(p, from, lower));
+	}
+}
+#endif
+
+//Prim's algorithm in O(V^2) for graphs with an edge between most pairs of
+//vertices, where a heap would only add work. every step reads one row of
+//the matrix and the keys, both in order, with vector instructions when the
+//CPU has AVX2 and simd is true. weights must be below DENSE_UNREACHED
+EdgeList densePrim(const DenseGraph& g, bool simd = true)
+{
+	int n = g.size();
+	int count = g.rowStride();
+
+	//the padding after the last vertex is never picked or lowered
+	VecInt cheap(count, DENSE_UNREACHED);
+	VecInt parent(count, -1);
+	std::fill(cheap.begin() + n, cheap.end(), DENSE_DONE);
+
+	VertexSet visited(n);
+	visited.setFrom(n);
+
+#ifdef DENSE_AVX2
+	simd = simd && __builtin_cpu_supports("avx2");
+#else
+	simd = false;
+#endif
+
+	EdgeList mst;
+	mst.reserve(n > 0 ? n - 1 : 0);
+
+	for (int k = 0; k < n; k++)
+	{
+		int x;
+#ifdef DENSE_AVX2
+		if (simd)
+			x = minIndexAVX2(cheap.data(), count);
+		else
+#endif
+			x = minIndexScalar(cheap.data(), count);
+
+		//a vertex no edge reaches starts a new tree of the forest
+		if (cheap[x] != DENSE_UNREACHED)
+			mst.push_back({ parent[x], x, cheap[x] });
+
+		visited.set(x);
+		cheap[x] = DENSE_DONE;
+
+#ifdef DENSE_AVX2
+		if (simd)
+			relaxAVX2(g[x], cheap.data(), parent.data(), visited, x, count);
+		else
+#endif
+			relaxScalar(g[x], cheap.data(), parent.data(), visited, x, count);
+	}
+
+	return mst;
+}
@@ -0,0 +1,247 @@
+/**
+ * @brief  CS-302 Homework 8
+ * @Author Stone Sha (stones@nevada.unr.edu)
+ * @date   May 2019
+ *
+ * Point to point shortest paths over a CSRGraph with Dijkstra's algorithm, A* and bidirectional Dijkstra
+ * The arrays for a query are kept between queries, and a query only resets the vertices it reached by
+ * giving each query its own number (the stamp of a vertex is the last query that reached it), so a short query does
+ * not pay for clearing arrays the size of the whole graph. Edge weights must not be negative
+ */
+#pragma once
+#include "CSRGraph.h"
+#include "IndexedHeap.h"
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+
+typedef std::vector<long long> VecLong;
+typedef std::vector<double> VecDouble;
+
+//distance of a vertex that cannot be reached
+#define NO_PATH LLONG_MAX
+
+//distance and vertices of a shortest path, the path is empty when there is none
+struct PathResult
+{
+	long long distance = NO_PATH;
+	VecInt path;
+	int settled = 0; //vertices taken off a heap, a measure of the work done
+};
+
+//A* heuristic that is always 0, which turns A* into Dijkstra's algorithm
+struct ZeroHeuristic
+{
+	long long operator()(int, int) const { return 0; }
+};
+
+//straight line distance between points, which never overestimates when
+//every edge weighs at least scale times the distance between its ends
+struct EuclideanHeuristic
+{
+	const VecDouble& x;
+	const VecDouble& y;
+	double scale;
+
+	long long operator()(int v, int target) const
+	{
+		return (long long)(scale * std::hypot(x[v] - x[target], y[v] - y[target]));
+	}
+};
+
+
+class ShortestPath {
+	//public methods
+public:
+
+	explicit ShortestPath(const CSRGraph& graph);
+
+	PathResult dijkstra(int source, int target);
+
+	//h(v, target) must never be more than the distance from v to target, and
+	//should not drop by more than the weight of any edge (consistent), or the
+	//search settles vertices more than once
+	template <typename Heuristic>
+	PathResult aStar(int source, int target, Heuristic h);
+
+	//searches forward from source and backward from target at the same time,
+	//which usually settles far fewer vertices than one search
+	PathResult bidirectional(int source, int target);
+
+	//protected methods, only for helper methods
+protected:
+	//what one direction of search knows about a vertex, kept together so that
+	//reaching a vertex touches one cache line instead of three
+	struct Label
+	{
+		long long dist;
+		int parent;
+		unsigned int stamp;
+	};
+
+	struct Search
+	{
+		std::vector<Label> label;
+		IndexedHeap<long long> heap;
+
+		explicit Search(int n) : label(n, Label{ 0, -1, 0 }), heap(n) {}
+	};
+
+	void nextQuery();
+	void reach(Search& s, int v, long long d, int from);
+	long long distance(const Search& s, int v) const;
+	void walkBack(const Search& s, int v, VecInt& path) const;
+
+private:
+	const CSRGraph& g;
+	Search forward;
+	Search backward;
+	unsigned int query = 0;
+};
+
+ShortestPath::ShortestPath(const CSRGraph& graph)
+	: g(graph), forward(graph.size()), backward(graph.size())
+{
+}
+
+//starts a new query, when the number wraps around every stamp is cleared,
+//since a vertex not reached for 2^32 queries would look reached again
+void ShortestPath::nextQuery()
+{
+	if (++query != 0)
+		return;
+
+	for (size_t v = 0; v < forward.label.size(); v++)
+	{
+		forward.label[v].stamp = 0;
+		backward.label[v].stamp = 0;
+	}
+	query = 1;
+}
+
+//distance of v found by s during this query
+long long ShortestPath::distance(const Search& s, int v) const
+{
+	return (s.label[v].stamp == query) ? s.label[v].dist : NO_PATH;
+}
+
+void ShortestPath::reach(Search& s, int v, long long d, int from)
+{
+	s.label[v] = Label{ d, from, query };
+}
+
+//adds the vertices from v back to the start of s, v last
+void ShortestPath::walkBack(const Search& s, int v, VecInt& path) const
+{
+	size_t first = path.size();
+	for (; v != -1; v = s.label[v].parent)
+		path.push_back(v);
+
+	std::reverse(path.begin() + first, path.end());
+}
+
+PathResult ShortestPath::dijkstra(int source, int target)
+{
+	return aStar(source, target, ZeroHeuristic());
+}
+
+//the heap is keyed by distance plus the heuristic, so it takes vertices that
+//look closer to the target first. the target is done when it leaves the heap
+template <typename Heuristic>
+PathResult ShortestPath::aStar(int source, int target, Heuristic h)
+{
+	PathResult result;
+	nextQuery();
+
+	Search& s = forward;
+	s.heap.clear();
+
+	reach(s, source, 0, -1);
+	s.heap.push(source, h(source, target));
+
+	while (!s.heap.empty())
+	{
+		int x = s.heap.pop();
+		result.settled++;
+
+		if (x == target)
+		{
+			result.distance = s.label[x].dist;
+			walkBack(s, x, result.path);
+			break;
+		}
+
+		for (const Arc* a = g.begin(x); a != g.end(x); a++)
+		{
+			long long d = s.label[x].dist + a->weight;
+			if (d < distance(s, a->to))
+			{
+				reach(s, a->to, d, x);
+				s.heap.push(a->to, d + h(a->to, target));
+			}
+		}
+	}
+
+	return result;
+}
+
+//both searches take turns settling the closer of their next vertices, best
+//is the shortest path seen through a vertex both have reached. once the two
+//smallest keys add up to best, no shorter path can be left
+PathResult ShortestPath::bidirectional(int source, int target)
+{
+	PathResult result;
+	nextQuery();
+
+	forward.heap.clear();
+	backward.heap.clear();
+
+	reach(forward, source, 0, -1);
+	reach(backward, target, 0, -1);
+	forward.heap.push(source, 0);
+	backward.heap.push(target, 0);
+
+	long long best = (source == target) ? 0 : NO_PATH;
+	int meet = (source == target) ? source : -1;
+
+	while (!forward.heap.empty() && !backward.heap.empty() &&
+		forward.heap.top() + backward.heap.top() < best)
+	{
+		bool ahead = forward.heap.top() <= backward.heap.top();
+		Search& s = ahead ? forward : backward;
+		Search& other = ahead ? backward : forward;
+
+		int x = s.heap.pop();
+		result.settled++;
+
+		for (const Arc* a = g.begin(x); a != g.end(x); a++)
+		{
+			long long d = s.label[x].dist + a->weight;
+			if (d < distance(s, a->to))
+			{
+				reach(s, a->to, d, x);
+				s.heap.push(a->to, d);
+			}
+
+			long long rest = distance(other, a->to);
+			if (rest != NO_PATH && distance(s, a->to) + rest < best)
+			{
+				best = distance(s, a->to) + rest;
+				meet = a->to;
+			}
+		}
+	}
+
+	if (meet < 0)
+		return result;
+
+	result.distance = best;
+	walkBack(forward, meet, result.path);
+
+	//the backward parents lead from meet to the target
+	for (int v = backward.label[meet].parent; v != -1; v = backward.label[v].parent)
+		result.path.push_back(v);
+
+	return result;
+}
@@ -3,13 +3,22 @@
  * @Author Stone Sha (stones@nevada.unr.edu)
  * @date   May 2019
  *
- * Main driver program to test Prim's algorithm using an adjacency matrix to find the MST
+ * Main driver program to test Prim's algorithm to find the MST of a graph given as an adjacency matrix
  * Explanation included in "[CS 302] HW8.docx"
+ * "main bench [max edges] [threads]" times Prim's algorithm against parallel Boruvka instead, and
+ * "main paths [vertices] [queries]" times shortest path queries, and "main dynamic [vertices] [updates]"
+ * times updates to a dynamic MST against rerunning Prim's algorithm, and "main dense [vertices]" times
+ * Prim's algorithm on complete graphs stored as an adjacency matrix
  */
 
 #include <iostream>
 #include <vector>
 #include <climits>
+#include <cstring>
+#include <cstdlib>
+#include "CSRGraph.h"
+#include "MST.h"
+#include "Benchmark.h"
 
 //no. of vertices
 #define V 6
@@ -21,7 +30,7 @@ typedef std::vector<std::string> VecString;
 typedef std::vector<VecInt> Graph;
 
 //messy function for printing the adjacency matrix
-void printGraph(Graph g)
+void printGraph(const Graph& g)
 {
 	int n = 1;
 
@@ -44,58 +53,45 @@ void printGraph(Graph g)
 	std::cout << "  - - - - - - - - \n";
 }
 
-//prints mst from prim's algorithm
-void printMST(VecInt v, Graph g)
+//prints the edges of an mst
+void printMST(const EdgeList& mst)
 {
 	std::cout << "Edge\t\tWeight\n";
 
-	for (int i = 1; i < V; i++)
-		std::cout << v[i] + 1 << " -> " << i + 1 << "\t\t"
-		<< g[i][v[i]] << std::endl;
+	for (const Edge& e : mst)
+		std::cout << e.from + 1 << " -> " << e.to + 1 << "\t\t"
+		<< e.weight << std::endl;
 }
 
-//to find the smallest neightbor vertex value for not visited vertices
-int firstMin(VecInt v, VecBool visited)
+int main(int argc, char *argv[])
 {
-	int min = INT_MAX, min_index;
-
-	for (int i = 0; i < V; i++)
+	if (argc > 1 && std::strcmp(argv[1], "bench") == 0)
 	{
-		if (visited[i] == false && v[i] < min)
-			min = v[i], min_index = i;
+		benchmarkMST((argc > 2) ? std::atoll(argv[2]) : 50000000LL,
+			(argc > 3) ? (unsigned int)std::atoi(argv[3]) : 0); //0 uses every core
+		return 0;
 	}
 
-	return min_index;
-}
-
-//takes in a graph and constructs the mst and weights for each edge
-void prim(Graph g)
-{
-	VecInt cheap(V, INT_MAX); //cheapest edge weights
-	VecBool visited(V, false); //if vertex is visted
-	VecInt MST(V); //mst stored in vector
-	int x;
-
-	cheap[0] = 0;
-	MST[0] = -1;
+	if (argc > 1 && std::strcmp(argv[1], "paths") == 0)
+	{
+		benchmarkPaths((argc > 2) ? std::atoi(argv[2]) : 100000,
+			(argc > 3) ? std::atoi(argv[3]) : 1000);
+		return 0;
+	}
 
-	for (int i = 0; i < V - 1; i++)
+	if (argc > 1 && std::strcmp(argv[1], "dynamic") == 0)
 	{
-		x = firstMin(cheap, visited);
-		visited[x] = true;
-
-		for (int j = 0; j < V; j++)
-		{
-			if (g[x][j] && visited[j] == false && g[x][j] < cheap[j])
-				MST[j] = x, cheap[j] = g[x][j];
-		}
+		benchmarkDynamicMST((argc > 2) ? std::atoi(argv[2]) : 100000,
+			(argc > 3) ? std::atoi(argv[3]) : 10000);
+		return 0;
 	}
 
-	printMST(MST, g);
-}
+	if (argc > 1 && std::strcmp(argv[1], "dense") == 0)
+	{
+		benchmarkDense((argc > 2) ? std::atoi(argv[2]) : 20000);
+		return 0;
+	}
 
-int main()
-{
 	//2D vector, typedef as Graph
 	Graph g =
 	{// 1  2  3  4  5  6
@@ -110,8 +106,18 @@ int main()
 	//prints adjacency matrix
 	printGraph(g);
 
-	//uses prims algorithm to print the mst and the edge's weights
-	prim(g);
+	//uses prims algorithm to find the mst, then prints the edge's weights
+	CSRGraph csr = CSRGraph::fromMatrix(g);
+	printMST(prim(csr));
+
+	//shortest path between the first and last vertex
+	ShortestPath sp(csr);
+	PathResult r = sp.dijkstra(0, V - 1);
+
+	std::cout << "\nShortest path from 1 to " << V << ": ";
+	for (size_t i = 0; i < r.path.size(); i++)
+		std::cout << r.path[i] + 1 << ((i + 1 < r.path.size()) ? " -> " : "");
+	std::cout << " (" << r.distance << ")" << std::endl;
 
 	return 0;
 }
\ No newline at end of file